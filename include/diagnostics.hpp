@@ -3,6 +3,8 @@
 #include "diagnostics/core/function_ref.hpp"
 #include "diagnostics/core/cow_string.hpp"
 #include "diagnostics/core/small_vec.hpp"
+#include "diagnostics/core/buffer.hpp"
+#include "diagnostics/core/json_writer.hpp"
 #include "diagnostics/core/format.hpp"
 #include "diagnostics/core/term/config.hpp"
 #include "diagnostics/core/term/basic.hpp"
@@ -13,5 +15,20 @@
 #include "diagnostics/core/term/canvas.hpp"
 #include "diagnostics/basic.hpp"
 #include "diagnostics/consumer.hpp"
+#include "diagnostics/catalog.hpp"
+#include "diagnostics/highlighter.hpp"
+#include "diagnostics/filter.hpp"
+#include "diagnostics/limits.hpp"
+#include "diagnostics/pool.hpp"
+#include "diagnostics/executor.hpp"
 #include "diagnostics/emitter.hpp"
 #include "diagnostics/span.hpp"
+#include "diagnostics/source/column_index.hpp"
+#include "diagnostics/source/line_index.hpp"
+#include "diagnostics/source/mapped_source_file.hpp"
+#include "diagnostics/source/source_file.hpp"
+#include "diagnostics/source/source_manager.hpp"
+#include "diagnostics/source/source_buffer.hpp"
+#include "diagnostics/source/source_location.hpp"
+#include "diagnostics/source/source_converter.hpp"
+#include "diagnostics/source/token_line_cache.hpp"
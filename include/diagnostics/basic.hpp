@@ -5,15 +5,19 @@
 #include "core/term/color.hpp"
 #include "core/term/annotated_string.hpp"
 #include "forward.hpp"
+#include "core/arena.hpp"
 #include "core/cow_string.hpp"
 #include "core/format.hpp"
 #include "core/format_any.hpp"
 #include "core/small_vec.hpp"
 #include "span.hpp"
+#include "source/line_index.hpp"
 #include <algorithm>
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
 #include <format>
+#include <new>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -31,6 +35,9 @@ namespace dark {
         Delete // Must be the last element
     };
 
+    // Opt-in bump allocator backing the containers and format arguments of diagnostics.
+    using DiagnosticArena = core::Arena;
+
     static constexpr auto diagnostic_level_elements_count = static_cast<std::size_t>(DiagnosticLevel::Delete) + 1;
 
     [[nodiscard]] static inline constexpr auto to_string(DiagnosticLevel level) noexcept -> std::string_view {
@@ -44,6 +51,18 @@ namespace dark {
         }
     }
 
+    constexpr auto diagnostic_level_code_prefix(DiagnosticLevel level) noexcept -> std::string_view {
+        switch (level) {
+        case DiagnosticLevel::Help: return "H";
+        case DiagnosticLevel::Note: return "N";
+        case DiagnosticLevel::Warning: return "W";
+        case DiagnosticLevel::Error: return "E";
+        case DiagnosticLevel::Insert: return "I";
+        case DiagnosticLevel::Delete: return "D";
+          break;
+        }
+    }
+
     struct DiagnosticTokenInfo {
         // INFO: Do not change the order of the members since `DiagnosticLineTokenBuilder` relies
         // on this order.
@@ -80,7 +99,7 @@ namespace dark {
     };
 
     struct DiagnosticLineTokens {
-        core::SmallVec<DiagnosticTokenInfo> tokens;
+        core::ArenaSmallVec<DiagnosticTokenInfo> tokens;
         dsize_t line_number{}; // 1-based; 0 is invalid
         dsize_t line_start_offset{};
 
@@ -128,6 +147,17 @@ namespace dark {
             return false;
         }
 
+        // Clips the marker to every token; the last token also covers the text up to `line_end`.
+        constexpr auto clip_marker(Span marker, dsize_t line_end) noexcept -> void {
+            for (auto i = 0ul; i < tokens.size(); ++i) {
+                auto& tok = tokens[i];
+                auto end = i + 1 == tokens.size() ? std::max(line_end, tok.span().end()) : tok.span().end();
+                auto s = std::max(tok.token_start_offset, marker.start());
+                auto e = std::min(end, marker.end());
+                tok.marker = s < e ? Span(s, e) : Span{};
+            }
+        }
+
         friend void swap(DiagnosticLineTokens& lhs, DiagnosticLineTokens& rhs) {
             using std::swap;
             swap(lhs.tokens, rhs.tokens);
@@ -137,7 +167,7 @@ namespace dark {
     };
 
     struct DiagnosticSourceLocationTokens {
-        core::SmallVec<DiagnosticLineTokens> lines{};
+        core::ArenaSmallVec<DiagnosticLineTokens> lines{};
 
         constexpr auto span() const noexcept -> Span {
             if (empty()) return {};
@@ -190,22 +220,34 @@ namespace dark {
     struct DiagnosticLocation {
         std::string_view filename{};
         DiagnosticSourceLocationTokens source;
+        // False when the offsets aren't byte offsets of the file, e.g. the UTF-8 offsets of a
+        // transcoded `SourceFile`; serializers then leave them out.
+        bool has_byte_offsets{true};
 
         constexpr auto line_info() const noexcept -> std::pair<dsize_t, dsize_t> {
             for (auto const& line: source.lines) {
                 for (auto const& tok: line.tokens) {
                     if (tok.marker.empty()) continue;
-                    auto col = tok.col(line.line_start_offset);
+                    // The marker may start in the middle of a token, e.g. when a whole line is a single token.
+                    auto col = tok.marker.start() - std::min(line.line_start_offset, tok.marker.start());
                     return { line.line_number, col + 1 };
                 }
             }
             return { 0, 0 };
         }
 
+        // Resets the location while keeping the capacity of the line list.
+        auto clear() noexcept -> void {
+            filename = {};
+            source.lines.clear();
+            has_byte_offsets = true;
+        }
+
         friend void swap(DiagnosticLocation& lhs, DiagnosticLocation rhs) {
             using std::swap;
             swap(lhs.filename, rhs.filename);
             swap(lhs.source, rhs.source);
+            swap(lhs.has_byte_offsets, rhs.has_byte_offsets);
         }
 
         constexpr auto operator<(DiagnosticLocation const& other) const noexcept -> bool {
@@ -224,6 +266,20 @@ namespace dark {
             dsize_t token_start_offset, 
             Span marker = {}
         ) -> DiagnosticLocation;
+
+        /**
+         * @brief Builds a location from a single line.
+         * @param text line text starting at `line.line_start_offset`.
+         * @param line line info, usually from `SourceFile::line_info` or `LineIndex::info`.
+         */
+        static auto from_text(
+            std::string_view filename,
+            std::string_view text,
+            SourceLineInfo line,
+            Span marker = {}
+        ) -> DiagnosticLocation {
+            return from_text(filename, text, line.line_number, line.line_start_offset, line.line_start_offset, marker);
+        }
     };
 
     namespace detail {
@@ -245,6 +301,11 @@ namespace dark {
             "Diagnostic kind can only be either integral or enum type"
         );
 
+        // Works for both integral and enum kinds.
+        constexpr auto diagnostic_kind_index(diagnostic_kind_t kind) noexcept -> std::size_t {
+            return static_cast<std::size_t>(kind);
+        }
+
 
     } // namespace detail
 
@@ -252,8 +313,55 @@ namespace dark {
         term::AnnotatedString message{};
         // Could be used for insertion and rendering messages for helper text
         DiagnosticSourceLocationTokens tokens{};
-        core::SmallVec<Span, 1> spans{};
+        core::ArenaSmallVec<Span, 1> spans{};
         DiagnosticLevel level{};
+
+        // Resets the message while keeping the capacity of its containers.
+        auto clear() noexcept -> void {
+            message.strings.clear();
+            tokens.lines.clear();
+            spans.clear();
+            level = {};
+        }
+    };
+
+    // Locations that `DeferredLocation` can store inline.
+    template <typename LocT>
+    concept IsDeferrableLocation = std::is_trivially_copyable_v<LocT>
+        && sizeof(LocT) <= 2 * sizeof(dsize_t)
+        && alignof(LocT) <= alignof(dsize_t);
+
+    /**
+     * @brief Location whose conversion is put off until a consumer needs it. The converter
+     *        and a copy of the unconverted location are stored inline, so deferring never
+     *        allocates; locations that don't fit are converted right away by the emitter.
+     */
+    struct DeferredLocation {
+        static constexpr std::size_t max_location_size = 2 * sizeof(dsize_t);
+
+        constexpr DeferredLocation() noexcept = default;
+
+        // `converter` must provide `convert_deferred_loc(LocT)`.
+        template <typename ConverterT, IsDeferrableLocation LocT>
+        DeferredLocation(ConverterT const* converter, LocT loc) noexcept
+            : m_converter(converter)
+            , m_convert([](void const* c, std::byte const* l) -> DiagnosticLocation {
+                auto const* loc = std::launder(reinterpret_cast<LocT const*>(l));
+                return static_cast<ConverterT const*>(c)->convert_deferred_loc(*loc);
+            })
+        {
+            ::new (static_cast<void*>(m_location)) LocT(loc);
+        }
+
+        constexpr explicit operator bool() const noexcept { return m_convert != nullptr; }
+
+        auto operator()() const -> DiagnosticLocation {
+            return m_convert(m_converter, m_location);
+        }
+    private:
+        void const* m_converter{nullptr};
+        DiagnosticLocation (*m_convert)(void const*, std::byte const*){nullptr};
+        alignas(dsize_t) std::byte m_location[max_location_size]{};
     };
 
     struct Diagnostic {
@@ -261,7 +369,42 @@ namespace dark {
         detail::diagnostic_kind_t kind{detail::diagnostic_default_kind};
         DiagnosticLocation location{};
         core::BasicFormatter message{};
-        core::SmallVec<DiagnosticMessage, 2> annotations{};
+        core::ArenaSmallVec<DiagnosticMessage, 2> annotations{};
+        // Set when the emitter defers location conversion. It's run at most once by
+        // `resolve_location()`, so pipelines that never look at the location skip it.
+        DeferredLocation deferred_location{};
+        // Integer key reported by `DiagnosticConverter::location_key`; zero if there's none.
+        // Sorting uses it instead of converting and comparing locations.
+        std::uint64_t location_key{};
+
+        /**
+         * @brief Resets the diagnostic while keeping the capacity of its containers so
+         *        that it can be reused by `DiagnosticPool`.
+         */
+        auto clear() noexcept -> void {
+            level = {};
+            kind = detail::diagnostic_default_kind;
+            location.clear();
+            message.clear();
+            annotations.clear();
+            deferred_location = {};
+            location_key = 0;
+        }
+
+        auto has_deferred_location() const noexcept -> bool {
+            return static_cast<bool>(deferred_location);
+        }
+
+        /**
+         * @brief Converts the deferred location if there is one. Consumers that read
+         *        `location` must call this first.
+         */
+        auto resolve_location() -> DiagnosticLocation& {
+            if (deferred_location) {
+                location = std::exchange(deferred_location, {})();
+            }
+            return location;
+        }
     };
 
     namespace internal {
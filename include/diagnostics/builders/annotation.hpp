@@ -4,6 +4,7 @@
 #include "diagnostic.hpp"
 #include "../span.hpp"
 #include "../core/term/annotated_string.hpp"
+#include <algorithm>
 #include <array>
 
 namespace dark::builder {
@@ -812,9 +813,14 @@ namespace dark::builder {
             DiagnosticSourceLocationTokens tokens,
             std::span<Span> spans
         ) -> void {
+            if (!m_builder->is_enabled()) return;
+            auto scope = m_builder->arena_scope();
             auto& diag = m_builder->m_diagnostic;
-            auto const& source = diag.location.source;
-            auto marker = source.marker();
+            auto needs_marker = std::any_of(spans.begin(), spans.end(), [](Span s) {
+                return s.empty() && s.start() == 0;
+            });
+            // Only force a deferred location when a span has to be replaced by the marker.
+            auto marker = needs_marker ? diag.resolve_location().source.marker() : std::nullopt;
             if (marker) {
                 for (auto& s: spans) {
                     if (s.empty() && s.start() == 0) {
@@ -823,13 +829,13 @@ namespace dark::builder {
                 }
             }
 
-            auto& annotations = diag.annotations;
-            annotations.push_back(DiagnosticMessage {
-                .message = std::move(an),
-                .tokens = std::move(tokens),
-                .spans = { spans },
-                .level = level
-            });
+            // A pooled annotation keeps the storage of its containers.
+            auto message = m_builder->acquire_message();
+            for (auto& s: an.strings) message.message.strings.push_back(std::move(s));
+            for (auto& line: tokens.lines) message.tokens.lines.push_back(std::move(line));
+            for (auto s: spans) message.spans.push_back(s);
+            message.level = level;
+            diag.annotations.push_back(std::move(message));
         }
 
         auto annotate_helper(
@@ -3,6 +3,7 @@
 
 #include "../forward.hpp"
 #include "../core/format.hpp"
+#include "../core/arena.hpp"
 #include <cassert>
 
 namespace dark::builder {
@@ -17,17 +18,29 @@ namespace dark::builder {
         constexpr ~DiagnosticBuilder() = default;
 
         auto emit() -> void {
-            for (auto& annot: m_emitter->m_annotations) {
-                annot(*this);
+            if (!is_enabled()) return;
+            {
+                auto scope = arena_scope();
+                m_emitter->apply_annotations(*this);
             }
-            m_emitter->m_consumer->consume(std::move(m_diagnostic));
+            // Consumers may render or buffer, which should not allocate from the arena.
+            m_emitter->consume(std::move(m_diagnostic));
         }
 
         [[nodiscard("Missing `end_annotation()` call")]] constexpr auto begin_annotation() noexcept -> DiagnosticAnnotationBuilder<LocT>;
+
+        // A disabled builder was rejected by the emitter's filter and drops everything.
+        constexpr auto is_enabled() const noexcept -> bool { return m_emitter != nullptr; }
     private:
         friend struct DiagnosticEmitter<LocT>;
         friend struct DiagnosticAnnotationBuilder<LocT>;
 
+        // Inert builder returned for filtered diagnostics.
+        constexpr DiagnosticBuilder() noexcept
+            : m_emitter(nullptr)
+        {}
+
+        // Must be called while the emitter's arena is installed.
         template <core::IsFormattable... Args>
         DiagnosticBuilder(
             emitter_t* emitter,
@@ -37,6 +50,7 @@ namespace dark::builder {
             core::BasicFormatter formatter
         )
             : m_emitter(emitter)
+            , m_diagnostic(emitter->acquire_diagnostic())
         {
             assert((level != DiagnosticLevel::Note) && "Note messages cannot be a base diagnostic level");
             add_message(std::move(loc), level, base, std::move(formatter));
@@ -49,9 +63,19 @@ namespace dark::builder {
             internal::DiagnosticBase<Args...> const& base,
             core::BasicFormatter formatter
         ) -> void {
+            auto* converter = m_emitter->m_converter;
+            m_diagnostic.location_key = converter->location_key(loc);
+            if constexpr (IsDeferrableLocation<LocT>) {
+                if (m_emitter->m_defer_location && converter->supports_deferred_conversion()) {
+                    add_message(level, DiagnosticLocation{}, base, std::move(formatter));
+                    m_diagnostic.deferred_location = DeferredLocation(converter, loc);
+                    return;
+                }
+            }
+
             add_message(
                 level,
-                m_emitter->m_converter->convert_loc(loc, *this),
+                converter->convert_loc(loc, *this),
                 base,
                 std::move(formatter)
             );
@@ -66,10 +90,29 @@ namespace dark::builder {
         ) -> void {
             m_diagnostic.level = level;
             m_diagnostic.kind = base.kind;
-            m_diagnostic.location = std::move(location);
-            m_diagnostic.message = std::move(formatter);
+            // Assigned into the existing containers so that a pooled diagnostic keeps its capacity.
+            m_diagnostic.location.filename = location.filename;
+            m_diagnostic.location.has_byte_offsets = location.has_byte_offsets;
+            auto& lines = m_diagnostic.location.source.lines;
+            lines.clear();
+            lines.reserve(location.source.lines.size());
+            for (auto& line: location.source.lines) lines.push_back(std::move(line));
+            m_diagnostic.message.assign(std::move(formatter));
             m_diagnostic.annotations.clear();
         }
+
+        auto acquire_message() -> DiagnosticMessage {
+            return m_emitter->acquire_message();
+        }
+
+        /**
+         * @brief Installs the emitter's arena only while the builder itself allocates, so
+         *        scopes always nest and code running between the builder's calls never
+         *        allocates from the arena.
+         */
+        auto arena_scope() const noexcept -> core::Arena::Scope {
+            return core::Arena::Scope(m_emitter->arena());
+        }
     private:
         emitter_t* m_emitter;
         Diagnostic m_diagnostic;
@@ -4,6 +4,7 @@
 #include "../forward.hpp"
 #include "../core/cow_string.hpp"
 #include "../core/term/color.hpp"
+#include "../source/line_index.hpp"
 
 namespace dark::builder {
     struct DiagnosticTokenBuilder {
@@ -24,6 +25,9 @@ namespace dark::builder {
         */
         [[nodiscard("Missing `end_line()` call")]] auto begin_line(dsize_t line_number, dsize_t line_start_offset) -> DiagnosticLineTokenBuilder;
 
+        // Adds a new line from a line index lookup.
+        [[nodiscard("Missing `end_line()` call")]] auto begin_line(SourceLineInfo line) -> DiagnosticLineTokenBuilder;
+
         /**
          * @brief Adds a new text. It'll parse newlines if present.
          * @param line_number line number starts with 1 (1-based index).
@@ -87,6 +91,10 @@ namespace dark::builder {
             return m_builder->begin_line(line_number, line_start_offset);
         }
 
+        [[nodiscard("Missing `end_line()` call")]] auto begin_line(SourceLineInfo line) -> DiagnosticLineTokenBuilder {
+            return begin_line(line.line_number, line.line_start_offset);
+        }
+
         /**
          * @brief Marks the end of line.
         */
@@ -165,5 +173,9 @@ namespace dark::builder {
 
         return DiagnosticLineTokenBuilder(m_tokens.lines.size() - 1, *this);
     }
+
+    inline auto DiagnosticTokenBuilder::begin_line(SourceLineInfo line) -> DiagnosticLineTokenBuilder {
+        return begin_line(line.line_number, line.line_start_offset);
+    }
 } // namespace dark::builder
 #endif // AMT_DARK_DIAGNO
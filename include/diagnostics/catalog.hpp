@@ -0,0 +1,176 @@
+#ifndef AMT_DARK_DIAGNOSTICS_CATALOG_HPP
+#define AMT_DARK_DIAGNOSTICS_CATALOG_HPP
+
+#include "basic.hpp"
+#include "filter.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace dark {
+
+    struct DiagnosticCatalogEntry {
+        detail::diagnostic_kind_t kind{ detail::diagnostic_default_kind };
+        // Rendered as-is inside the brackets, e.g. `Warning[W0042]: ...`.
+        std::string_view code{};
+        // Level used by `DiagnosticEmitter::report`.
+        DiagnosticLevel level{ DiagnosticLevel::Error };
+        bool enabled{ true };
+        std::string_view format{};
+    };
+
+    /**
+     * @brief Type-erased view of a `DiagnosticCatalog` used by the renderer and filters.
+     *        Entries are sorted by kind; when the kinds are contiguous the lookup is a
+     *        single subtraction, otherwise it falls back to a binary search.
+     */
+    struct DiagnosticCatalogView {
+        std::span<DiagnosticCatalogEntry const> entries{};
+        bool dense{ false };
+
+        constexpr auto find(detail::diagnostic_kind_t kind) const noexcept -> DiagnosticCatalogEntry const* {
+            if (entries.empty()) return nullptr;
+            auto index = detail::diagnostic_kind_index(kind);
+            if (dense) {
+                auto first = detail::diagnostic_kind_index(entries.front().kind);
+                if (index < first || index - first >= entries.size()) return nullptr;
+                return &entries[index - first];
+            }
+
+            auto it = std::lower_bound(entries.begin(), entries.end(), index, [](auto const& e, std::size_t k) {
+                return detail::diagnostic_kind_index(e.kind) < k;
+            });
+            if (it == entries.end() || detail::diagnostic_kind_index(it->kind) != index) return nullptr;
+            return &*it;
+        }
+
+        constexpr auto size() const noexcept -> std::size_t { return entries.size(); }
+
+        // Disables every kind whose entry isn't enabled by default.
+        auto apply_defaults(DiagnosticFilter& filter) const -> void {
+            for (auto const& entry: entries) {
+                if (!entry.enabled) filter.disable_kind(entry.kind);
+            }
+        }
+    };
+
+    /**
+     * @brief Compile-time table of diagnostic kinds. Construction is `consteval` and rejects
+     *        duplicate kinds, empty codes, note/fixit default levels and malformed format
+     *        strings.
+     * @code
+     *  static constexpr auto catalog = make_diagnostic_catalog(
+     *      DiagnosticCatalogEntry{ Kind::UnusedVariable, "W0001", DiagnosticLevel::Warning, false, "unused variable '{}'" },
+     *      DiagnosticCatalogEntry{ Kind::InvalidCall, "E0002", DiagnosticLevel::Error, true, "invalid call" }
+     *  );
+     *  static constexpr auto UnusedVariable = dark_make_catalog_diagnostic(catalog, Kind::UnusedVariable, std::string_view);
+     * @endcode
+     */
+    template <std::size_t N>
+    struct DiagnosticCatalog {
+        static_assert(N > 0, "Catalog must have at least one entry");
+
+        consteval DiagnosticCatalog(std::array<DiagnosticCatalogEntry, N> entries)
+            : m_entries(entries)
+        {
+            std::sort(m_entries.begin(), m_entries.end(), [](auto const& l, auto const& r) {
+                return detail::diagnostic_kind_index(l.kind) < detail::diagnostic_kind_index(r.kind);
+            });
+
+            m_dense = true;
+            for (auto i = 0ul; i < N; ++i) {
+                auto const& entry = m_entries[i];
+                if (entry.code.empty()) throw std::invalid_argument("Diagnostic catalog entry must have a code");
+                if (entry.level != DiagnosticLevel::Error && entry.level != DiagnosticLevel::Warning) {
+                    throw std::invalid_argument("Diagnostic catalog entry must default to an error or a warning");
+                }
+                if (!is_valid_format(entry.format)) throw std::invalid_argument("Diagnostic catalog entry has a malformed format string");
+                if (i == 0) continue;
+
+                auto prev = detail::diagnostic_kind_index(m_entries[i - 1].kind);
+                auto curr = detail::diagnostic_kind_index(entry.kind);
+                if (prev == curr) throw std::invalid_argument("Diagnostic catalog has duplicate kinds");
+                m_dense &= (curr - prev == 1);
+            }
+        }
+
+        constexpr auto find(detail::diagnostic_kind_t kind) const noexcept -> DiagnosticCatalogEntry const* {
+            return view().find(kind);
+        }
+
+        // Only valid in constant expressions since a missing kind doesn't have a format.
+        consteval auto format(detail::diagnostic_kind_t kind) const -> std::string_view {
+            auto const* entry = find(kind);
+            if (entry == nullptr) throw std::invalid_argument("Kind is not in the diagnostic catalog");
+            return entry->format;
+        }
+
+        constexpr auto view() const noexcept -> DiagnosticCatalogView {
+            return { .entries = std::span(m_entries), .dense = m_dense };
+        }
+
+        constexpr auto entries() const noexcept -> std::span<DiagnosticCatalogEntry const> { return m_entries; }
+        constexpr auto is_dense() const noexcept -> bool { return m_dense; }
+        static constexpr auto size() noexcept -> std::size_t { return N; }
+    private:
+        // Arguments are validated against the format by `core::format_string` once the
+        // argument types are known; this only rejects unbalanced braces.
+        static consteval auto is_valid_format(std::string_view fmt) -> bool {
+            for (auto i = 0ul; i < fmt.size(); ++i) {
+                if (fmt[i] == '}') {
+                    if (i + 1 < fmt.size() && fmt[i + 1] == '}') { ++i; continue; }
+                    return false;
+                }
+                if (fmt[i] != '{') continue;
+                if (i + 1 < fmt.size() && fmt[i + 1] == '{') { ++i; continue; }
+                auto end = fmt.find('}', i);
+                if (end == std::string_view::npos) return false;
+                if (fmt.substr(i + 1, end - i - 1).find('{') != std::string_view::npos) return false;
+                i = end;
+            }
+            return true;
+        }
+    private:
+        std::array<DiagnosticCatalogEntry, N> m_entries;
+        bool m_dense{ false };
+    };
+
+    /**
+     * @brief Code the renderer prints inside the brackets: the catalog's code, or the level
+     *        prefix followed by the zero-padded kind, e.g. `E0042`.
+     */
+    static inline auto diagnostic_code(
+        detail::diagnostic_kind_t kind,
+        DiagnosticLevel level,
+        DiagnosticCatalogView catalog = {},
+        unsigned padding = 4
+    ) -> std::string {
+        if (auto const* entry = catalog.find(kind)) return std::string(entry->code);
+
+        char digits[24];
+        auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), detail::diagnostic_kind_index(kind));
+        auto number = std::string_view(digits, static_cast<std::size_t>(end - digits));
+
+        auto code = std::string(diagnostic_level_code_prefix(level));
+        if (number.size() < padding) code.append(padding - number.size(), '0');
+        code.append(number);
+        return code;
+    }
+
+    template <std::same_as<DiagnosticCatalogEntry>... Es>
+    consteval auto make_diagnostic_catalog(Es... entries) -> DiagnosticCatalog<sizeof...(Es)> {
+        return DiagnosticCatalog<sizeof...(Es)>(std::array<DiagnosticCatalogEntry, sizeof...(Es)>{ entries... });
+    }
+
+} // namespace dark
+
+// Builds a diagnostic from a constexpr catalog; the format is checked against the argument types.
+#define dark_make_catalog_diagnostic(Catalog, DiagnosticKind, ...) dark::internal::DiagnosticBase<__VA_ARGS__>((DiagnosticKind), (Catalog).format(DiagnosticKind))
+
+#endif // AMT_DARK_DIAGNOSTICS_CATALOG_HPP
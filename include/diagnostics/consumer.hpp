@@ -1,7 +1,12 @@
 #ifndef AMT_DARK_DIAGNOSTICS_CONSUMER_HPP
 #define AMT_DARK_DIAGNOSTICS_CONSUMER_HPP
 
+#include "consumers/async.hpp"
+#include "consumers/dedup.hpp"
 #include "consumers/error_tracking.hpp"
+#include "consumers/json.hpp"
+#include "consumers/parallel.hpp"
+#include "consumers/sarif.hpp"
 #include "consumers/sorting.hpp"
 #include "consumers/stream.hpp"
 
@@ -0,0 +1,155 @@
+#ifndef AMT_DARK_DIAGNOSTICS_CONSUMERS_ASYNC_HPP
+#define AMT_DARK_DIAGNOSTICS_CONSUMERS_ASYNC_HPP
+
+#include "base.hpp"
+#include "../core/small_vec.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
+
+namespace dark {
+
+    /**
+     * @brief Hands diagnostics to a dedicated thread that forwards them to `consumer`,
+     *        usually a `StreamDiagnosticConsumer`, so rendering and terminal writes never
+     *        run on the emitting thread. Emitting costs a move and an enqueue; it only
+     *        blocks when `capacity` diagnostics are already waiting.
+     *
+     *        `flush()` waits until everything consumed before it has been forwarded and
+     *        the downstream consumer has been flushed. An exception thrown downstream is
+     *        rethrown from the next `flush()`.
+     * @note The downstream consumer is only touched by the render thread. Deferred
+     *       locations are converted there too, and diagnostics backed by an arena must
+     *       be flushed before the arena is reset.
+     */
+    struct AsyncDiagnosticConsumer: DiagnosticConsumer {
+        static constexpr std::size_t default_capacity = 1024;
+
+        explicit AsyncDiagnosticConsumer(
+            DiagnosticConsumer* consumer,
+            std::size_t capacity = default_capacity
+        )
+            : m_consumer(consumer)
+            , m_capacity(std::max(capacity, std::size_t{1}))
+        {
+            m_queue.reserve(m_capacity);
+            m_worker = std::thread([this] { run(); });
+        }
+        AsyncDiagnosticConsumer(AsyncDiagnosticConsumer const&) = delete;
+        AsyncDiagnosticConsumer(AsyncDiagnosticConsumer &&) = delete;
+        AsyncDiagnosticConsumer& operator=(AsyncDiagnosticConsumer const&) = delete;
+        AsyncDiagnosticConsumer& operator=(AsyncDiagnosticConsumer &&) = delete;
+
+        // Forwards the diagnostics that are still queued; it doesn't flush downstream.
+        ~AsyncDiagnosticConsumer() noexcept override {
+            {
+                auto lock = std::lock_guard(m_mutex);
+                m_stop = true;
+            }
+            m_has_work.notify_one();
+            m_worker.join();
+        }
+
+        auto consume(Diagnostic&& d) -> void override {
+            {
+                auto lock = std::unique_lock(m_mutex);
+                m_has_space.wait(lock, [this] { return m_queue.size() < m_capacity; });
+                m_queue.push_back(std::move(d));
+            }
+            m_has_work.notify_one();
+        }
+
+        // Enqueues the batch in chunks that fit into the queue.
+        auto consume_batch(std::span<Diagnostic> diagnostics) -> void override {
+            while (!diagnostics.empty()) {
+                {
+                    auto lock = std::unique_lock(m_mutex);
+                    m_has_space.wait(lock, [this] { return m_queue.size() < m_capacity; });
+                    auto count = std::min(diagnostics.size(), m_capacity - m_queue.size());
+                    for (auto& d: diagnostics.first(count)) m_queue.push_back(std::move(d));
+                    diagnostics = diagnostics.subspan(count);
+                }
+                m_has_work.notify_one();
+            }
+        }
+
+        auto flush() -> void override {
+            auto lock = std::unique_lock(m_mutex);
+            auto ticket = ++m_flush_requested;
+            m_has_work.notify_one();
+            m_flushed.wait(lock, [this, ticket] { return m_flush_completed >= ticket; });
+            if (m_error) std::rethrow_exception(std::exchange(m_error, nullptr));
+        }
+
+        // Approximate number of diagnostics waiting for the render thread.
+        auto pending() const -> std::size_t {
+            auto lock = std::lock_guard(m_mutex);
+            return m_queue.size();
+        }
+
+        constexpr auto capacity() const noexcept -> std::size_t { return m_capacity; }
+
+    private:
+        auto run() -> void {
+            auto batch = core::SmallVec<Diagnostic, 0>{};
+            batch.reserve(m_capacity);
+
+            while (true) {
+                auto flush_ticket = std::uint64_t{};
+                {
+                    auto lock = std::unique_lock(m_mutex);
+                    m_has_work.wait(lock, [this] {
+                        return !m_queue.empty() || m_flush_completed < m_flush_requested || m_stop;
+                    });
+                    if (m_queue.empty() && m_flush_completed == m_flush_requested && m_stop) return;
+
+                    // Everything consumed before a flush request is already in the queue, so
+                    // it's forwarded before the downstream flush below.
+                    swap(batch, m_queue);
+                    flush_ticket = m_flush_requested;
+                }
+                m_has_space.notify_all();
+
+                try {
+                    if (!batch.empty()) m_consumer->consume_batch(std::span(batch.data(), batch.size()));
+                    if (flush_ticket > m_flush_completed) m_consumer->flush();
+                } catch (...) {
+                    auto lock = std::lock_guard(m_mutex);
+                    if (!m_error) m_error = std::current_exception();
+                }
+                batch.clear();
+
+                if (flush_ticket > m_flush_completed) {
+                    {
+                        auto lock = std::lock_guard(m_mutex);
+                        m_flush_completed = flush_ticket;
+                    }
+                    m_flushed.notify_all();
+                }
+            }
+        }
+
+    private:
+        DiagnosticConsumer* m_consumer;
+        std::size_t m_capacity;
+        core::SmallVec<Diagnostic, 0> m_queue{};
+        mutable std::mutex m_mutex;
+        std::condition_variable m_has_work;
+        std::condition_variable m_has_space;
+        std::condition_variable m_flushed;
+        std::uint64_t m_flush_requested{};
+        std::uint64_t m_flush_completed{};
+        std::exception_ptr m_error{};
+        bool m_stop{false};
+        std::thread m_worker;
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_CONSUMERS_ASYNC_HPP
@@ -3,11 +3,21 @@
 
 #include "../basic.hpp"
 #include <cassert>
+#include <span>
 
 namespace dark {
     struct DiagnosticConsumer {
         virtual ~DiagnosticConsumer() = default;
         virtual auto consume(Diagnostic&& diagnostic) -> void = 0;
+
+        /**
+         * @brief Consumes many diagnostics at once; the diagnostics are moved from. Consumers
+         *        that forward or render in bulk override it to pay for dispatch and locking once.
+         */
+        virtual auto consume_batch(std::span<Diagnostic> diagnostics) -> void {
+            for (auto& d: diagnostics) consume(std::move(d));
+        }
+
         virtual auto flush() -> void {}
     };
 } // namespace dark
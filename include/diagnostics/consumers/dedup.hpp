@@ -0,0 +1,133 @@
+#ifndef AMT_DARK_DIAGNOSTICS_CONSUMERS_DEDUP_HPP
+#define AMT_DARK_DIAGNOSTICS_CONSUMERS_DEDUP_HPP
+
+#include "base.hpp"
+#include "../core/hash.hpp"
+#include "../pool.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace dark {
+
+    namespace detail {
+        // The start and size are combined separately since either may take all 64 bits
+        // with `DARK_DIAGNOSTICS_LARGE_FILES`.
+        inline auto fingerprint_span(std::uint64_t h, Span span) noexcept -> std::uint64_t {
+            h = core::hash_combine(h, static_cast<std::uint64_t>(span.start()));
+            return core::hash_combine(h, static_cast<std::uint64_t>(span.size()));
+        }
+
+        inline auto fingerprint_tokens(std::uint64_t h, DiagnosticSourceLocationTokens const& tokens) noexcept -> std::uint64_t {
+            for (auto const& line: tokens.lines) {
+                for (auto const& tok: line.tokens) {
+                    h = core::hash_combine(h, core::hash_string(tok.text.to_borrowed()));
+                    h = fingerprint_span(h, tok.marker);
+                }
+            }
+            return h;
+        }
+    } // namespace detail
+
+    /**
+     * @brief Structural 64-bit fingerprint over the level, kind, filename, marker span,
+     *        format string, argument payloads and annotations. The message is never
+     *        formatted.
+     * @note The filename and marker come from the location, so a deferred location is
+     *       converted here rather than later in the chain; deduplication therefore gives
+     *       up the savings of `defer_location_conversion`.
+     */
+    inline auto diagnostic_fingerprint(Diagnostic& d) -> std::uint64_t {
+        auto& location = d.resolve_location();
+        auto h = core::hash_mix(static_cast<std::uint64_t>(d.level) + 1);
+        h = core::hash_combine(h, static_cast<std::uint64_t>(detail::diagnostic_kind_index(d.kind)));
+        h = core::hash_combine(h, core::hash_string(location.filename));
+        if (auto marker = location.source.marker()) {
+            h = detail::fingerprint_span(h, *marker);
+        }
+        h = core::hash_combine(h, d.message.hash());
+
+        for (auto const& annotation: d.annotations) {
+            h = core::hash_combine(h, static_cast<std::uint64_t>(annotation.level));
+            for (auto const& [text, _]: annotation.message.strings) {
+                h = core::hash_combine(h, core::hash_string(text.to_borrowed()));
+            }
+            for (auto span: annotation.spans) {
+                h = detail::fingerprint_span(h, span);
+            }
+            h = detail::fingerprint_tokens(h, annotation.tokens);
+        }
+        return h;
+    }
+
+    /**
+     * @brief Drops diagnostics that are structurally identical to one that was already
+     *        forwarded, so repeats never reach the renderer. Fingerprints are kept until
+     *        `reset()`, which makes duplicates across flushes disappear as well.
+     * @note Only the fingerprints are kept, since the diagnostics themselves move on down
+     *       the chain, so a hit is not compared field by field. Two different diagnostics
+     *       with the same fingerprint lose the later one; among n distinct diagnostics the
+     *       chance of that is about n^2 / 2^65, e.g. 3e-8 for a million of them.
+     */
+    struct DedupDiagnosticConsumer: DiagnosticConsumer {
+        explicit DedupDiagnosticConsumer(DiagnosticConsumer* consumer) noexcept
+            : m_consumer(consumer)
+        {}
+        DedupDiagnosticConsumer(DedupDiagnosticConsumer const&) = default;
+        DedupDiagnosticConsumer(DedupDiagnosticConsumer &&) noexcept = default;
+        DedupDiagnosticConsumer& operator=(DedupDiagnosticConsumer const&) = default;
+        DedupDiagnosticConsumer& operator=(DedupDiagnosticConsumer &&) noexcept = default;
+        ~DedupDiagnosticConsumer() noexcept override = default;
+
+        auto consume(Diagnostic&& d) -> void override {
+            if (!m_seen.insert(diagnostic_fingerprint(d))) {
+                ++m_dropped;
+                recycle(std::move(d));
+                return;
+            }
+            m_consumer->consume(std::move(d));
+        }
+
+        auto consume_batch(std::span<Diagnostic> diagnostics) -> void override {
+            // Compact the unique diagnostics to the front and forward them in one call.
+            auto unique = std::size_t{};
+            for (auto& d: diagnostics) {
+                if (!m_seen.insert(diagnostic_fingerprint(d))) {
+                    ++m_dropped;
+                    recycle(std::move(d));
+                    continue;
+                }
+                if (&diagnostics[unique] != &d) diagnostics[unique] = std::move(d);
+                ++unique;
+            }
+            if (unique != 0) m_consumer->consume_batch(diagnostics.first(unique));
+        }
+
+        auto flush() -> void override { m_consumer->flush(); }
+
+        // Number of diagnostics dropped since the last reset.
+        constexpr auto dropped() const noexcept -> std::size_t { return m_dropped; }
+
+        auto reset() noexcept -> void {
+            m_seen.clear();
+            m_dropped = 0;
+        }
+
+        // Dropped duplicates are handed back to the pool, usually `emitter.pool()`.
+        constexpr auto set_pool(DiagnosticPool* pool) noexcept -> void { m_pool = pool; }
+
+    private:
+        auto recycle(Diagnostic&& d) -> void {
+            if (m_pool) m_pool->release(std::move(d));
+        }
+    private:
+        DiagnosticConsumer* m_consumer;
+        DiagnosticPool* m_pool{nullptr};
+        core::FingerprintSet m_seen{};
+        std::size_t m_dropped{};
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_CONSUMERS_DEDUP_HPP
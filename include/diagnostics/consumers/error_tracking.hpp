@@ -3,6 +3,7 @@
 
 #include "base.hpp"
 #include <cassert>
+#include <cstddef>
 
 namespace dark {
     struct ErrorTrackingDiagnosticConsumer: DiagnosticConsumer {
@@ -16,20 +17,33 @@ namespace dark {
         ~ErrorTrackingDiagnosticConsumer() noexcept override = default;
 
         auto consume(Diagnostic&& d) -> void override {
-            m_seen_error |= d.level == DiagnosticLevel::Error;
+            m_error_count += d.level == DiagnosticLevel::Error;
+            m_warning_count += d.level == DiagnosticLevel::Warning;
             m_consumer->consume(std::move(d));
         }
 
+        auto consume_batch(std::span<Diagnostic> diagnostics) -> void override {
+            for (auto const& d: diagnostics) {
+                m_error_count += d.level == DiagnosticLevel::Error;
+                m_warning_count += d.level == DiagnosticLevel::Warning;
+            }
+            m_consumer->consume_batch(diagnostics);
+        }
+
         auto flush() -> void override { m_consumer->flush(); }
 
-        constexpr auto seen_error() const noexcept -> bool { return m_seen_error; }
+        constexpr auto seen_error() const noexcept -> bool { return m_error_count != 0; }
+        constexpr auto error_count() const noexcept -> std::size_t { return m_error_count; }
+        constexpr auto warning_count() const noexcept -> std::size_t { return m_warning_count; }
 
         constexpr auto reset() noexcept -> void {
-            m_seen_error = false;
+            m_error_count = 0;
+            m_warning_count = 0;
         }
     private:
         DiagnosticConsumer* m_consumer;
-        bool m_seen_error{false};
+        std::size_t m_error_count{};
+        std::size_t m_warning_count{};
     };
 } // namespace dark
 
@@ -0,0 +1,256 @@
+#ifndef AMT_DARK_DIAGNOSTICS_CONSUMERS_JSON_HPP
+#define AMT_DARK_DIAGNOSTICS_CONSUMERS_JSON_HPP
+
+#include "base.hpp"
+#include "../catalog.hpp"
+#include "../core/buffer.hpp"
+#include "../core/json_writer.hpp"
+#include "../pool.hpp"
+#include "../renderer.hpp"
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+namespace dark {
+
+    // Options shared by the machine-readable consumers.
+    struct DiagnosticSerializeConfig {
+        // Kinds found in the catalog are reported with its code.
+        DiagnosticCatalogView catalog{};
+        unsigned diagnostic_kind_padding{4};
+    };
+
+} // namespace dark
+
+namespace dark::internal {
+
+    constexpr auto diagnostic_level_json_name(DiagnosticLevel level) noexcept -> std::string_view {
+        switch (level) {
+            case DiagnosticLevel::Help: return "help";
+            case DiagnosticLevel::Note: return "note";
+            case DiagnosticLevel::Warning: return "warning";
+            case DiagnosticLevel::Error: return "error";
+            case DiagnosticLevel::Insert: return "insert";
+            case DiagnosticLevel::Delete: return "delete";
+        }
+        return {};
+    }
+
+    constexpr auto is_fixit(DiagnosticLevel level) noexcept -> bool {
+        return level == DiagnosticLevel::Insert || level == DiagnosticLevel::Delete;
+    }
+
+    // Same code the renderer prints inside the brackets, e.g. `E0042`.
+    static inline auto write_diagnostic_code(
+        core::JsonWriter& w,
+        Diagnostic const& diag,
+        DiagnosticSerializeConfig const& config
+    ) -> void {
+        if (auto const* entry = config.catalog.find(diag.kind)) {
+            w.value(entry->code);
+            return;
+        }
+
+        char digits[24];
+        auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), detail::diagnostic_kind_index(diag.kind));
+        auto number = std::string_view(digits, static_cast<std::size_t>(end - digits));
+
+        w.begin_string().append_string(diagnostic_level_code_prefix(diag.level));
+        for (auto i = number.size(); i < config.diagnostic_kind_padding; ++i) w.append_string("0");
+        w.append_string(number).end_string();
+    }
+
+    /**
+     * @brief Line and 1-based byte column of an absolute offset, looked up in the source
+     *        lines of the location; both are zero if the offset isn't on any of them.
+     */
+    static inline auto source_position_of(
+        DiagnosticLocation const& location,
+        dsize_t offset
+    ) noexcept -> std::pair<dsize_t, dsize_t> {
+        auto const* found = static_cast<DiagnosticLineTokens const*>(nullptr);
+        for (auto const& line: location.source.lines) {
+            if (line.line_start_offset > offset) break;
+            found = &line;
+        }
+        if (!found) return { 0, 0 };
+        return { found->line_number, offset - found->line_start_offset + 1 };
+    }
+
+    static inline auto write_json_span(
+        core::JsonWriter& w,
+        DiagnosticLocation const& location,
+        Span span
+    ) -> void {
+        w.begin_object();
+        if (location.has_byte_offsets) w.member("start", span.start()).member("end", span.end());
+        auto [line, column] = source_position_of(location, span.start());
+        if (line != 0) w.member("line", line).member("column", column);
+        w.end_object();
+    }
+
+    static inline auto write_annotated_string(core::JsonWriter& w, term::AnnotatedString const& str) -> void {
+        w.begin_string();
+        for (auto const& [text, style]: str.strings) w.append_string(text.to_borrowed());
+        w.end_string();
+    }
+
+    // Concatenates the text of the tokens to be inserted; lines are separated by a newline.
+    static inline auto write_inserted_text(core::JsonWriter& w, DiagnosticSourceLocationTokens const& tokens) -> void {
+        w.begin_string();
+        for (auto i = std::size_t{}; i < tokens.lines.size(); ++i) {
+            if (i != 0) w.append_string("\n");
+            for (auto const& tok: tokens.lines[i].tokens) w.append_string(tok.text.to_borrowed());
+        }
+        w.end_string();
+    }
+
+    static inline auto write_diagnostic_json(
+        core::JsonWriter& w,
+        Diagnostic const& diag,
+        DiagnosticSerializeConfig const& config
+    ) -> void {
+        auto const& location = diag.location;
+
+        w.begin_object()
+            .member("level", diagnostic_level_json_name(diag.level))
+            .member("kind", detail::diagnostic_kind_index(diag.kind));
+        w.key("code");
+        write_diagnostic_code(w, diag, config);
+        w.member("message", diag.message.format().to_borrowed());
+
+        w.key("location").begin_object().member("file", location.filename);
+        if (!location.source.empty()) {
+            auto [line, column] = location.line_info();
+            if (line != 0) w.member("line", line).member("column", column);
+            w.key("span");
+            write_json_span(w, location, location.source.marker().value_or(location.source.span()));
+        }
+        w.end_object();
+
+        w.key("annotations").begin_array();
+        for (auto const& note: diag.annotations) {
+            if (is_fixit(note.level)) continue;
+            w.begin_object().member("level", diagnostic_level_json_name(note.level));
+            w.key("message");
+            write_annotated_string(w, note.message);
+            w.key("spans").begin_array();
+            for (auto span: note.spans) write_json_span(w, location, span);
+            w.end_array().end_object();
+        }
+        w.end_array();
+
+        w.key("fixits").begin_array();
+        for (auto const& fix: diag.annotations) {
+            if (!is_fixit(fix.level)) continue;
+            w.begin_object().member("kind", diagnostic_level_json_name(fix.level));
+            w.key("message");
+            write_annotated_string(w, fix.message);
+            w.key("spans").begin_array();
+            for (auto span: fix.spans) write_json_span(w, location, span);
+            w.end_array();
+            if (fix.level == DiagnosticLevel::Insert) {
+                w.key("text");
+                write_inserted_text(w, fix.tokens);
+            }
+            w.end_object();
+        }
+        w.end_array();
+
+        w.end_object();
+    }
+
+    // Hands the buffered bytes to stdio and keeps the buffer's capacity.
+    static inline auto write_buffer_to(FILE* file, core::Buffer& buffer) -> void {
+        if (buffer.empty()) return;
+        if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+            throw std::runtime_error("Failed to write diagnostics");
+        }
+        buffer.clear();
+    }
+
+} // namespace dark::internal
+
+namespace dark {
+
+    /**
+     * @brief Writes every diagnostic as one JSON object per line. The `Diagnostic` is
+     *        serialized directly, so no layout or rasterization is done:
+     * @code
+     *  {"level":"error","kind":1,"code":"E0001","message":"...",
+     *   "location":{"file":"a.cpp","line":1,"column":1,"span":{"start":0,"end":4,"line":1,"column":1}},
+     *   "annotations":[{"level":"note","message":"...","spans":[...]}],
+     *   "fixits":[{"kind":"insert","message":"...","spans":[...],"text":"..."}]}
+     * @endcode
+     *        Offsets are absolute byte offsets and columns are 1-based byte columns. Spans of
+     *        locations without byte offsets, e.g. of a transcoded file, only have the line
+     *        and column. The output is buffered and written once it grows beyond
+     *        `max_buffered_bytes` or on flush.
+     */
+    struct JsonLinesDiagnosticConsumer: DiagnosticConsumer {
+        static constexpr std::size_t max_buffered_bytes = 64 * 1024;
+
+        explicit JsonLinesDiagnosticConsumer(
+            FILE* file,
+            DiagnosticSerializeConfig config = {}
+        ) noexcept
+            : m_file(file)
+            , m_config(config)
+        {}
+        JsonLinesDiagnosticConsumer(JsonLinesDiagnosticConsumer const&) = delete;
+        JsonLinesDiagnosticConsumer(JsonLinesDiagnosticConsumer &&) = delete;
+        JsonLinesDiagnosticConsumer& operator=(JsonLinesDiagnosticConsumer const&) = delete;
+        JsonLinesDiagnosticConsumer& operator=(JsonLinesDiagnosticConsumer &&) = delete;
+
+        ~JsonLinesDiagnosticConsumer() noexcept override {
+            try {
+                internal::write_buffer_to(m_file, m_buffer);
+            } catch (...) {}
+        }
+
+        auto consume(Diagnostic&& d) -> void override {
+            serialize(d);
+            if (m_buffer.size() >= max_buffered_bytes) internal::write_buffer_to(m_file, m_buffer);
+            recycle(std::move(d));
+        }
+
+        auto consume_batch(std::span<Diagnostic> diagnostics) -> void override {
+            for (auto& d: diagnostics) {
+                serialize(d);
+                recycle(std::move(d));
+            }
+            internal::write_buffer_to(m_file, m_buffer);
+        }
+
+        auto flush() -> void override {
+            internal::write_buffer_to(m_file, m_buffer);
+            std::fflush(m_file);
+        }
+
+        // Serialized diagnostics are handed back to the pool, usually `emitter.pool()`.
+        constexpr auto set_pool(DiagnosticPool* pool) noexcept -> void { m_pool = pool; }
+
+    private:
+        auto serialize(Diagnostic& d) -> void {
+            d.resolve_location();
+            auto w = core::JsonWriter(m_buffer);
+            internal::write_diagnostic_json(w, d, m_config);
+            m_buffer.push_back('\n');
+        }
+
+        auto recycle(Diagnostic&& d) -> void {
+            if (m_pool) m_pool->release(std::move(d));
+        }
+    private:
+        FILE* m_file;
+        DiagnosticSerializeConfig m_config{};
+        DiagnosticPool* m_pool{nullptr};
+        core::Buffer m_buffer{};
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_CONSUMERS_JSON_HPP
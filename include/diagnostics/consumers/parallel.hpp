@@ -0,0 +1,174 @@
+#ifndef AMT_DARK_DIAGNOSTICS_CONSUMERS_PARALLEL_HPP
+#define AMT_DARK_DIAGNOSTICS_CONSUMERS_PARALLEL_HPP
+
+#include "base.hpp"
+#include "../core/buffer.hpp"
+#include "../core/small_vec.hpp"
+#include "../core/term/terminal.hpp"
+#include "../executor.hpp"
+#include "../pool.hpp"
+#include "../renderer.hpp"
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+
+namespace dark {
+
+    /**
+     * @brief Renders batches of diagnostics on an executor and writes them to `file` in
+     *        the order they were consumed. Every diagnostic is rendered into its own buffer,
+     *        and whichever thread completes the next diagnostic in line writes out every
+     *        buffer that is ready, so output overlaps with rendering.
+     *
+     *        It's meant to sit behind a `SortingDiagnosticConsumer`, whose flush hands over
+     *        the whole build at once. Single diagnostics are held back until the next batch
+     *        or flush.
+     *
+     *        If rendering a diagnostic throws, the diagnostics before it are still written
+     *        and everything from it onwards is dropped, so the output never has gaps. The
+     *        exception is rethrown once the batch is done.
+     * @note Deferred locations are converted on the executor's threads, so the converter
+     *       must be safe to call concurrently. Without an executor it renders serially.
+     */
+    struct ParallelDiagnosticConsumer: DiagnosticConsumer {
+        explicit ParallelDiagnosticConsumer(
+            FILE* file,
+            DiagnosticExecutor* executor,
+            DiagnosticRenderConfig config = {},
+            TerminalColorMode mode = TerminalColorMode::Auto
+        ) noexcept
+            : m_out(file, mode)
+            , m_executor(executor)
+            , m_config(config)
+        {}
+        ParallelDiagnosticConsumer(ParallelDiagnosticConsumer const&) = delete;
+        ParallelDiagnosticConsumer(ParallelDiagnosticConsumer &&) = delete;
+        ParallelDiagnosticConsumer& operator=(ParallelDiagnosticConsumer const&) = delete;
+        ParallelDiagnosticConsumer& operator=(ParallelDiagnosticConsumer &&) = delete;
+
+        #ifdef NDEBUG
+        ~ParallelDiagnosticConsumer() noexcept override = default;
+        #else
+        ~ParallelDiagnosticConsumer() noexcept override {
+            assert(m_pending.empty() && "Diagnostics are not flushed");
+        }
+        #endif
+
+        auto consume(Diagnostic&& d) -> void override {
+            m_pending.emplace_back(std::move(d));
+        }
+
+        auto consume_batch(std::span<Diagnostic> diagnostics) -> void override {
+            if (m_pending.empty()) {
+                render(diagnostics);
+                return;
+            }
+            m_pending.reserve(m_pending.size() + diagnostics.size());
+            for (auto& d: diagnostics) m_pending.emplace_back(std::move(d));
+            render_pending();
+        }
+
+        auto flush() -> void override {
+            render_pending();
+            m_out.flush();
+        }
+
+        // Rendered diagnostics are handed back to the pool, usually `emitter.pool()`.
+        constexpr auto set_pool(DiagnosticPool* pool) noexcept -> void { m_pool = pool; }
+
+    private:
+        // The pending diagnostics are moved from or dropped either way, so they're cleared
+        // even if rendering throws.
+        auto render_pending() -> void {
+            try {
+                render(std::span(m_pending.data(), m_pending.size()));
+            } catch (...) {
+                m_pending.clear();
+                throw;
+            }
+            m_pending.clear();
+        }
+
+        auto render(std::span<Diagnostic> diagnostics) -> void {
+            auto count = diagnostics.size();
+            if (count == 0) return;
+
+            // Buffers keep their capacity between batches.
+            while (m_buffers.size() < count) m_buffers.emplace_back();
+
+            auto columns = m_out.columns();
+            auto mode = m_out.colors_enabled() ? TerminalColorMode::Enable : TerminalColorMode::Disable;
+            auto ready = std::make_unique<std::atomic<bool>[]>(count);
+            auto next = std::size_t{};
+            auto sequencer = std::mutex{};
+
+            // Writes the ready prefix; must be called with `sequencer` held.
+            auto write_ready = [&] {
+                for (; next < count && ready[next].load(std::memory_order_acquire); ++next) {
+                    m_out.write(m_buffers[next].view());
+                    m_buffers[next].clear();
+                    recycle(std::move(diagnostics[next]));
+                }
+            };
+
+            auto task = [&](std::size_t i) {
+                {
+                    auto term = Terminal<core::Buffer>(Writer<core::Buffer>(m_buffers[i], columns), mode);
+                    render_diagnostic(term, diagnostics[i], m_config);
+                    term.write("\n");
+                }
+                ready[i].store(true, std::memory_order_release);
+
+                // Whoever holds the sequencer writes this buffer; whatever is left when
+                // the executor returns is written below.
+                auto lock = std::unique_lock(sequencer, std::try_to_lock);
+                if (lock.owns_lock()) write_ready();
+            };
+
+            auto failure = std::exception_ptr{};
+            try {
+                if (m_executor) {
+                    m_executor->parallel_for(count, task);
+                } else {
+                    for (auto i = std::size_t{}; i < count; ++i) task(i);
+                }
+            } catch (...) {
+                failure = std::current_exception();
+            }
+
+            try {
+                // A diagnostic that failed is never marked ready, so this stops right before it.
+                auto lock = std::lock_guard(sequencer);
+                write_ready();
+            } catch (...) {
+                if (!failure) failure = std::current_exception();
+            }
+
+            if (failure) {
+                // Drops the rendered diagnostics after the failure so that the next batch
+                // starts with empty buffers.
+                for (auto i = next; i < count; ++i) m_buffers[i].clear();
+                std::rethrow_exception(failure);
+            }
+        }
+
+        auto recycle(Diagnostic&& d) -> void {
+            if (m_pool) m_pool->release(std::move(d));
+        }
+    private:
+        Terminal<FILE*> m_out;
+        DiagnosticExecutor* m_executor;
+        DiagnosticRenderConfig m_config{};
+        DiagnosticPool* m_pool{nullptr};
+        core::SmallVec<Diagnostic, 0> m_pending{};
+        core::SmallVec<core::Buffer, 0> m_buffers{};
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_CONSUMERS_PARALLEL_HPP
@@ -0,0 +1,234 @@
+#ifndef AMT_DARK_DIAGNOSTICS_CONSUMERS_SARIF_HPP
+#define AMT_DARK_DIAGNOSTICS_CONSUMERS_SARIF_HPP
+
+#include "base.hpp"
+#include "json.hpp"
+#include "../core/buffer.hpp"
+#include "../core/json_writer.hpp"
+#include "../pool.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace dark::internal {
+
+    constexpr auto diagnostic_level_sarif_name(DiagnosticLevel level) noexcept -> std::string_view {
+        switch (level) {
+            case DiagnosticLevel::Error: return "error";
+            case DiagnosticLevel::Warning: return "warning";
+            default: return "note";
+        }
+    }
+
+    // SARIF regions use byte offsets, so no column kind has to be declared for the run.
+    // Locations without byte offsets only get the line.
+    static inline auto write_sarif_physical_location(
+        core::JsonWriter& w,
+        DiagnosticLocation const& location,
+        std::optional<Span> span
+    ) -> void {
+        w.key("physicalLocation").begin_object();
+        w.key("artifactLocation").begin_object().member("uri", location.filename).end_object();
+        auto line = span ? source_position_of(location, span->start()).first : dsize_t{};
+        if (span && (line != 0 || location.has_byte_offsets)) {
+            w.key("region").begin_object();
+            if (line != 0) w.member("startLine", line);
+            if (location.has_byte_offsets) w.member("byteOffset", span->start()).member("byteLength", span->size());
+            w.end_object();
+        }
+        w.end_object();
+    }
+
+    static inline auto write_sarif_result(
+        core::JsonWriter& w,
+        Diagnostic const& diag,
+        DiagnosticSerializeConfig const& config
+    ) -> void {
+        auto const& location = diag.location;
+
+        w.begin_object();
+        w.key("ruleId");
+        write_diagnostic_code(w, diag, config);
+        w.member("level", diagnostic_level_sarif_name(diag.level));
+        w.key("message").begin_object().member("text", diag.message.format().to_borrowed()).end_object();
+
+        w.key("locations").begin_array().begin_object();
+        auto primary = location.source.empty()
+            ? std::optional<Span>{}
+            : std::optional<Span>(location.source.marker().value_or(location.source.span()));
+        write_sarif_physical_location(w, location, primary);
+        w.end_object().end_array();
+
+        auto id = 0u;
+        w.key("relatedLocations").begin_array();
+        for (auto const& note: diag.annotations) {
+            if (is_fixit(note.level)) continue;
+            for (auto span: note.spans) {
+                w.begin_object().member("id", id++);
+                if (note.message.size() != 0) {
+                    w.key("message").begin_object().key("text");
+                    write_annotated_string(w, note.message);
+                    w.end_object();
+                }
+                write_sarif_physical_location(w, location, span);
+                w.end_object();
+            }
+        }
+        w.end_array();
+
+        // A replacement needs an exact region, so fixes are only written with byte offsets.
+        w.key("fixes").begin_array();
+        for (auto const& fix: diag.annotations) {
+            if (!is_fixit(fix.level) || !location.has_byte_offsets) continue;
+            w.begin_object();
+            if (fix.message.size() != 0) {
+                w.key("description").begin_object().key("text");
+                write_annotated_string(w, fix.message);
+                w.end_object();
+            }
+            w.key("artifactChanges").begin_array().begin_object();
+            w.key("artifactLocation").begin_object().member("uri", location.filename).end_object();
+            w.key("replacements").begin_array();
+            for (auto span: fix.spans) {
+                w.begin_object().key("deletedRegion").begin_object();
+                if (fix.level == DiagnosticLevel::Insert) {
+                    // Insert spans cover the inserted text, so nothing is deleted.
+                    w.member("byteOffset", span.start()).member("byteLength", 0);
+                    w.end_object();
+                    w.key("insertedContent").begin_object().key("text");
+                    write_inserted_text(w, fix.tokens);
+                    w.end_object();
+                } else {
+                    w.member("byteOffset", span.start()).member("byteLength", span.size());
+                    w.end_object();
+                }
+                w.end_object();
+            }
+            w.end_array().end_object().end_array();
+            w.end_object();
+        }
+        w.end_array();
+
+        w.end_object();
+    }
+
+} // namespace dark::internal
+
+namespace dark {
+
+    /**
+     * @brief Writes a SARIF 2.1.0 log with a single run. The log header is written with
+     *        the first diagnostic and every diagnostic becomes a result appended to it, so
+     *        nothing but the unwritten bytes is kept in memory. `finish()`, or the
+     *        destructor, closes the log, and nothing may be consumed after it.
+     * @note `flush()` writes the buffered results but leaves the log open, so the output
+     *       is only valid JSON once the log is finished.
+     */
+    struct SarifDiagnosticConsumer: DiagnosticConsumer {
+        static constexpr std::size_t max_buffered_bytes = 64 * 1024;
+        static constexpr std::string_view sarif_version = "2.1.0";
+        static constexpr std::string_view sarif_schema = "https://json.schemastore.org/sarif-2.1.0.json";
+
+        explicit SarifDiagnosticConsumer(
+            FILE* file,
+            std::string_view tool_name,
+            std::string_view tool_version = {},
+            DiagnosticSerializeConfig config = {}
+        )
+            : m_file(file)
+            , m_tool_name(tool_name)
+            , m_tool_version(tool_version)
+            , m_config(config)
+        {}
+        SarifDiagnosticConsumer(SarifDiagnosticConsumer const&) = delete;
+        SarifDiagnosticConsumer(SarifDiagnosticConsumer &&) = delete;
+        SarifDiagnosticConsumer& operator=(SarifDiagnosticConsumer const&) = delete;
+        SarifDiagnosticConsumer& operator=(SarifDiagnosticConsumer &&) = delete;
+
+        ~SarifDiagnosticConsumer() noexcept override {
+            try {
+                finish();
+            } catch (...) {}
+        }
+
+        auto consume(Diagnostic&& d) -> void override {
+            serialize(d);
+            if (m_buffer.size() >= max_buffered_bytes) internal::write_buffer_to(m_file, m_buffer);
+            recycle(std::move(d));
+        }
+
+        auto consume_batch(std::span<Diagnostic> diagnostics) -> void override {
+            for (auto& d: diagnostics) {
+                serialize(d);
+                recycle(std::move(d));
+            }
+            internal::write_buffer_to(m_file, m_buffer);
+        }
+
+        auto flush() -> void override {
+            internal::write_buffer_to(m_file, m_buffer);
+            std::fflush(m_file);
+        }
+
+        // Closes the log; a log without results is still written. Calling it again does nothing.
+        auto finish() -> void {
+            if (m_has_finished) return;
+            begin_log();
+            m_writer.end_array().end_object().end_array().end_object();
+            m_buffer.push_back('\n');
+            m_is_open = false;
+            m_has_finished = true;
+            flush();
+        }
+
+        constexpr auto is_open() const noexcept -> bool { return m_is_open; }
+
+        // Serialized diagnostics are handed back to the pool, usually `emitter.pool()`.
+        constexpr auto set_pool(DiagnosticPool* pool) noexcept -> void { m_pool = pool; }
+
+    private:
+        auto begin_log() -> void {
+            if (m_is_open) return;
+            m_is_open = true;
+            m_writer.begin_object()
+                .member("version", sarif_version)
+                .member("$schema", sarif_schema)
+                .key("runs").begin_array()
+                    .begin_object()
+                        .key("tool").begin_object()
+                            .key("driver").begin_object()
+                                .member("name", std::string_view(m_tool_name));
+            if (!m_tool_version.empty()) m_writer.member("version", std::string_view(m_tool_version));
+            m_writer.end_object().end_object();
+            m_writer.key("results").begin_array();
+        }
+
+        auto serialize(Diagnostic& d) -> void {
+            assert(!m_has_finished && "The SARIF log is already finished");
+            begin_log();
+            d.resolve_location();
+            internal::write_sarif_result(m_writer, d, m_config);
+        }
+
+        auto recycle(Diagnostic&& d) -> void {
+            if (m_pool) m_pool->release(std::move(d));
+        }
+    private:
+        FILE* m_file;
+        std::string m_tool_name;
+        std::string m_tool_version;
+        DiagnosticSerializeConfig m_config{};
+        DiagnosticPool* m_pool{nullptr};
+        core::Buffer m_buffer{};
+        core::JsonWriter m_writer{m_buffer};
+        bool m_is_open{false};
+        bool m_has_finished{false};
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_CONSUMERS_SARIF_HPP
@@ -3,6 +3,7 @@
 
 #include "base.hpp"
 #include "../core/small_vec.hpp"
+#include <algorithm>
 #include <cassert>
 
 namespace dark {
@@ -27,12 +28,33 @@ namespace dark {
             m_diagnostics.emplace_back(std::move(d));
         }
 
+        auto consume_batch(std::span<Diagnostic> diagnostics) -> void override {
+            m_diagnostics.reserve(m_diagnostics.size() + diagnostics.size());
+            for (auto& d: diagnostics) m_diagnostics.emplace_back(std::move(d));
+        }
+
         auto flush() -> void override {
-            std::stable_sort(m_diagnostics.begin(), m_diagnostics.end(), [](Diagnostic const& l, Diagnostic const& r) {
+            // Keyed diagnostics are compared as integers and stay unconverted. The ones
+            // without a key, e.g. summaries without a location, are converted and sorted
+            // on their own after them, so they never force a conversion of the others.
+            auto keyless = std::stable_partition(m_diagnostics.begin(), m_diagnostics.end(), [](Diagnostic const& d) {
+                return d.location_key != 0;
+            });
+
+            std::stable_sort(m_diagnostics.begin(), keyless, [](Diagnostic const& l, Diagnostic const& r) {
+                return l.location_key < r.location_key;
+            });
+
+            // Diagnostics without any location, e.g. the emitter's summaries, come last.
+            for (auto it = keyless; it != m_diagnostics.end(); ++it) it->resolve_location();
+            std::stable_sort(keyless, m_diagnostics.end(), [](Diagnostic const& l, Diagnostic const& r) {
+                auto l_unlocated = l.location.filename.empty() && l.location.source.empty();
+                auto r_unlocated = r.location.filename.empty() && r.location.source.empty();
+                if (l_unlocated != r_unlocated) return r_unlocated;
                 return l.location < r.location;
             });
 
-            for (auto& diag: m_diagnostics) m_consumer->consume(std::move(diag));
+            m_consumer->consume_batch(std::span(m_diagnostics.data(), m_diagnostics.size()));
             m_diagnostics.clear();
             m_consumer->flush();
         }
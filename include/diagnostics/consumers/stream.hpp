@@ -2,17 +2,39 @@
 #define AMT_DARK_DIAGNOSTICS_CONSUMERS_STREAM_HPP
 
 #include "base.hpp"
+#include "../core/buffer.hpp"
 #include "../core/term/terminal.hpp"
 #include "../core/term/config.hpp"
 #include "../renderer.hpp"
+#include "../pool.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstdint>
 #include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
 
 #ifdef DARK_OS_UNIX
     #include <fcntl.h>
+    #include <unistd.h>
 #endif
 
 namespace dark {
+
+    enum class StreamLockMode: std::uint8_t {
+        // Renders straight into the stream while holding a file lock for every diagnostic
+        // (or every batch).
+        PerDiagnostic,
+        // Renders into a private buffer without a lock; the file lock is taken once per
+        // batch or flush and the buffer goes out in one `write`.
+        Buffered,
+        // Same as `Buffered`, but the writes are serialized by a process-wide mutex. Only
+        // safe when no other process writes to the same file.
+        BufferedInProcess
+    };
+
     struct StreamDiagnosticConsumer: DiagnosticConsumer {
     private:
         struct FileLock {
@@ -29,6 +51,7 @@ namespace dark {
                         throw std::runtime_error("Failed to lock file");
                     }
                 #else
+                    OVERLAPPED ol = {0};
                     if (!LockFileEx(m_handle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &ol)) {
                         throw std::runtime_error("Failed to lock file");
                     }
@@ -52,32 +75,151 @@ namespace dark {
             core::term::detail::native_handle_t m_handle;
         };
     public:
+        // Buffered output is written out once it grows beyond this many bytes.
+        static constexpr std::size_t max_buffered_bytes = 64 * 1024;
+
         explicit constexpr StreamDiagnosticConsumer(
             FILE* file,
-            DiagnosticRenderConfig config = {}
+            DiagnosticRenderConfig config = {},
+            StreamLockMode lock_mode = StreamLockMode::PerDiagnostic
         ) noexcept
             : m_out(file)
             , m_config(config)
+            , m_lock_mode(lock_mode)
         {}
-        constexpr StreamDiagnosticConsumer(StreamDiagnosticConsumer const&) noexcept = default;
-        constexpr StreamDiagnosticConsumer(StreamDiagnosticConsumer &&) noexcept = default;
-        constexpr StreamDiagnosticConsumer& operator=(StreamDiagnosticConsumer const&) noexcept = default;
-        constexpr StreamDiagnosticConsumer& operator=(StreamDiagnosticConsumer &&) noexcept = default;
-        ~StreamDiagnosticConsumer() noexcept override = default;
+        // Copies would write the same buffered output twice.
+        StreamDiagnosticConsumer(StreamDiagnosticConsumer const&) = delete;
+        StreamDiagnosticConsumer& operator=(StreamDiagnosticConsumer const&) = delete;
+
+        // Takes over the buffered output; `other` is left with nothing to write.
+        StreamDiagnosticConsumer(StreamDiagnosticConsumer && other) noexcept
+            : m_out(other.m_out)
+            , m_config(other.m_config)
+            , m_pool(other.m_pool)
+            , m_buffer(std::move(other.m_buffer))
+            , m_lock_mode(other.m_lock_mode)
+            , m_has_printed(other.m_has_printed)
+        {}
+
+        // Writes out the output buffered so far before taking over `other`'s.
+        StreamDiagnosticConsumer& operator=(StreamDiagnosticConsumer && other) {
+            if (this == &other) return *this;
+            write_buffer();
+            m_out = other.m_out;
+            m_config = other.m_config;
+            m_pool = other.m_pool;
+            m_buffer = std::move(other.m_buffer);
+            m_lock_mode = other.m_lock_mode;
+            m_has_printed = other.m_has_printed;
+            return *this;
+        }
+
+        ~StreamDiagnosticConsumer() noexcept override {
+            try {
+                write_buffer();
+            } catch (...) {}
+        }
 
         auto consume(Diagnostic&& d) -> void override {
-            FileLock lock(m_out);
-            render_diagnostic(m_out, d, m_config);
-            m_out.write("\n");
+            if (m_lock_mode == StreamLockMode::PerDiagnostic) {
+                FileLock lock(m_out);
+                render_diagnostic(m_out, d, m_config);
+                m_out.write("\n");
+            } else {
+                render_to_buffer(d);
+                if (m_buffer.size() >= max_buffered_bytes) write_buffer();
+            }
+            recycle(std::move(d));
         }
 
-        auto flush() -> void override { m_out.flush(); }
+        // Takes the lock once for the whole batch.
+        auto consume_batch(std::span<Diagnostic> diagnostics) -> void override {
+            if (diagnostics.empty()) return;
+            if (m_lock_mode == StreamLockMode::PerDiagnostic) {
+                FileLock lock(m_out);
+                for (auto& d: diagnostics) {
+                    render_diagnostic(m_out, d, m_config);
+                    m_out.write("\n");
+                    recycle(std::move(d));
+                }
+                return;
+            }
+
+            for (auto& d: diagnostics) {
+                render_to_buffer(d);
+                recycle(std::move(d));
+            }
+            write_buffer();
+        }
+
+        auto flush() -> void override {
+            write_buffer();
+            m_out.flush();
+        }
 
         constexpr auto reset() noexcept -> void { m_has_printed = false; }
 
+        // Rendered diagnostics are handed back to the pool, usually `emitter.pool()`.
+        constexpr auto set_pool(DiagnosticPool* pool) noexcept -> void { m_pool = pool; }
+
+        constexpr auto lock_mode() const noexcept -> StreamLockMode { return m_lock_mode; }
+
+    private:
+        auto recycle(Diagnostic&& d) -> void {
+            if (m_pool) m_pool->release(std::move(d));
+        }
+
+        auto render_to_buffer(Diagnostic& d) -> void {
+            auto mode = m_out.colors_enabled() ? TerminalColorMode::Enable : TerminalColorMode::Disable;
+            auto term = Terminal<core::Buffer>(Writer<core::Buffer>(m_buffer, m_out.columns()), mode);
+            render_diagnostic(term, d, m_config);
+            term.write("\n");
+        }
+
+        // Hands the buffered diagnostics to the OS in a single write under the lock.
+        auto write_buffer() -> void {
+            if (m_buffer.empty()) return;
+            // Whatever is still sitting in the stdio buffer goes first.
+            m_out.flush();
+            if (m_lock_mode == StreamLockMode::BufferedInProcess) {
+                auto lock = std::lock_guard(process_mutex());
+                write_native(m_out.get_native_handle(), m_buffer);
+            } else {
+                FileLock lock(m_out);
+                write_native(m_out.get_native_handle(), m_buffer);
+            }
+            m_buffer.clear();
+        }
+
+        static auto process_mutex() noexcept -> std::mutex& {
+            static auto mutex = std::mutex{};
+            return mutex;
+        }
+
+        static auto write_native(core::term::detail::native_handle_t handle, std::string_view bytes) -> void {
+            while (!bytes.empty()) {
+                #ifdef DARK_OS_UNIX
+                    auto written = ::write(handle, bytes.data(), bytes.size());
+                    if (written < 0) {
+                        if (errno == EINTR) continue;
+                        throw std::runtime_error("Failed to write diagnostics");
+                    }
+                #else
+                    DWORD written{};
+                    auto size = static_cast<DWORD>(std::min<std::size_t>(bytes.size(), MAXDWORD));
+                    if (!WriteFile(handle, bytes.data(), size, &written, nullptr)) {
+                        throw std::runtime_error("Failed to write diagnostics");
+                    }
+                #endif
+                bytes.remove_prefix(static_cast<std::size_t>(written));
+            }
+        }
     private:
         Terminal<FILE*> m_out;
         DiagnosticRenderConfig m_config{};
+        DiagnosticPool* m_pool{nullptr};
+        core::Buffer m_buffer{};
+        StreamLockMode m_lock_mode{StreamLockMode::PerDiagnostic};
         bool m_has_printed{false};
     };
 
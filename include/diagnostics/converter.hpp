@@ -4,6 +4,9 @@
 #include "basic.hpp"
 #include "builders/diagnostic.hpp"
 #include "forward.hpp"
+#include <cassert>
+#include <cstdint>
+#include <string_view>
 
 namespace dark {
     template <typename LocT>
@@ -12,6 +15,40 @@ namespace dark {
         using builder_t = builder::DiagnosticBuilder<LocT>;
         virtual ~DiagnosticConverter() = default;
         virtual auto convert_loc(loc_t loc, builder_t& builder) const -> DiagnosticLocation = 0;
+
+        /**
+         * @brief Whether `convert_deferred_loc` is implemented. The emitter only defers
+         *        location conversion for converters that support it.
+         */
+        virtual auto supports_deferred_conversion() const noexcept -> bool { return false; }
+
+        /**
+         * @brief Converts the location without a builder. It's called the first time a
+         *        consumer needs the location, which might be long after the diagnostic was
+         *        emitted, so the converter and its sources must outlive the diagnostic.
+         */
+        virtual auto convert_deferred_loc([[maybe_unused]] loc_t loc) const -> DiagnosticLocation {
+            assert(false && "Converter does not support deferred location conversion");
+            return {};
+        }
+
+        /**
+         * @brief Returns the filename of the location without converting it. It's only
+         *        called when the emitter's filter has file rules; an empty name means the
+         *        file rules don't apply.
+         */
+        virtual auto source_filename([[maybe_unused]] loc_t loc) const -> std::string_view {
+            return {};
+        }
+
+        /**
+         * @brief Returns a non-zero integer that orders locations the same way as the
+         *        converted `DiagnosticLocation`s, e.g. an encoded `SourceLocation`. It lets
+         *        sorting skip location conversion; zero means there's no key.
+         */
+        virtual auto location_key([[maybe_unused]] loc_t loc) const noexcept -> std::uint64_t {
+            return 0;
+        }
     };
 } // namespace dark
 
@@ -0,0 +1,278 @@
+#ifndef AMT_DARK_DIAGNOSTICS_CORE_ARENA_HPP
+#define AMT_DARK_DIAGNOSTICS_CORE_ARENA_HPP
+
+#include "small_vec.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <utility>
+
+namespace dark::core {
+
+    /**
+     * @brief Bump allocator used to back diagnostics. Deallocation is a no-op and
+     *        `reset()` rewinds to the first chunk in O(1) while keeping every chunk
+     *        around for reuse. `release()` gives the memory back to the system.
+     * @note The arena is not thread-safe. Objects allocated from it must not be
+     *       used after `reset()`/`release()`.
+     */
+    struct Arena: std::pmr::memory_resource {
+    private:
+        struct Chunk {
+            Chunk* next{nullptr};
+            std::size_t size{}; // usable bytes after the header
+
+            auto data() noexcept -> std::byte* {
+                return reinterpret_cast<std::byte*>(this + 1);
+            }
+        };
+    public:
+        static constexpr std::size_t default_chunk_size = 64 * 1024;
+
+        struct Scope;
+
+        explicit Arena(std::size_t chunk_size = default_chunk_size) noexcept
+            : m_chunk_size(std::max(chunk_size, sizeof(Chunk) * 2))
+        {}
+        Arena(Arena const&) = delete;
+        Arena(Arena &&) = delete;
+        Arena& operator=(Arena const&) = delete;
+        Arena& operator=(Arena &&) = delete;
+        ~Arena() override { release(); }
+
+        auto allocate_bytes(std::size_t size, std::size_t align = alignof(std::max_align_t)) -> void* {
+            assert(std::has_single_bit(align) && "alignment must be a power of 2");
+            if (size == 0) size = 1;
+            if (auto* ptr = try_bump(size, align)) return ptr;
+
+            // Reuse the chunks retained by `reset()` before asking the system for more.
+            while (m_current && m_current->next) {
+                m_current = m_current->next;
+                m_ptr = m_current->data();
+                m_end = m_ptr + m_current->size;
+                if (auto* ptr = try_bump(size, align)) return ptr;
+            }
+
+            grow(size + align);
+            auto* ptr = try_bump(size, align);
+            assert(ptr != nullptr);
+            return ptr;
+        }
+
+        template <typename T>
+        auto allocate(std::size_t n = 1) -> T* {
+            return static_cast<T*>(allocate_bytes(sizeof(T) * n, alignof(T)));
+        }
+
+        /**
+         * @brief Copies the string into the arena so that it can be stored as a
+         *        borrowed `CowString` without owning a heap buffer.
+         */
+        auto intern(std::string_view str) -> std::string_view {
+            if (str.empty()) return {};
+            auto* ptr = allocate<char>(str.size());
+            std::memcpy(ptr, str.data(), str.size());
+            return { ptr, str.size() };
+        }
+
+        // Rewinds to the first chunk in O(1); the chunks are kept for reuse.
+        auto reset() noexcept -> void {
+            m_current = m_head;
+            if (m_current) {
+                m_ptr = m_current->data();
+                m_end = m_ptr + m_current->size;
+            } else {
+                m_ptr = m_end = nullptr;
+            }
+        }
+
+        // Gives every chunk back to the system.
+        auto release() noexcept -> void {
+            auto* chunk = m_head;
+            while (chunk) {
+                auto* next = chunk->next;
+                std::free(chunk);
+                chunk = next;
+            }
+            m_head = m_current = nullptr;
+            m_ptr = m_end = nullptr;
+            m_capacity = 0;
+        }
+
+        constexpr auto capacity() const noexcept -> std::size_t { return m_capacity; }
+
+        auto owns(void const* ptr) const noexcept -> bool {
+            auto const* p = static_cast<std::byte const*>(ptr);
+            for (auto* chunk = m_head; chunk; chunk = chunk->next) {
+                auto* start = chunk->data();
+                if (p >= start && p < start + chunk->size) return true;
+            }
+            return false;
+        }
+
+        // Arena installed by the innermost active `Arena::Scope` on this thread.
+        static auto current() noexcept -> Arena* {
+            return current_ref();
+        }
+
+    protected:
+        auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override {
+            return allocate_bytes(bytes, alignment);
+        }
+
+        auto do_deallocate(void*, std::size_t, std::size_t) -> void override {}
+
+        auto do_is_equal(std::pmr::memory_resource const& other) const noexcept -> bool override {
+            return this == &other;
+        }
+
+    private:
+        static auto current_ref() noexcept -> Arena*& {
+            static thread_local Arena* arena{nullptr};
+            return arena;
+        }
+
+        auto try_bump(std::size_t size, std::size_t align) noexcept -> void* {
+            if (m_ptr == nullptr) return nullptr;
+            auto addr = reinterpret_cast<std::uintptr_t>(m_ptr);
+            auto aligned = (addr + (align - 1)) & ~static_cast<std::uintptr_t>(align - 1);
+            auto* ptr = m_ptr + (aligned - addr);
+            if (ptr + size > m_end) return nullptr;
+            m_ptr = ptr + size;
+            return ptr;
+        }
+
+        auto grow(std::size_t min_size) -> void {
+            auto size = std::max(m_chunk_size, min_size);
+            auto* mem = std::malloc(sizeof(Chunk) + size);
+            if (mem == nullptr) throw std::bad_alloc();
+            auto* chunk = new (mem) Chunk{ .next = nullptr, .size = size };
+
+            // Splice after the current chunk so retained chunks stay reachable.
+            if (m_current) {
+                chunk->next = m_current->next;
+                m_current->next = chunk;
+            } else {
+                chunk->next = m_head;
+                m_head = chunk;
+            }
+
+            m_current = chunk;
+            m_ptr = chunk->data();
+            m_end = m_ptr + size;
+            m_capacity += size;
+        }
+
+    private:
+        Chunk* m_head{nullptr};
+        Chunk* m_current{nullptr};
+        std::byte* m_ptr{nullptr};
+        std::byte* m_end{nullptr};
+        std::size_t m_chunk_size;
+        std::size_t m_capacity{};
+    };
+
+    /**
+     * @brief Installs an arena as the current arena of this thread until the scope
+     *        ends. Passing `nullptr` leaves the current arena untouched.
+     * @note Scopes must end in the reverse order they were created in; ending an outer
+     *       scope first would reinstall an arena that's no longer in use.
+     */
+    struct Arena::Scope {
+        constexpr Scope() noexcept = default;
+        explicit Scope(Arena* arena) noexcept
+            : m_installed(arena)
+            , m_active(arena != nullptr)
+        {
+            if (!m_active) return;
+            m_previous = std::exchange(current_ref(), arena);
+        }
+        Scope(Scope const&) = delete;
+        Scope(Scope&& other) noexcept
+            : m_previous(other.m_previous)
+            , m_installed(other.m_installed)
+            , m_active(std::exchange(other.m_active, false))
+        {}
+        Scope& operator=(Scope const&) = delete;
+        Scope& operator=(Scope&& other) noexcept {
+            if (this == &other) return *this;
+            end();
+            m_previous = other.m_previous;
+            m_installed = other.m_installed;
+            m_active = std::exchange(other.m_active, false);
+            return *this;
+        }
+        ~Scope() { end(); }
+
+        // Restores the previous arena.
+        auto end() noexcept -> void {
+            if (!m_active) return;
+            assert(current_ref() == m_installed && "arena scopes must end in LIFO order");
+            current_ref() = m_previous;
+            m_active = false;
+        }
+    private:
+        Arena* m_previous{nullptr};
+        Arena* m_installed{nullptr};
+        bool m_active{false};
+    };
+
+    /**
+     * @brief Allocator that binds to `Arena::current()` when it's constructed and falls
+     *        back to the global heap when no arena is active.
+     */
+    template <typename T>
+    struct ArenaAllocator {
+        using value_type = T;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        ArenaAllocator() noexcept
+            : m_arena(Arena::current())
+        {}
+        constexpr explicit ArenaAllocator(Arena* arena) noexcept
+            : m_arena(arena)
+        {}
+        constexpr ArenaAllocator(ArenaAllocator const&) noexcept = default;
+        constexpr ArenaAllocator& operator=(ArenaAllocator const&) noexcept = default;
+
+        template <typename U>
+        constexpr ArenaAllocator(ArenaAllocator<U> const& other) noexcept
+            : m_arena(other.arena())
+        {}
+
+        auto allocate(std::size_t n) -> T* {
+            if (m_arena) return m_arena->template allocate<T>(n);
+            return std::allocator<T>{}.allocate(n);
+        }
+
+        auto deallocate(T* ptr, std::size_t n) noexcept -> void {
+            if (m_arena) return;
+            std::allocator<T>{}.deallocate(ptr, n);
+        }
+
+        constexpr auto arena() const noexcept -> Arena* { return m_arena; }
+
+        template <typename U>
+        constexpr auto operator==(ArenaAllocator<U> const& other) const noexcept -> bool {
+            return m_arena == other.arena();
+        }
+    private:
+        Arena* m_arena;
+    };
+
+    // `SmallVec` whose spilled storage comes from the current arena.
+    template <typename T, unsigned Cap = 8>
+    using ArenaSmallVec = SmallVec<T, Cap, ArenaAllocator<T>>;
+
+} // namespace dark::core
+
+#endif // AMT_DARK_DIAGNOSTICS_CORE_ARENA_HPP
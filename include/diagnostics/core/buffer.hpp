@@ -0,0 +1,109 @@
+#ifndef AMT_DARK_DIAGNOSTICS_CORE_BUFFER_HPP
+#define AMT_DARK_DIAGNOSTICS_CORE_BUFFER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+namespace dark::core {
+
+    /**
+     * @brief Contiguous, growable byte buffer for rendered output. Growing doesn't
+     *        zero-initialize the new bytes, and `clear` keeps the capacity so a buffer can
+     *        be reused for every diagnostic.
+     */
+    struct Buffer {
+        using value_type = char;
+        using size_type = std::size_t;
+        using iterator = char*;
+        using const_iterator = char const*;
+
+        static constexpr size_type min_capacity = 256;
+
+        constexpr Buffer() noexcept = default;
+        explicit Buffer(size_type capacity) {
+            reserve(capacity);
+        }
+        Buffer(Buffer const& other) {
+            append(other.view());
+        }
+        Buffer(Buffer&& other) noexcept
+            : m_data(std::move(other.m_data))
+            , m_size(std::exchange(other.m_size, 0))
+            , m_capacity(std::exchange(other.m_capacity, 0))
+        {}
+        Buffer& operator=(Buffer const& other) {
+            if (this == &other) return *this;
+            clear();
+            append(other.view());
+            return *this;
+        }
+        Buffer& operator=(Buffer&& other) noexcept {
+            if (this == &other) return *this;
+            auto tmp = Buffer(std::move(other));
+            swap(tmp, *this);
+            return *this;
+        }
+        ~Buffer() = default;
+
+        // Makes sure at least `capacity` bytes fit without reallocating.
+        auto reserve(size_type capacity) -> void {
+            if (capacity <= m_capacity) return;
+            auto new_capacity = std::max({ capacity, m_capacity * 2, min_capacity });
+            auto data = std::make_unique_for_overwrite<char[]>(new_capacity);
+            if (m_size) std::memcpy(data.get(), m_data.get(), m_size);
+            m_data = std::move(data);
+            m_capacity = new_capacity;
+        }
+
+        auto append(std::string_view str) -> void {
+            if (str.empty()) return;
+            reserve(m_size + str.size());
+            std::memcpy(m_data.get() + m_size, str.data(), str.size());
+            m_size += str.size();
+        }
+
+        auto push_back(char c) -> void {
+            if (m_size == m_capacity) reserve(m_size + 1);
+            m_data[m_size++] = c;
+        }
+
+        constexpr auto clear() noexcept -> void { m_size = 0; }
+
+        constexpr auto data() noexcept -> char* { return m_data.get(); }
+        constexpr auto data() const noexcept -> char const* { return m_data.get(); }
+        constexpr auto size() const noexcept -> size_type { return m_size; }
+        constexpr auto capacity() const noexcept -> size_type { return m_capacity; }
+        constexpr auto empty() const noexcept -> bool { return m_size == 0; }
+
+        constexpr auto begin() noexcept -> iterator { return data(); }
+        constexpr auto end() noexcept -> iterator { return data() + m_size; }
+        constexpr auto begin() const noexcept -> const_iterator { return data(); }
+        constexpr auto end() const noexcept -> const_iterator { return data() + m_size; }
+
+        constexpr auto view() const noexcept -> std::string_view {
+            return { data(), m_size };
+        }
+
+        constexpr operator std::string_view() const noexcept {
+            return view();
+        }
+
+        friend auto swap(Buffer& lhs, Buffer& rhs) noexcept -> void {
+            using std::swap;
+            swap(lhs.m_data, rhs.m_data);
+            swap(lhs.m_size, rhs.m_size);
+            swap(lhs.m_capacity, rhs.m_capacity);
+        }
+    private:
+        std::unique_ptr<char[]> m_data{};
+        size_type m_size{};
+        size_type m_capacity{};
+    };
+
+} // namespace dark::core
+
+#endif // AMT_DARK_DIAGNOSTICS_CORE_BUFFER_HPP
@@ -62,12 +62,31 @@
 #endif
 
 
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+
 namespace dark {
-#ifndef DARK_DIAGNOSTICS_SIZE_TYPE
-    using dsize_t = unsigned;
+    // Absolute position inside a source text. Define `DARK_DIAGNOSTICS_LARGE_FILES` to address
+    // sources over 4 GiB, or `DARK_DIAGNOSTICS_SIZE_TYPE` to pick the type explicitly.
+#if defined(DARK_DIAGNOSTICS_SIZE_TYPE)
+    using dsize_t = DARK_DIAGNOSTICS_SIZE_TYPE;
+#elif defined(DARK_DIAGNOSTICS_LARGE_FILES)
+    using dsize_t = std::uint64_t;
 #else
-    using usize_t = DARK_DIAGNOSTICS_SIZE_TYPE;
+    using dsize_t = unsigned;
 #endif
+
+    // Offset relative to the start of a line or of the rendered source window. It stays 32-bit
+    // regardless of `dsize_t`, so the per-token structures of the renderer do not grow.
+    using doffset_t = std::uint32_t;
+
+    // Narrows a position that is already relative to a line or the rendered window.
+    constexpr auto to_offset(std::unsigned_integral auto offset) noexcept -> doffset_t {
+        assert(offset <= std::numeric_limits<doffset_t>::max() && "Offset does not fit into doffset_t");
+        return static_cast<doffset_t>(offset);
+    }
 } // namespace dark
 
 #endif // AMT_DARK_DIAGNOSTICS_CORE_CONFIG_HPP
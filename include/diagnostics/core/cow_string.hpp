@@ -44,7 +44,10 @@ namespace dark::core {
             , m_state(other.m_state)
         {
             if (other.is_owned()) {
-                auto tmp = CowString(to_borrowed(), OwnedTag{});
+                // The bytes copied above still belong to `other`'s string, so they must not
+                // be destroyed when `tmp` goes away.
+                m_state = NONE;
+                auto tmp = CowString(other.as_owned(), OwnedTag{});
                 swap(tmp, *this);
             }
         }
@@ -3,10 +3,16 @@
 
 #include "cow_string.hpp"
 #include "small_vec.hpp"
+#include "arena.hpp"
 #include "format_any.hpp"
+#include "hash.hpp"
+#include <algorithm>
+#include <array>
 #include <concepts>
+#include <cstdint>
 #include <format>
 #include <functional>
+#include <limits>
 #include <span>
 #include <string>
 #include <string_view>
@@ -15,10 +21,118 @@
 
 namespace dark {
     namespace core {
+        // Offsets into the format string: the literal `[begin, literal_end)` followed by
+        // the argument `arg` formatted with the field `[field_begin, field_end)`.
+        struct FormatSegment {
+            static constexpr std::uint16_t no_arg = std::numeric_limits<std::uint16_t>::max();
+
+            std::uint16_t begin{};
+            std::uint16_t literal_end{};
+            // Empty when the argument uses the default format.
+            std::uint16_t field_begin{};
+            std::uint16_t field_end{};
+            std::uint16_t arg{ no_arg };
+        };
+
+        /**
+         * @brief Format string that is validated by `std::format_string` and split into
+         *        literal segments and argument slots at compile time, so formatting only
+         *        appends the pieces. Formats that cannot be split (too many segments,
+         *        nested replacement fields, or explicit indices with a spec) fall back
+         *        to `std::vformat`.
+         */
+        template <typename... Args>
+        struct basic_format_string {
+            static constexpr std::size_t max_segments = 16;
+
+            template <typename T>
+                requires std::convertible_to<T const&, std::string_view>
+            consteval basic_format_string(T const& s)
+                : m_format(s)
+            {
+                // Reports malformed formats and argument count mismatches.
+                [[maybe_unused]] auto checked = std::format_string<
+                    std::conditional_t<!std::same_as<std::remove_cvref_t<Args>, FormatterAnyArg>, FormatterAnyArg, Args>...
+                >(s);
+                if (!precompile()) m_size = 0;
+            }
+
+            constexpr auto get() const noexcept -> std::string_view { return m_format; }
+
+            // Empty if the format could not be precompiled.
+            constexpr auto segments() const noexcept -> std::span<FormatSegment const> {
+                return { m_segments.data(), m_size };
+            }
+
+        private:
+            consteval auto push(std::size_t begin, std::size_t literal_end, std::size_t field_begin, std::size_t field_end, std::size_t arg) -> bool {
+                if (m_size >= max_segments) return false;
+                m_segments[m_size++] = {
+                    .begin = static_cast<std::uint16_t>(begin),
+                    .literal_end = static_cast<std::uint16_t>(literal_end),
+                    .field_begin = static_cast<std::uint16_t>(field_begin),
+                    .field_end = static_cast<std::uint16_t>(field_end),
+                    .arg = static_cast<std::uint16_t>(arg)
+                };
+                return true;
+            }
+
+            // The format is already validated, so every '}' outside a field is escaped.
+            consteval auto precompile() -> bool {
+                auto fmt = m_format;
+                if (fmt.size() >= FormatSegment::no_arg) return false;
+
+                std::size_t begin{}, next_arg{};
+                for (auto i = 0ul; i < fmt.size();) {
+                    auto c = fmt[i];
+                    if (c != '{' && c != '}') {
+                        ++i;
+                        continue;
+                    }
+
+                    // "{{" or "}}": keep the first brace in the literal and skip the second.
+                    if (i + 1 < fmt.size() && fmt[i + 1] == c) {
+                        if (!push(begin, i + 1, i + 1, i + 1, FormatSegment::no_arg)) return false;
+                        i += 2;
+                        begin = i;
+                        continue;
+                    }
+
+                    auto close = fmt.find('}', i);
+                    auto field = fmt.substr(i + 1, close - i - 1);
+                    auto colon = field.find(':');
+                    auto id = field.substr(0, colon);
+                    auto spec = colon == std::string_view::npos ? std::string_view{} : field.substr(colon + 1);
+                    if (spec.find('{') != std::string_view::npos) return false;
+
+                    auto arg = std::size_t{};
+                    if (id.empty()) {
+                        arg = next_arg++;
+                    } else {
+                        // The field would have to be rewritten without the index.
+                        if (!spec.empty()) return false;
+                        for (auto d: id) arg = arg * 10 + static_cast<std::size_t>(d - '0');
+                    }
+
+                    auto field_end = spec.empty() ? i : close + 1;
+                    if (!push(begin, i, i, field_end, arg)) return false;
+                    i = close + 1;
+                    begin = i;
+                }
+
+                if (begin < fmt.size()) {
+                    return push(begin, fmt.size(), fmt.size(), fmt.size(), FormatSegment::no_arg);
+                }
+                return true;
+            }
+        private:
+            std::string_view m_format;
+            std::array<FormatSegment, max_segments> m_segments{};
+            std::size_t m_size{};
+        };
+
         template <typename... Args>
-        using format_string = std::format_string<
-            std::conditional_t<!std::same_as<std::remove_cvref_t<Args>, FormatterAnyArg>, FormatterAnyArg, Args>...
-        >;
+        using format_string = basic_format_string<std::type_identity_t<Args>...>;
         namespace detail {
             template <typename T>
             constexpr auto to_format_arg(T&& arg) -> FormatterAnyArg {
@@ -57,10 +171,14 @@ namespace dark {
          * @endcode
          */
         struct BasicFormatter {
+            static constexpr std::size_t max_segments = basic_format_string<>::max_segments;
+
             constexpr BasicFormatter() noexcept = default;
             BasicFormatter(BasicFormatter const&) = delete;
             BasicFormatter(BasicFormatter&& other) noexcept
                 : m_format(std::move(other.m_format))
+                , m_segments(other.m_segments)
+                , m_segment_count(std::exchange(other.m_segment_count, 0))
                 , m_args(std::move(other.m_args))
                 , m_apply(std::exchange(other.m_apply, nullptr))
             {}
@@ -74,10 +192,16 @@ namespace dark {
 
             ~BasicFormatter() = default;
 
+            // The segment table is small and trivially copyable, so it's copied inline and
+            // the formatter doesn't depend on `fmt` outliving it.
             template <IsFormattable... Args>
-            BasicFormatter(format_string<Args...> fmt, Args&&... args) 
-                : m_format(std::move(fmt.get()))
+            BasicFormatter(format_string<Args...> fmt, Args&&... args)
+                : m_format(fmt.get())
             {
+                auto segments = fmt.segments();
+                std::copy(segments.begin(), segments.end(), m_segments.begin());
+                m_segment_count = static_cast<std::uint8_t>(segments.size());
+
                 m_args.reserve(sizeof...(args));
                 (m_args.emplace_back(detail::to_format_arg(std::forward<Args>(args))),...);
                 m_apply = [](std::string_view fmt, std::span<FormatterAnyArg const> args) -> std::string {
@@ -111,19 +235,76 @@ namespace dark {
             auto format() const -> CowString {
                 if (empty()) return "";
                 if (!m_apply) return CowString(m_format.to_borrowed());
-                return CowString(m_apply(m_format, std::span(m_args)));
+                if (m_segment_count == 0) return CowString(m_apply(m_format, std::span(m_args)));
+                auto res = std::string{};
+                format_to(res);
+                return CowString(std::move(res));
+            }
+
+            // Hash of the format string and the argument payloads without formatting them.
+            auto hash() const -> std::uint64_t {
+                auto h = hash_string(m_format.to_borrowed());
+                for (auto const& arg: m_args) h = hash_combine(h, arg.hash());
+                return h;
+            }
+
+            // Appends the formatted message to `out`.
+            auto format_to(std::string& out) const -> void {
+                auto fmt = m_format.to_borrowed();
+                if (!m_apply) {
+                    out.append(fmt);
+                    return;
+                }
+
+                if (m_segment_count == 0) {
+                    out.append(m_apply(fmt, std::span(m_args)));
+                    return;
+                }
+
+                out.reserve(out.size() + fmt.size() + m_args.size() * 8);
+                for (auto const& seg: std::span(m_segments.data(), m_segment_count)) {
+                    out.append(fmt.substr(seg.begin, seg.literal_end - seg.begin));
+                    if (seg.arg == FormatSegment::no_arg) continue;
+                    m_args[seg.arg].format_to(out, fmt.substr(seg.field_begin, seg.field_end - seg.field_begin));
+                }
+            }
+
+            // Takes over the format and arguments of `other` while keeping the capacity of
+            // this formatter's argument list.
+            auto assign(BasicFormatter&& other) -> void {
+                if (this == &other) return;
+                m_format = std::move(other.m_format);
+                m_segments = other.m_segments;
+                m_segment_count = std::exchange(other.m_segment_count, 0);
+                m_args.clear();
+                for (auto& arg: other.m_args) m_args.push_back(std::move(arg));
+                m_apply = std::exchange(other.m_apply, nullptr);
+                other.clear();
+            }
+
+            // Drops the format and arguments while keeping the capacity of the argument list.
+            auto clear() noexcept -> void {
+                m_format = CowString();
+                m_segment_count = 0;
+                m_args.clear();
+                m_apply = nullptr;
             }
 
             constexpr friend auto swap(BasicFormatter& lhs, BasicFormatter& rhs) noexcept -> void {
                 using std::swap;
                 swap(lhs.m_format, rhs.m_format);
+                swap(lhs.m_segments, rhs.m_segments);
+                swap(lhs.m_segment_count, rhs.m_segment_count);
                 swap(lhs.m_args, rhs.m_args);
                 swap(lhs.m_apply, rhs.m_apply);
             }
 
         private:
             CowString m_format;
-            SmallVec<FormatterAnyArg, 4> m_args;
+            // Copy of the precompiled segments; none if the format falls back to `std::vformat`.
+            std::array<FormatSegment, max_segments> m_segments{};
+            std::uint8_t m_segment_count{};
+            ArenaSmallVec<FormatterAnyArg, 4> m_args;
             std::function<std::string(std::string_view, std::span<FormatterAnyArg const>)> m_apply{nullptr};
         };
 
@@ -142,7 +323,9 @@ struct std::formatter<dark::core::BasicFormatter> {
     }
 
     auto format(dark::core::BasicFormatter const& f, auto& ctx) const {
-        return std::format_to(ctx.out(), "{}", f.format().to_borrowed());
+        auto str = f.format();
+        auto text = str.to_borrowed();
+        return std::copy(text.begin(), text.end(), ctx.out());
     }
 };
 #endif // AMT_DARK_DIAGNOSTIC_CORE_FORMAT_HPP
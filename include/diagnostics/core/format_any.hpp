@@ -2,15 +2,20 @@
 #define AMT_DARK_DIAGNOSTIC_CORE_FORMAT_ANY_HPP
 
 #include "cow_string.hpp"
+#include "arena.hpp"
+#include "hash.hpp"
+#include <algorithm>
 #include <concepts>
 #include <cstddef>
 #include <cstdint>
 #include <format>
+#include <iterator>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <memory.h>
 #include <string_view>
+#include <type_traits>
 #include <utility>
 
 namespace dark::core {
@@ -78,13 +83,18 @@ namespace dark::core {
             sizeof(CowString) + alignof(CowString)
         });
     private:
-        using allocator_t = std::allocator<std::byte>;
+        // Payloads larger than `small_buffer_size` come from the current arena if any.
+        using allocator_t = ArenaAllocator<std::byte>;
         struct AnyWrapper {
             union {
                 std::byte* ptr{nullptr};
                 std::byte buf[small_buffer_size]; // small buffer
             } data;
-            std::string(*to_string)(AnyWrapper const&, std::string_view){nullptr};
+            // Appends the formatted value; an empty spec means the default format.
+            void(*format_to)(AnyWrapper const&, std::string&, std::string_view){nullptr};
+            // Writes the value to the output of a `std::format` call; the spec has no braces.
+            void(*format_to_context)(AnyWrapper const&, std::format_context&, std::string_view){nullptr};
+            std::uint64_t(*hash)(AnyWrapper const&){nullptr};
             void(*deleter)(AnyWrapper&, allocator_t&){nullptr};
 
             constexpr AnyWrapper() noexcept = default;
@@ -95,14 +105,18 @@ namespace dark::core {
             AnyWrapper(AnyWrapper const& other) = delete;
             constexpr AnyWrapper(AnyWrapper && other) noexcept
                 : data(other.data)
-                , to_string(std::exchange(other.to_string, nullptr))
+                , format_to(std::exchange(other.format_to, nullptr))
+                , format_to_context(std::exchange(other.format_to_context, nullptr))
+                , hash(std::exchange(other.hash, nullptr))
                 , deleter(std::exchange(other.deleter, nullptr))
             {}
             AnyWrapper& operator=(AnyWrapper const& other) = delete;
             constexpr AnyWrapper& operator=(AnyWrapper && other) noexcept {
                 if (this == &other) return *this;
                 data = other.data;
-                to_string = std::exchange(other.to_string, nullptr);
+                format_to = std::exchange(other.format_to, nullptr);
+                format_to_context = std::exchange(other.format_to_context, nullptr);
+                hash = std::exchange(other.hash, nullptr);
                 deleter = std::exchange(other.deleter, nullptr);
                 return *this;
             }
@@ -149,27 +163,58 @@ namespace dark::core {
                 } else {
                     auto ptr = wrapper.get<T>();
                     ptr->~T();
-                    alloc.deallocate(ptr);
+                    ArenaAllocator<T>(alloc).deallocate(ptr, 1);
                 }
             }
 
-            static auto to_string(AnyWrapper const& wrapper, std::string_view fmt) -> std::string {
+            static auto format_to(AnyWrapper const& wrapper, std::string& out, std::string_view spec) -> void {
                 using std::to_string;
 
                 auto* val = wrapper.get<T>();
                 if constexpr (IsFormattableUsingStandardFormat<T>) {
-                    return std::vformat(fmt, std::make_format_args(*val));
+                    if (spec.empty()) std::format_to(std::back_inserter(out), "{}", *val);
+                    else std::vformat_to(std::back_inserter(out), spec, std::make_format_args(*val));
                 } else if constexpr (
                     IsFormattableUsingGlobalOverload<T> ||
                     IsFormattableUsingStandardToString<T>
                 ) {
-                    return std::string(to_string(*val));
+                    out.append(to_string(*val));
                 } else if constexpr (IsFormattableUsingMember<T>) {
-                    return std::string(val->to_string());
+                    out.append(val->to_string());
                 } else if constexpr (IsFormattableUsingStandardOStream<T>) {
                     std::stringstream os;
                     os << *val;
-                    return os.str();
+                    out.append(os.view());
+                }
+            }
+
+            static auto format_to_context(AnyWrapper const& wrapper, std::format_context& ctx, std::string_view spec) -> void {
+                auto* val = wrapper.get<T>();
+                if constexpr (IsFormattableUsingStandardFormat<T>) {
+                    // Parses only the spec, so no replacement field has to be built.
+                    auto formatter = std::formatter<T>{};
+                    auto parse_ctx = std::format_parse_context(spec);
+                    parse_ctx.advance_to(formatter.parse(parse_ctx));
+                    ctx.advance_to(formatter.format(*val, ctx));
+                } else {
+                    // The other methods produce a string anyway.
+                    auto tmp = std::string{};
+                    format_to(wrapper, tmp, {});
+                    ctx.advance_to(std::copy(tmp.begin(), tmp.end(), ctx.out()));
+                }
+            }
+
+            // Hashes the payload bytes when they fully describe the value; otherwise its text.
+            static auto hash(AnyWrapper const& wrapper) -> std::uint64_t {
+                auto* val = wrapper.get<T>();
+                if constexpr (std::has_unique_object_representations_v<T>) {
+                    return hash_bytes(val, sizeof(T));
+                } else if constexpr (std::convertible_to<T const&, std::string_view>) {
+                    return hash_string(*val);
+                } else {
+                    auto tmp = std::string{};
+                    format_to(wrapper, tmp, {});
+                    return hash_string(tmp);
                 }
             }
         };
@@ -178,11 +223,15 @@ namespace dark::core {
         constexpr FormatterAnyArg() noexcept = default;
         constexpr FormatterAnyArg(FormatterAnyArg const&) = delete;
         constexpr FormatterAnyArg(FormatterAnyArg && other) noexcept
-            : m_wrapper(std::move(other.m_wrapper))
+            : m_alloc(other.m_alloc)
+            , m_wrapper(std::move(other.m_wrapper))
         {}
         constexpr FormatterAnyArg& operator=(FormatterAnyArg const&) = delete;
         constexpr FormatterAnyArg& operator=(FormatterAnyArg && other) noexcept {
             if (this == &other) return *this;
+            m_wrapper.dealloc(m_alloc);
+            // The payload must be released by the allocator that created it.
+            m_alloc = other.m_alloc;
             m_wrapper = std::move(other.m_wrapper);
             return *this;
         }
@@ -200,7 +249,9 @@ namespace dark::core {
             : m_alloc(alloc)
         {
             using type = std::remove_cvref_t<T>;
-            m_wrapper.to_string = AnyHelper<type>::to_string;
+            m_wrapper.format_to = AnyHelper<type>::format_to;
+            m_wrapper.format_to_context = AnyHelper<type>::format_to_context;
+            m_wrapper.hash = AnyHelper<type>::hash;
             m_wrapper.deleter = AnyHelper<type>::dealloc;
             new(m_wrapper.data.buf) type(std::move(val));
         }
@@ -213,8 +264,10 @@ namespace dark::core {
             : m_alloc(alloc)
         {
             using type = std::remove_cvref_t<T>;
-            m_wrapper.data.ptr = m_alloc.allocate(sizeof(T));
-            m_wrapper.to_string = AnyHelper<type>::to_string;
+            m_wrapper.data.ptr = reinterpret_cast<std::byte*>(ArenaAllocator<type>(m_alloc).allocate(1));
+            m_wrapper.format_to = AnyHelper<type>::format_to;
+            m_wrapper.format_to_context = AnyHelper<type>::format_to_context;
+            m_wrapper.hash = AnyHelper<type>::hash;
             m_wrapper.deleter = AnyHelper<type>::dealloc;
             new(m_wrapper.data.ptr) type(std::move(val));
         }
@@ -225,11 +278,23 @@ namespace dark::core {
         )
             : m_alloc(alloc)
         {
-            m_wrapper.to_string = +[](
+            m_wrapper.format_to = +[](
                 AnyWrapper const& wrapper,
+                std::string& out,
                 std::string_view
             ) {
-                return wrapper.get<CowString>()->to_owned();
+                out.append(wrapper.get<CowString>()->to_borrowed());
+            };
+            m_wrapper.format_to_context = +[](
+                AnyWrapper const& wrapper,
+                std::format_context& ctx,
+                std::string_view
+            ) {
+                auto str = wrapper.get<CowString>()->to_borrowed();
+                ctx.advance_to(std::copy(str.begin(), str.end(), ctx.out()));
+            };
+            m_wrapper.hash = +[](AnyWrapper const& wrapper) {
+                return hash_string(wrapper.get<CowString>()->to_borrowed());
             };
             m_wrapper.deleter = AnyHelper<CowString>::dealloc;
             new(m_wrapper.data.buf) CowString(std::move(val));
@@ -250,16 +315,36 @@ namespace dark::core {
            : FormatterAnyArg(CowString(std::string_view(s), CowString::BorrowedTag{}), alloc)
         {}
 
-        auto to_string(std::string_view fmt) const -> std::string {
-            if (m_wrapper.to_string) {
-                return m_wrapper.to_string(m_wrapper, fmt); 
-            } else {
-                return "";
-            }
+        /**
+         * @brief Appends the formatted value to `out` without an intermediate string for
+         *        strings and `std::formatter` types.
+         * @param spec a replacement field such as `{:>4}`; empty uses the default format.
+         */
+        auto format_to(std::string& out, std::string_view spec = {}) const -> void {
+            if (m_wrapper.format_to) m_wrapper.format_to(m_wrapper, out, spec);
+        }
+
+        /**
+         * @brief Writes the formatted value straight to the output of a `std::format` call.
+         * @param spec the part of the replacement field after the colon, e.g. `>4`.
+         */
+        auto format_to(std::format_context& ctx, std::string_view spec = {}) const -> void {
+            if (m_wrapper.format_to_context) m_wrapper.format_to_context(m_wrapper, ctx, spec);
+        }
+
+        // Hash of the payload; equal values hash equally regardless of where they're stored.
+        auto hash() const -> std::uint64_t {
+            return m_wrapper.hash ? m_wrapper.hash(m_wrapper) : 0;
+        }
+
+        auto to_string(std::string_view spec = {}) const -> std::string {
+            auto res = std::string{};
+            format_to(res, spec);
+            return res;
         }
 
         constexpr operator bool() const noexcept {
-            return m_wrapper.to_string != nullptr;
+            return m_wrapper.format_to != nullptr;
         }
     private:
         allocator_t m_alloc;
@@ -274,31 +359,23 @@ namespace std {
     struct formatter<::dark::core::FormatterAnyArg> {
         template<typename parse_context_t>
         constexpr auto parse(parse_context_t& ctx) -> typename parse_context_t::iterator {
-            auto tmp = std::distance(ctx.begin(), ctx.end());
-            m_format.reserve(static_cast<std::size_t>(tmp));
-
             auto it = ctx.begin();
             while (it != ctx.end()) {
-                m_format += *it;
-                if (*it == '}') {
-                    break; 
-                }
+                if (*it == '}') break;
                 ++it;
             }
-
+            // The spec lives in the format string, which outlives the `format` call.
+            m_spec = std::string_view(ctx.begin(), it);
             return it;
         }
 
-        template<typename fmt_context_t>
-        auto format(::dark::core::FormatterAnyArg const& val, fmt_context_t& ctx) const -> typename fmt_context_t::iterator {
-            auto out = ctx.out();
-            auto str = val.to_string(m_format);
-            std::copy(str.begin(), str.end(), out);
-            return out; 
+        auto format(::dark::core::FormatterAnyArg const& val, std::format_context& ctx) const -> std::format_context::iterator {
+            val.format_to(ctx, m_spec);
+            return ctx.out();
         }
 
     private:
-        std::string m_format{"{:"};
+        std::string_view m_spec{};
     };
 } // namespace std
 
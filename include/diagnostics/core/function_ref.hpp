@@ -1,6 +1,7 @@
 #ifndef AMT_DARK_DIAGNOSTICS_FUNCTION_REF_HPP
 #define AMT_DARK_DIAGNOSTICS_FUNCTION_REF_HPP
 
+#include <cstdint>
 #include <type_traits>
 #include <utility>
 
@@ -16,6 +17,11 @@ namespace dark::core {
         template<typename Ret, typename ...Params>
         struct is_function_ref_helper<Ret(Params...)>: std:: true_type {};
 
+        // Copies of a `FunctionRef` must use the copy constructor instead of referencing
+        // the copied object, which might be a parameter that dies on return.
+        template<typename Ret, typename ...Params>
+        struct is_function_ref_helper<FunctionRef<Ret(Params...)>>: std:: true_type {};
+
         template<typename T>
         concept is_function_ref = is_function_ref_helper<std::remove_cvref_t<T>>::value;
     } // namespace detail
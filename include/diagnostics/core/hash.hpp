@@ -0,0 +1,107 @@
+#ifndef AMT_DARK_DIAGNOSTICS_CORE_HASH_HPP
+#define AMT_DARK_DIAGNOSTICS_CORE_HASH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace dark::core {
+
+    // Finalizer from MurmurHash3; spreads every input bit over the whole word.
+    constexpr auto hash_mix(std::uint64_t h) noexcept -> std::uint64_t {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    constexpr auto hash_combine(std::uint64_t seed, std::uint64_t value) noexcept -> std::uint64_t {
+        return hash_mix(seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2)));
+    }
+
+    // Non-cryptographic hash that consumes eight bytes per step.
+    inline auto hash_bytes(void const* data, std::size_t size, std::uint64_t seed = 0) noexcept -> std::uint64_t {
+        auto const* ptr = static_cast<unsigned char const*>(data);
+        auto h = seed ^ (size * 0x9e3779b97f4a7c15ull);
+        while (size >= 8) {
+            std::uint64_t word;
+            std::memcpy(&word, ptr, 8);
+            h = hash_combine(h, word);
+            ptr += 8;
+            size -= 8;
+        }
+        if (size != 0) {
+            std::uint64_t word{};
+            std::memcpy(&word, ptr, size);
+            h = hash_combine(h, word);
+        }
+        return hash_mix(h);
+    }
+
+    inline auto hash_string(std::string_view str, std::uint64_t seed = 0) noexcept -> std::uint64_t {
+        return hash_bytes(str.data(), str.size(), seed);
+    }
+
+    /**
+     * @brief Open-addressing set of 64-bit fingerprints with linear probing. Zero is used
+     *        as the empty marker, so a zero fingerprint is stored as one.
+     */
+    struct FingerprintSet {
+        FingerprintSet() = default;
+
+        // Returns false if the fingerprint was already present.
+        auto insert(std::uint64_t fp) -> bool {
+            if (fp == 0) fp = 1;
+            if ((m_size + 1) * 2 > m_slots.size()) grow();
+            auto mask = m_slots.size() - 1;
+            for (auto i = static_cast<std::size_t>(fp) & mask;; i = (i + 1) & mask) {
+                auto& slot = m_slots[i];
+                if (slot == fp) return false;
+                if (slot == 0) {
+                    slot = fp;
+                    ++m_size;
+                    return true;
+                }
+            }
+        }
+
+        auto contains(std::uint64_t fp) const noexcept -> bool {
+            if (fp == 0) fp = 1;
+            if (m_slots.empty()) return false;
+            auto mask = m_slots.size() - 1;
+            for (auto i = static_cast<std::size_t>(fp) & mask;; i = (i + 1) & mask) {
+                if (m_slots[i] == fp) return true;
+                if (m_slots[i] == 0) return false;
+            }
+        }
+
+        constexpr auto size() const noexcept -> std::size_t { return m_size; }
+        constexpr auto empty() const noexcept -> bool { return m_size == 0; }
+
+        // Keeps the table so that refilling it doesn't allocate.
+        auto clear() noexcept -> void {
+            std::fill(m_slots.begin(), m_slots.end(), 0);
+            m_size = 0;
+        }
+    private:
+        auto grow() -> void {
+            auto old = std::move(m_slots);
+            m_slots.assign(std::max<std::size_t>(old.size() * 2, 64), 0);
+            m_size = 0;
+            for (auto fp: old) {
+                if (fp != 0) insert(fp);
+            }
+        }
+    private:
+        std::vector<std::uint64_t> m_slots;
+        std::size_t m_size{};
+    };
+
+} // namespace dark::core
+
+#endif // AMT_DARK_DIAGNOSTICS_CORE_HASH_HPP
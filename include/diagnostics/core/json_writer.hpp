@@ -0,0 +1,200 @@
+#ifndef AMT_DARK_DIAGNOSTICS_CORE_JSON_WRITER_HPP
+#define AMT_DARK_DIAGNOSTICS_CORE_JSON_WRITER_HPP
+
+#include "buffer.hpp"
+#include "small_vec.hpp"
+#include "utf8.hpp"
+#include <cassert>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace dark::core {
+
+    /**
+     * @brief Streaming JSON writer that appends straight into a `Buffer`. It only tracks
+     *        the nesting to place the commas; nothing is built in memory, so the caller
+     *        must emit keys and values in a valid order.
+     * @code
+     *  auto w = JsonWriter(buffer);
+     *  w.begin_object()
+     *      .member("level", "error")
+     *      .key("spans").begin_array().value(1).value(2).end_array()
+     *  .end_object();
+     * @endcode
+     */
+    struct JsonWriter {
+        explicit JsonWriter(Buffer& out) noexcept
+            : m_out(&out)
+        {}
+
+        auto begin_object() -> JsonWriter& {
+            open('{');
+            return *this;
+        }
+
+        auto end_object() -> JsonWriter& {
+            close('}');
+            return *this;
+        }
+
+        auto begin_array() -> JsonWriter& {
+            open('[');
+            return *this;
+        }
+
+        auto end_array() -> JsonWriter& {
+            close(']');
+            return *this;
+        }
+
+        auto key(std::string_view name) -> JsonWriter& {
+            separate();
+            write_quoted(name);
+            m_out->push_back(':');
+            m_after_key = true;
+            return *this;
+        }
+
+        auto value(std::string_view str) -> JsonWriter& {
+            separate();
+            write_quoted(str);
+            return *this;
+        }
+
+        auto value(char const* str) -> JsonWriter& {
+            return value(std::string_view(str));
+        }
+
+        auto value(bool b) -> JsonWriter& {
+            separate();
+            m_out->append(b ? "true" : "false");
+            return *this;
+        }
+
+        template <std::integral T>
+            requires (!std::same_as<T, bool>)
+        auto value(T number) -> JsonWriter& {
+            separate();
+            char buffer[24];
+            auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), number);
+            assert(ec == std::errc{});
+            m_out->append(std::string_view(buffer, static_cast<std::size_t>(end - buffer)));
+            return *this;
+        }
+
+        auto null() -> JsonWriter& {
+            separate();
+            m_out->append("null");
+            return *this;
+        }
+
+        template <typename T>
+        auto member(std::string_view name, T&& v) -> JsonWriter& {
+            return key(name).value(std::forward<T>(v));
+        }
+
+        // Writes a string value in pieces, e.g. the parts of an annotated string.
+        auto begin_string() -> JsonWriter& {
+            separate();
+            m_out->push_back('"');
+            return *this;
+        }
+
+        auto append_string(std::string_view str) -> JsonWriter& {
+            write_escaped(str);
+            return *this;
+        }
+
+        auto end_string() -> JsonWriter& {
+            m_out->push_back('"');
+            return *this;
+        }
+
+        constexpr auto depth() const noexcept -> std::size_t { return m_has_items.size(); }
+
+    private:
+        auto open(char c) -> void {
+            separate();
+            m_out->push_back(c);
+            m_has_items.push_back(false);
+        }
+
+        auto close(char c) -> void {
+            assert(!m_has_items.empty() && "unbalanced JSON nesting");
+            m_has_items.pop_back();
+            m_out->push_back(c);
+        }
+
+        // Puts a comma between the items of an object or an array.
+        auto separate() -> void {
+            if (m_after_key) {
+                m_after_key = false;
+                return;
+            }
+            if (m_has_items.empty()) return;
+            if (m_has_items.back()) m_out->push_back(',');
+            m_has_items.back() = true;
+        }
+
+        auto write_quoted(std::string_view str) -> void {
+            m_out->push_back('"');
+            write_escaped(str);
+            m_out->push_back('"');
+        }
+
+        // Bytes that aren't valid UTF-8 are replaced by U+FFFD, one per byte, since strict
+        // parsers reject the whole document otherwise.
+        auto write_escaped(std::string_view str) -> void {
+            static constexpr char hex[] = "0123456789abcdef";
+            static constexpr std::string_view replacement = "\xEF\xBF\xBD";
+            auto start = std::size_t{};
+            for (auto i = std::size_t{}; i < str.size();) {
+                auto c = static_cast<unsigned char>(str[i]);
+                if (c >= 0x80) {
+                    auto len = utf8::valid_length(str, i);
+                    if (len != 0) {
+                        i += len;
+                        continue;
+                    }
+                    m_out->append(str.substr(start, i - start));
+                    m_out->append(replacement);
+                    start = ++i;
+                    continue;
+                }
+                if (c >= 0x20 && c != '"' && c != '\\') {
+                    ++i;
+                    continue;
+                }
+
+                m_out->append(str.substr(start, i - start));
+                start = ++i;
+                switch (c) {
+                    case '"': m_out->append("\\\""); break;
+                    case '\\': m_out->append("\\\\"); break;
+                    case '\n': m_out->append("\\n"); break;
+                    case '\r': m_out->append("\\r"); break;
+                    case '\t': m_out->append("\\t"); break;
+                    case '\b': m_out->append("\\b"); break;
+                    case '\f': m_out->append("\\f"); break;
+                    default: {
+                        char escaped[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                        m_out->append(std::string_view(escaped, sizeof(escaped)));
+                    }
+                }
+            }
+            m_out->append(str.substr(start));
+        }
+
+    private:
+        Buffer* m_out;
+        SmallVec<bool, 16> m_has_items{};
+        bool m_after_key{false};
+    };
+
+} // namespace dark::core
+
+#endif // AMT_DARK_DIAGNOSTICS_CORE_JSON_WRITER_HPP
@@ -0,0 +1,91 @@
+#ifndef AMT_DARK_DIAGNOSTICS_CORE_MPSC_QUEUE_HPP
+#define AMT_DARK_DIAGNOSTICS_CORE_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace dark::core {
+
+    /**
+     * @brief Unbounded lock-free multi-producer single-consumer queue.
+     *        Producers only perform one atomic exchange and one release store, so
+     *        pushing never blocks or spins on other producers. Only one thread
+     *        at a time is allowed to call `pop`.
+     * @note A producer that got preempted between the exchange and the link may
+     *       briefly hide the items pushed after it; `pop` then reports an empty
+     *       queue and the items become visible once the producer resumes. An item
+     *       is only counted once it's linked, so the size never includes an item
+     *       whose producer is still in the middle of `push`.
+     */
+    template <typename T>
+    struct MPSCQueue {
+    private:
+        struct Node {
+            std::atomic<Node*> next{nullptr};
+            std::optional<T> value{};
+        };
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+
+        MPSCQueue() noexcept
+            : m_head(&m_stub)
+            , m_tail(&m_stub)
+        {}
+        MPSCQueue(MPSCQueue const&) = delete;
+        MPSCQueue(MPSCQueue &&) = delete;
+        MPSCQueue& operator=(MPSCQueue const&) = delete;
+        MPSCQueue& operator=(MPSCQueue &&) = delete;
+
+        ~MPSCQueue() {
+            while (pop()) {}
+            if (m_tail != &m_stub) delete m_tail;
+        }
+
+        // Safe to call from any number of threads.
+        auto push(T value) -> void {
+            auto* node = new Node{};
+            node->value.emplace(std::move(value));
+            auto* prev = m_head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+            m_size.fetch_add(1);
+        }
+
+        // Must only be called from the consumer side.
+        auto pop() -> std::optional<T> {
+            auto* tail = m_tail;
+            auto* next = tail->next.load(std::memory_order_acquire);
+            if (next == nullptr) return std::nullopt;
+
+            // `next` becomes the new dummy node after its value is moved out.
+            auto res = std::move(next->value);
+            next->value.reset();
+            m_tail = next;
+            if (tail != &m_stub) delete tail;
+            m_size.fetch_sub(1);
+            return res;
+        }
+
+        // Approximate number of items; exact only when producers are quiescent.
+        auto size() const noexcept -> size_type {
+            // An item can be popped right before its producer counts it.
+            auto size = m_size.load();
+            return size > 0 ? static_cast<size_type>(size) : 0;
+        }
+
+        auto empty() const noexcept -> bool {
+            return size() == 0;
+        }
+
+    private:
+        alignas(64) std::atomic<Node*> m_head;
+        alignas(64) Node* m_tail;
+        std::atomic<std::ptrdiff_t> m_size{0};
+        Node m_stub{};
+    };
+
+} // namespace dark::core
+
+#endif // AMT_DARK_DIAGNOSTICS_CORE_MPSC_QUEUE_HPP
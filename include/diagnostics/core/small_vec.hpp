@@ -59,7 +59,9 @@ namespace dark::core {
             if (other.is_small()) {
                 auto lhs = data();
                 auto rhs = other.data();
-                std::move(rhs, rhs + size(), lhs);
+                // The inline buffer is raw storage, so the elements are constructed rather than assigned.
+                std::uninitialized_move(rhs, rhs + size(), lhs);
+                std::destroy(rhs, rhs + size());
             } else {
                 m_data.dyn = std::exchange(other.m_data.dyn, nullptr); 
             }
@@ -74,16 +76,10 @@ namespace dark::core {
         }
         SmallVec& operator=(SmallVec&& other) noexcept {
             if (this == &other) return *this;
-            m_size = other.m_size;
-            m_capacity = other.m_capacity;
-
-            if (other.is_small()) {
-                std::move(other.begin(), other.end(), begin());
-            } else {
-                m_data.dyn = std::exchange(other.m_data.dyn, nullptr); 
-            }
-            other.m_size = 0;
-            other.m_capacity = 0;
+            // Steal through a temporary so the old buffer is released with the
+            // allocator that owns it and the allocator travels with the storage.
+            auto tmp = SmallVec(std::move(other));
+            swap(*this, tmp);
             return *this;
         }
         ~SmallVec() {
@@ -231,6 +227,8 @@ namespace dark::core {
             return self.data();
         }
 
+        auto get_allocator() const noexcept -> allocator_t { return m_alloc; }
+
         auto begin() noexcept -> iterator { return data(); }
         auto end() noexcept -> iterator { return data() + size(); }
 
@@ -292,7 +290,9 @@ namespace dark::core {
                     while (ns < n) ns *= growth_factor;
 
                     auto ptr = m_alloc.allocate(ns);
-                    std::move(begin(), end(), ptr);
+                    // The new buffer is raw storage, so the elements are constructed rather than assigned.
+                    std::uninitialized_move(begin(), end(), ptr);
+                    std::destroy(begin(), end());
                     m_data.dyn = reinterpret_cast<TypeWrapper*>(ptr);
                     m_capacity = ns;
                 }
@@ -301,7 +301,8 @@ namespace dark::core {
                 while (ns < n) ns *= growth_factor;
 
                 auto ptr = m_alloc.allocate(ns);
-                std::move(begin(), end(), ptr);
+                std::uninitialized_move(begin(), end(), ptr);
+                std::destroy(begin(), end());
                 auto old_ptr = reinterpret_cast<pointer>(m_data.dyn);
                 m_alloc.deallocate(old_ptr, capacity());
                 m_capacity = ns;
@@ -429,7 +430,7 @@ namespace dark::core {
         }
 
         auto push_back(value_type&& val) -> void {
-            m_data.push_back(val);
+            m_data.push_back(std::move(val));
         }
 
         auto pop_back() -> void {
@@ -2,6 +2,7 @@
 #define AMT_DARK_DIAGNOSTICS_TERM_ANNOTATED_STRING_HPP
 
 #include "../small_vec.hpp"
+#include "../arena.hpp"
 #include "../cow_string.hpp"
 #include "style.hpp"
 #include <cctype>
@@ -35,7 +36,7 @@ namespace dark::term {
     };
 
     struct AnnotatedString {
-        using base_type = core::SmallVec<std::pair<core::CowString, SpanStyle>>;
+        using base_type = core::ArenaSmallVec<std::pair<core::CowString, SpanStyle>>;
         base_type strings;
 
         struct Builder {
@@ -352,6 +352,7 @@ namespace dark::term {
         template <typename T>
         auto render(Terminal<T>& term) const noexcept -> void {
             auto const& self = *this;
+            term.reserve((m_max_rows_written + 1) * (cols() + 1));
             for (auto i = 0ul; i <= m_max_rows_written; ++i) {
                 auto new_cols = 0ul;
                 auto found_char{false};
@@ -411,8 +412,8 @@ namespace dark::term {
         }
 
         constexpr auto draw_pixel(
-            dsize_t x,
-            dsize_t y,
+            doffset_t x,
+            doffset_t y,
             std::string_view ch,
             Style const& style = {}
         ) noexcept {
@@ -440,10 +441,10 @@ namespace dark::term {
         // |
         // -----------------
         constexpr auto draw_line(
-            dsize_t x1,
-            dsize_t y1,
-            dsize_t x2,
-            dsize_t y2,
+            doffset_t x1,
+            doffset_t y1,
+            doffset_t x2,
+            doffset_t y2,
             Style const& style = {},
             bool top_bias = false,
             LineCharSet normal_set = char_set::line::rounded,
@@ -729,10 +730,10 @@ namespace dark::term {
         }
 
         constexpr auto draw_box(
-            dsize_t x,
-            dsize_t y,
-            dsize_t width,
-            dsize_t height,
+            doffset_t x,
+            doffset_t y,
+            doffset_t width,
+            doffset_t height,
             Style style = {},
             BoxCharSet normal_set = char_set::box::rounded,
             BoxCharSet bold_set = char_set::box::rounded_bold
@@ -840,8 +841,8 @@ namespace dark::term {
 
         auto draw_text(
             std::string_view text,
-            dsize_t x,
-            dsize_t y,
+            doffset_t x,
+            doffset_t y,
             TextStyle style = {}
         ) noexcept -> TextRenderResult {
             auto as = AnnotatedString{};
@@ -852,8 +853,8 @@ namespace dark::term {
         template <bool ShouldDraw = true>
         constexpr auto draw_text(
             AnnotatedString const& as,
-            dsize_t x,
-            dsize_t y,
+            doffset_t x,
+            doffset_t y,
             TextStyle style = {}
         ) noexcept -> TextRenderResult {
             auto padding = style.padding;
@@ -866,7 +867,7 @@ namespace dark::term {
             auto container = BoundingBox {
                 .x = x,
                 .y = y,
-                .width = static_cast<dsize_t>(max_space),
+                .width = static_cast<doffset_t>(max_space),
                 .height = 0
             };
 
@@ -896,7 +897,7 @@ namespace dark::term {
                 );
 
                 y += std::max(bottom_padding, padding.bottom) + 1;
-                auto width = std::min(x, static_cast<dsize_t>(cols() - 1)) - bbox.x;
+                auto width = std::min(x, static_cast<doffset_t>(cols() - 1)) - bbox.x;
                 return {
                     .bbox = BoundingBox(
                         bbox.x,
@@ -964,8 +965,8 @@ namespace dark::term {
 
         auto measure_text(
             AnnotatedString const& s,
-            dsize_t x,
-            dsize_t y,
+            doffset_t x,
+            doffset_t y,
             TextStyle style = {}
         ) noexcept -> BoundingBox {
             auto tmp = draw_text<false>(s, x, y, style);
@@ -974,8 +975,8 @@ namespace dark::term {
 
         auto draw_boxed_text(
             std::string_view text,
-            dsize_t x,
-            dsize_t y,
+            doffset_t x,
+            doffset_t y,
             TextStyle style = {},
             BoxCharSet normal_set = char_set::box::rounded,
             BoxCharSet bold_set = char_set::box::rounded_bold
@@ -993,13 +994,13 @@ namespace dark::term {
 
         constexpr auto draw_boxed_text(
             AnnotatedString const& text,
-            dsize_t x,
-            dsize_t y,
+            doffset_t x,
+            doffset_t y,
             TextStyle style = {},
             BoxCharSet normal_set = char_set::box::rounded,
             BoxCharSet bold_set = char_set::box::rounded_bold
         ) noexcept -> TextRenderResult {
-            style.max_width = std::min(dsize_t(cols() - 2), style.max_width);
+            style.max_width = std::min(doffset_t(cols() - 2), style.max_width);
             auto [bbox, left] = draw_text(
                 std::move(text),
                 x + 1, y + 1,
@@ -1015,8 +1016,8 @@ namespace dark::term {
         constexpr auto draw_boxed_text_with_header(
             AnnotatedString const& header,
             AnnotatedString const& text,
-            dsize_t x,
-            dsize_t y,
+            doffset_t x,
+            doffset_t y,
             TextStyle body_style = {},
             TextStyle header_style = TextStyle::default_header_style(),
             BoxCharSet normal_set = char_set::box::rounded,
@@ -1057,8 +1058,8 @@ namespace dark::term {
         auto draw_boxed_text_with_header(
             std::string_view header,
             std::string_view text,
-            dsize_t x,
-            dsize_t y,
+            doffset_t x,
+            doffset_t y,
             TextStyle body_style = {},
             TextStyle header_style = TextStyle::default_header_style(),
             BoxCharSet normal_set = char_set::box::rounded,
@@ -1078,8 +1079,8 @@ namespace dark::term {
         auto draw_boxed_text_with_header(
             std::string_view header,
             AnnotatedString const& text,
-            dsize_t x,
-            dsize_t y,
+            doffset_t x,
+            doffset_t y,
             TextStyle body_style = {},
             TextStyle header_style = TextStyle::default_header_style(),
             BoxCharSet normal_set = char_set::box::rounded,
@@ -1099,8 +1100,8 @@ namespace dark::term {
         auto draw_boxed_text_with_header(
             AnnotatedString const& header,
             std::string_view text,
-            dsize_t x,
-            dsize_t y,
+            doffset_t x,
+            doffset_t y,
             TextStyle body_style = {},
             TextStyle header_style = TextStyle::default_header_style(),
             BoxCharSet normal_set = char_set::box::rounded,
@@ -1120,8 +1121,8 @@ namespace dark::term {
         constexpr auto draw_marked_text(
             std::string_view text,
             std::string_view marker,
-            dsize_t x,
-            dsize_t y,
+            doffset_t x,
+            doffset_t y,
             TextStyle style = {},
             Color marker_color = Color::Default
         ) noexcept -> TextRenderResult {
@@ -1133,9 +1134,9 @@ namespace dark::term {
             auto tmp = core::utf8::PackedUTF8(marker);
             style.text_color = marker_color;
 
-            dsize_t step = std::min(static_cast<dsize_t>(tmp.size()), bbox.width);
+            doffset_t step = std::min(static_cast<doffset_t>(tmp.size()), bbox.width);
 
-            dsize_t tmp_x = bbox.x;
+            doffset_t tmp_x = bbox.x;
             for (auto k = 0u; k < bbox.width; k += step) {
                 auto kb = std::min(step, bbox.width - k);
                 for (auto i = 0ul; i < kb; ++i) {
@@ -1153,8 +1154,8 @@ namespace dark::term {
             unsigned cols_occupied{};
             bool can_overflow{false};
             unsigned global_size{};
-            Span start_overflow{};
-            Span middle_overflow{};
+            RelSpan start_overflow{};
+            RelSpan middle_overflow{};
             std::size_t word_boundary; // global index to word end before cutting off
             // Minimum line boundry that would fit the line.
             std::pair<std::size_t, std::size_t> min_line_boundary;
@@ -1177,10 +1178,10 @@ namespace dark::term {
             auto max_width = std::max(container.width, style.padding.right) - style.padding.right;
 
             // auto mid = total_occupied_cols / 2;
-            auto left_size = (std::max(max_width, dsize_t{3}) - 3) / 2;
+            auto left_size = (std::max(max_width, doffset_t{3}) - 3) / 2;
 
             auto overflow_portion = std::max(total_occupied_cols, max_width) - max_width;
-            auto middle_overflow_start = dsize_t{};
+            auto middle_overflow_start = doffset_t{};
 
             for (auto i = chunk_start; i < strs.size(); ++i) {
                 auto const& el = strs[i];
@@ -1191,7 +1192,7 @@ namespace dark::term {
                 if (total_occupied_cols != 0) {
                     if (res.start_overflow.empty()) {
                         if (total_occupied_cols < max_width + res.cols_occupied) {
-                            res.start_overflow = Span(0, res.global_size);
+                            res.start_overflow = RelSpan(0, res.global_size);
                         }
                     }
                     if (res.middle_overflow.empty()) {
@@ -1199,7 +1200,7 @@ namespace dark::term {
                             middle_overflow_start = res.global_size;
                         }
                         if (res.cols_occupied >= overflow_portion + left_size) {
-                            res.middle_overflow = Span(middle_overflow_start, res.global_size);
+                            res.middle_overflow = RelSpan(middle_overflow_start, res.global_size);
                         }
                     }
                 }
@@ -1233,7 +1234,7 @@ namespace dark::term {
                     if (total_occupied_cols != 0) {
                         if (res.start_overflow.empty()) {
                             if (total_occupied_cols < max_width + res.cols_occupied) {
-                                res.start_overflow = Span(0, res.global_size);
+                                res.start_overflow = RelSpan(0, res.global_size);
                             }
                         }
                         if (res.middle_overflow.empty()) {
@@ -1241,7 +1242,7 @@ namespace dark::term {
                                 middle_overflow_start = res.global_size;
                             }
                             if (res.cols_occupied >= overflow_portion + left_size) {
-                                res.middle_overflow = Span(middle_overflow_start, res.global_size);
+                                res.middle_overflow = RelSpan(middle_overflow_start, res.global_size);
                             }
                         }
                     }
@@ -1258,7 +1259,7 @@ namespace dark::term {
                 if (total_occupied_cols != 0) {
                     if (res.start_overflow.empty()) {
                         if (total_occupied_cols < max_width + res.cols_occupied) {
-                            res.start_overflow = Span(0, res.global_size);
+                            res.start_overflow = RelSpan(0, res.global_size);
                         }
                     }
                     if (res.middle_overflow.empty()) {
@@ -1266,7 +1267,7 @@ namespace dark::term {
                             middle_overflow_start = res.global_size;
                         }
                         if (res.cols_occupied >= overflow_portion + left_size) {
-                            res.middle_overflow = Span(middle_overflow_start, res.global_size);
+                            res.middle_overflow = RelSpan(middle_overflow_start, res.global_size);
                         }
                     }
                 }
@@ -1284,11 +1285,11 @@ namespace dark::term {
             AnnotatedString const& as,
             std::size_t chunk_start,
             std::size_t text_start,
-            dsize_t& x,
-            dsize_t y,
+            doffset_t& x,
+            doffset_t y,
             BoundingBox container,
             TextStyle style = {},
-            dsize_t current_line = 1
+            doffset_t current_line = 1
         ) noexcept -> std::tuple<std::size_t, std::size_t, unsigned, std::size_t> {
             if (current_line > style.max_lines) return {
                 chunk_start, text_start, 0, 0
@@ -1334,7 +1335,7 @@ namespace dark::term {
             ](
                 std::size_t& chunk_start,
                 std::size_t& text_start,
-                Span overflow_section,
+                RelSpan overflow_section,
                 unsigned cols_occupied,
                 std::size_t chunk_end = std::string_view::npos,
                 std::size_t text_end = std::string_view::npos
@@ -1342,7 +1343,7 @@ namespace dark::term {
                  // compiler complains about the no being used even though we're are using it.
                 (void)this;
                 auto y = y_start;
-                auto global_index = dsize_t{};
+                auto global_index = doffset_t{};
                 auto needs_underline{false};
                 chunk_end = std::min(as.strings.size(), chunk_end);
                 if (chunk_start >= chunk_end) return { false, 0 };
@@ -1363,9 +1364,9 @@ namespace dark::term {
                 for (auto i = chunk_start; i < chunk_end; ++i) {
                     auto const& el = as.strings[i];
                     auto text = el.first.to_borrowed();
-                    auto len = static_cast<dsize_t>(core::utf8::calculate_size(text));
+                    auto len = static_cast<doffset_t>(core::utf8::calculate_size(text));
 
-                    auto span = Span::from_size(global_index, len);
+                    auto span = RelSpan::from_size(global_index, len);
 
                     if (overflow_section.force_merge(span) != overflow_section) {
                         auto padding = el.second.padding.value_or(PaddingValues());
@@ -1485,7 +1486,7 @@ namespace dark::term {
                 if (style.max_lines == current_line && cols_occupied > max_x) {
                     if (style.overflow == TextOverflow::ellipsis) {
                         auto st = as.strings[std::min(chunk_start, as.strings.size() - 1)].second.to_style(style);
-                        start_x = std::max({x, max_x, dsize_t{3}}) - 3;
+                        start_x = std::max({x, max_x, doffset_t{3}}) - 3;
                         for (auto i = 0ul; i < 3 && start_x < max_x; ++i) {
                             if constexpr (ShouldDraw) {
                                 draw_pixel(start_x++, y, ".", st);
@@ -1546,10 +1547,10 @@ namespace dark::term {
                         text_end = width_info.word_boundary;
                     }
 
-                    auto overflow_span = Span();
+                    auto overflow_span = RelSpan();
                     if (style.overflow == TextOverflow::start_ellipsis) {
                         overflow_span = width_info.start_overflow;
-                        overflow_span = Span(
+                        overflow_span = RelSpan(
                             overflow_span.start(),
                             overflow_span.end() + 6
                         );
@@ -1585,7 +1586,7 @@ namespace dark::term {
         size_type m_rows{};
         size_type m_cols{};
         std::vector<Cell> m_cells;
-        dsize_t m_max_rows_written{};
+        doffset_t m_max_rows_written{};
     };
 
 } // namespace dark::term
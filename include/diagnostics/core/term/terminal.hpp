@@ -81,6 +81,14 @@ namespace dark {
             return *this;
         }
 
+        // Hints that about `bytes` bytes are about to be written; only in-memory writers use it.
+        auto reserve(std::size_t bytes) -> Terminal& {
+            if constexpr (requires { m_writer.reserve(bytes); }) {
+                m_writer.reserve(bytes);
+            }
+            return *this;
+        }
+
         auto write(
             std::string_view str,
             Color textColor,
@@ -193,6 +201,10 @@ namespace dark {
             m_color_enabled = enable;
         }
 
+        constexpr auto colors_enabled() const noexcept -> bool {
+            return m_color_enabled;
+        }
+
         auto columns() noexcept -> std::size_t {
             return m_writer.columns();
         }
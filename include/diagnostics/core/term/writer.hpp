@@ -1,11 +1,15 @@
 #ifndef AMT_DARK_DIAGNOSTICS_CORE_WRITER_HPP
 #define AMT_DARK_DIAGNOSTICS_CORE_WRITER_HPP
 
+#include "../buffer.hpp"
 #include "color.hpp"
 #include "config.hpp"
 #include "style.hpp"
 #include <cstdio>
+#include <format>
+#include <iterator>
 #include <print>
+#include <string>
 #include <utility>
 
 namespace dark {
@@ -47,6 +51,63 @@ namespace dark {
         FILE* m_handle;
     };
 
+    namespace detail {
+        /**
+         * @brief Appends the output to an in-memory container, e.g. to render a diagnostic
+         *        on another thread and write it out later. The column count is fixed by the
+         *        caller, usually to the width of the terminal the text ends up on, and the
+         *        color mode is passed to the `Terminal` explicitly.
+         */
+        template <typename Container>
+        struct MemoryWriter {
+            static constexpr std::size_t default_columns = 80;
+
+            constexpr MemoryWriter(Container& out, std::size_t columns = default_columns) noexcept
+                : m_out(&out)
+                , m_columns(columns)
+            {}
+
+            constexpr auto is_displayed() const noexcept -> bool {
+                return false;
+            }
+
+            auto write(std::string_view str) -> void {
+                m_out->append(str);
+            }
+
+            template <typename... Args>
+            auto write(std::format_string<Args...> fmt, Args&&... args) -> void {
+                std::format_to(std::back_inserter(*m_out), fmt, std::forward<Args>(args)...);
+            }
+
+            constexpr auto flush() noexcept -> void {}
+
+            constexpr auto columns() noexcept -> std::size_t {
+                return m_columns;
+            }
+
+            // Makes room for `bytes` more bytes of output.
+            auto reserve(std::size_t bytes) -> void {
+                m_out->reserve(m_out->size() + bytes);
+            }
+
+        private:
+            Container* m_out;
+            std::size_t m_columns;
+        };
+    } // namespace detail
+
+    template <>
+    struct Writer<std::string>: detail::MemoryWriter<std::string> {
+        using MemoryWriter::MemoryWriter;
+    };
+
+    // Preferred over `std::string` since growing it doesn't zero the new bytes.
+    template <>
+    struct Writer<core::Buffer>: detail::MemoryWriter<core::Buffer> {
+        using MemoryWriter::MemoryWriter;
+    };
+
     namespace detail {
         template <typename T>
         concept WriterHasHandle = requires (Writer<T> const& w) {
@@ -2,6 +2,9 @@
 #define AMT_DARK_DIAGNOSTIC_CORE_UTF8_HPP
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 #include "diagnostics/core/config.hpp"
 #include "small_vec.hpp"
 
@@ -26,6 +29,42 @@ namespace dark::core::utf8 {
         return size;
     }
 
+    /**
+     * @brief Length of the well-formed sequence starting at `pos`, or zero if the bytes
+     *        there aren't valid UTF-8, e.g. a stray continuation byte, a truncated
+     *        sequence, an overlong form, a surrogate or a code point past U+10FFFF.
+     */
+    constexpr auto valid_length(std::string_view str, std::size_t pos) noexcept -> std::size_t {
+        auto byte = [str](std::size_t i) { return static_cast<std::uint8_t>(str[i]); };
+        auto lead = byte(pos);
+        if (lead < 0x80) return 1;
+
+        // Range of the second byte; the narrower ones rule out overlongs and surrogates.
+        auto len = std::size_t{};
+        auto lo = std::uint8_t{0x80};
+        auto hi = std::uint8_t{0xBF};
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            len = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            len = 3;
+            if (lead == 0xE0) lo = 0xA0;
+            if (lead == 0xED) hi = 0x9F;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            len = 4;
+            if (lead == 0xF0) lo = 0x90;
+            if (lead == 0xF4) hi = 0x8F;
+        } else {
+            return 0;
+        }
+
+        if (str.size() - pos < len) return 0;
+        if (byte(pos + 1) < lo || byte(pos + 1) > hi) return 0;
+        for (auto i = pos + 2; i < pos + len; ++i) {
+            if ((byte(i) & 0xC0) != 0x80) return 0;
+        }
+        return len;
+    }
+
     struct PackedUTF8 {
     private:
         struct Wrapper {
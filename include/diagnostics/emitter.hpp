@@ -1,33 +1,72 @@
 #ifndef AMT_DARK_DIAGNOSTICS_EMITTER_HPP
 #define AMT_DARK_DIAGNOSTICS_EMITTER_HPP
 
+#include "catalog.hpp"
 #include "converter.hpp"
+#include "filter.hpp"
+#include "limits.hpp"
+#include "pool.hpp"
 #include "consumers/base.hpp"
 #include "core/small_vec.hpp"
 #include "core/function_ref.hpp"
+#include "core/mpsc_queue.hpp"
 #include "builders/diagnostic.hpp"
 #include "diagnostics/basic.hpp"
 #include "diagnostics/core/format_any.hpp"
 #include "forward.hpp"
+#include <atomic>
+#include <cstdint>
 
 namespace dark {
+
+    enum class DiagnosticEmitterMode: std::uint8_t {
+        // Diagnostics are handed to the consumer on the emitting thread.
+        Sequential = 0,
+        // Diagnostics are built on the emitting thread and pushed into a lock-free
+        // queue that is drained into the consumer chain by one thread at a time.
+        // Annotation scopes are tracked per thread.
+        Concurrent
+    };
+
     template <typename LocT>
     struct DiagnosticEmitter {
         using builder_t = builder::DiagnosticBuilder<LocT>;
+        using annotation_fn_t = core::FunctionRef<void(builder_t&)>;
+
+        // Upper bound on the diagnostics handed to `consume_batch` per call while draining.
+        static constexpr std::size_t max_drain_batch = 64;
 
+        /**
+         * @param converter converts `LocT` into `DiagnosticLocation`. In concurrent mode
+         *        `convert_loc` is called from the emitting threads, so it must be safe to
+         *        call concurrently.
+         * @param consumer the consumer chain. It's never called concurrently, even in
+         *        concurrent mode.
+         * @param mode sequential or concurrent emission.
+         */
         constexpr DiagnosticEmitter(
             DiagnosticConverter<LocT>* converter,
-            DiagnosticConsumer* consumer
+            DiagnosticConsumer* consumer,
+            DiagnosticEmitterMode mode = DiagnosticEmitterMode::Sequential
         )
             : m_converter(converter)
             , m_consumer(consumer)
+            , m_mode(mode)
         {
             assert(converter != nullptr);
             assert(consumer != nullptr);
         }
 
+        DiagnosticEmitter(DiagnosticEmitter const&) = delete;
+        DiagnosticEmitter(DiagnosticEmitter &&) = delete;
+        DiagnosticEmitter& operator=(DiagnosticEmitter const&) = delete;
+        DiagnosticEmitter& operator=(DiagnosticEmitter &&) = delete;
+
         template <core::IsFormattable... Args>
         [[nodiscard("Missing `emit()` call")]] auto error(LocT loc, internal::DiagnosticBase<Args...> const& base, Args... args) -> builder_t {
+            if (!should_build(DiagnosticLevel::Error, base.kind, loc)) return builder_t();
+            // Ends with this call, so only the diagnostic and its message come from the arena.
+            auto scope = core::Arena::Scope(m_arena);
             return builder_t(
                 this,
                 loc,
@@ -39,6 +78,9 @@ namespace dark {
 
         template <core::IsFormattable... Args>
         [[nodiscard("Missing `emit()` call")]] auto warn(LocT loc, internal::DiagnosticBase<Args...> const& base, Args... args) -> builder_t {
+            if (!should_build(DiagnosticLevel::Warning, base.kind, loc)) return builder_t();
+            // Ends with this call, so only the diagnostic and its message come from the arena.
+            auto scope = core::Arena::Scope(m_arena);
             return builder_t(
                 this,
                 loc,
@@ -48,17 +90,248 @@ namespace dark {
             );
         }
 
-        ~DiagnosticEmitter() { m_consumer->flush(); }
+        // Emits at the default level of the kind's catalog entry; kinds outside the catalog are errors.
+        template <core::IsFormattable... Args>
+        [[nodiscard("Missing `emit()` call")]] auto report(LocT loc, internal::DiagnosticBase<Args...> const& base, Args... args) -> builder_t {
+            auto const* entry = m_catalog.find(base.kind);
+            if (entry && entry->level == DiagnosticLevel::Warning) return warn(loc, base, std::forward<Args>(args)...);
+            return error(loc, base, std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Rules checked before a diagnostic is built. Disabled diagnostics get an
+         *        inert builder, so neither the arguments nor the location are converted.
+         * @note It must not be modified while other threads are emitting.
+         */
+        constexpr auto filter() noexcept -> DiagnosticFilter& { return m_filter; }
+        constexpr auto filter() const noexcept -> DiagnosticFilter const& { return m_filter; }
+
+        auto is_enabled(DiagnosticLevel level, detail::diagnostic_kind_t kind, LocT const& loc) const -> bool {
+            if (!m_filter.is_enabled(level, kind)) return false;
+            if (!m_filter.has_file_rules()) return true;
+            return m_filter.is_file_enabled(m_converter->source_filename(loc));
+        }
+
+        /**
+         * @brief Error limit and per-kind caps. Diagnostics over a cap get an inert builder
+         *        and a summary of the suppressed ones is emitted on `flush()`.
+         */
+        constexpr auto limits() noexcept -> DiagnosticLimits& { return m_limits; }
+        constexpr auto limits() const noexcept -> DiagnosticLimits const& { return m_limits; }
+
+        // Kinds found in the catalog get their default level from `report` and are named by
+        // their code in the suppression summary.
+        constexpr auto set_catalog(DiagnosticCatalogView catalog) noexcept -> void { m_catalog = catalog; }
+        constexpr auto catalog() const noexcept -> DiagnosticCatalogView { return m_catalog; }
+
+        constexpr auto mode() const noexcept -> DiagnosticEmitterMode { return m_mode; }
+
+        constexpr auto is_concurrent() const noexcept -> bool {
+            return m_mode == DiagnosticEmitterMode::Concurrent;
+        }
+
+        /**
+         * @brief Hands every queued diagnostic to the consumer. In sequential mode
+         *        the queue is always empty. If another thread is already draining,
+         *        this returns immediately and that thread picks up the remaining items.
+         */
+        auto drain() -> void {
+            if (!is_concurrent()) return;
+            do {
+                // Sequentially consistent so that a producer whose own `drain` bails out here
+                // has counted its item before the flag is released below.
+                if (m_draining.test_and_set()) return;
+                while (auto diag = m_queue.pop()) {
+                    m_batch.push_back(std::move(*diag));
+                    if (m_batch.size() < max_drain_batch) continue;
+                    consume_drained_batch();
+                }
+                consume_drained_batch();
+                m_draining.clear();
+                // A producer may have pushed after the last pop but before the
+                // flag was released, and its own `drain` call would have bailed out.
+                // Items are only counted once linked, so a producer preempted in the middle
+                // of `push` doesn't keep this loop spinning; it drains its item itself.
+            } while (!m_queue.empty());
+        }
+
+        /**
+         * @brief Defers `convert_loc` until a consumer calls `Diagnostic::resolve_location()`.
+         *        Only applies to converters that support deferred conversion and to
+         *        trivially copyable locations of at most `DeferredLocation::max_location_size`
+         *        bytes, and the converter must outlive every diagnostic it produced.
+         */
+        constexpr auto defer_location_conversion(bool enable = true) noexcept -> void {
+            m_defer_location = enable;
+        }
+
+        constexpr auto is_location_conversion_deferred() const noexcept -> bool {
+            return m_defer_location;
+        }
+
+        /**
+         * @brief Attaches an arena that backs the containers and large format arguments
+         *        of every diagnostic built afterwards. Pass `nullptr` to detach.
+         * @note The arena isn't thread-safe, so it can only be used in sequential mode.
+         */
+        auto set_arena(DiagnosticArena* arena) noexcept -> void {
+            assert((arena == nullptr || !is_concurrent()) && "Arena cannot be used by a concurrent emitter");
+            m_arena = arena;
+        }
+
+        constexpr auto arena() const noexcept -> DiagnosticArena* { return m_arena; }
+
+        /**
+         * @brief Flushes the consumer chain and rewinds the arena in O(1). Consumers
+         *        must not hold on to diagnostics after they have been flushed.
+         */
+        auto flush_and_reset_arena() -> void {
+            flush();
+            if (m_arena) m_arena->reset();
+        }
+
+        /**
+         * @brief Diagnostics are built from this pool while no arena is attached.
+         *        Consumers that are done with a diagnostic can hand it back with
+         *        `pool().release(std::move(diagnostic))` to reuse its capacity.
+         */
+        constexpr auto pool() noexcept -> DiagnosticPool& { return m_pool; }
+
+        /**
+         * @brief Drains the queue and flushes the consumer chain.
+         * @note In concurrent mode, it must not race with emitting threads if the
+         *       caller expects every diagnostic to be flushed.
+         */
+        auto flush() -> void {
+            drain();
+            emit_suppressed_summary();
+            m_consumer->flush();
+        }
+
+        ~DiagnosticEmitter() { flush(); }
     private:
         template <typename L, typename A>
         friend struct DiagnosticAnnotationScope;
 
         friend struct DiagnosticEmitter<LocT>;
         friend struct builder::DiagnosticBuilder<LocT>;
+
+        struct ThreadAnnotation {
+            DiagnosticEmitter const* emitter;
+            annotation_fn_t fn;
+        };
+
+        // Every thread keeps its own scope stack so scopes opened by one worker
+        // never leak into diagnostics emitted by another.
+        static auto thread_annotations() noexcept -> core::SmallVec<ThreadAnnotation>& {
+            static thread_local core::SmallVec<ThreadAnnotation> stack;
+            return stack;
+        }
+
+        auto push_annotation(annotation_fn_t fn) -> void {
+            if (is_concurrent()) thread_annotations().push_back({ .emitter = this, .fn = fn });
+            else m_annotations.push_back(fn);
+        }
+
+        auto pop_annotation() -> void {
+            if (!is_concurrent()) {
+                m_annotations.pop_back();
+                return;
+            }
+
+            auto& stack = thread_annotations();
+            for (auto i = stack.size(); i > 0; --i) {
+                if (stack[i - 1].emitter != this) continue;
+                stack.erase(stack.begin() + static_cast<std::ptrdiff_t>(i - 1));
+                return;
+            }
+        }
+
+        auto apply_annotations(builder_t& builder) -> void {
+            if (!is_concurrent()) {
+                for (auto& annot: m_annotations) annot(builder);
+                return;
+            }
+
+            for (auto& annot: thread_annotations()) {
+                if (annot.emitter == this) annot.fn(builder);
+            }
+        }
+
+        auto acquire_diagnostic() -> Diagnostic {
+            // Pooled diagnostics use the heap, which would bypass the arena.
+            if (m_arena) return {};
+            return m_pool.acquire();
+        }
+
+        auto acquire_message() -> DiagnosticMessage {
+            if (m_arena) return {};
+            return m_pool.acquire_message();
+        }
+
+        auto should_build(DiagnosticLevel level, detail::diagnostic_kind_t kind, LocT const& loc) -> bool {
+            if (!is_enabled(level, kind, loc)) return false;
+            return m_limits.try_acquire(level, kind, [this, &loc] {
+                return m_converter->source_filename(loc);
+            });
+        }
+
+        /**
+         * @brief One note per capped kind: "N further diagnostics of kind E0042 suppressed".
+         *        The notes have neither a location nor a location key, so sorting puts them
+         *        after every located diagnostic. They go through `consume` like any other
+         *        diagnostic, so a concurrent emitter hands them over with its batches.
+         */
+        auto emit_suppressed_summary() -> void {
+            m_limits.take_suppressed([this](std::optional<std::size_t> kind, std::size_t count, DiagnosticLevel level) {
+                auto diag = Diagnostic{ .level = DiagnosticLevel::Note };
+                if (kind) {
+                    diag.kind = static_cast<detail::diagnostic_kind_t>(*kind);
+                    diag.message = core::BasicFormatter(
+                        "{} further diagnostics of kind {} suppressed",
+                        std::size_t{count},
+                        diagnostic_code(diag.kind, level, m_catalog)
+                    );
+                } else {
+                    diag.message = core::BasicFormatter(
+                        "too many errors emitted; {} further diagnostics suppressed",
+                        std::size_t{count}
+                    );
+                }
+                consume(std::move(diag));
+            });
+        }
+
+        // Only called by the thread that owns `m_draining`.
+        auto consume_drained_batch() -> void {
+            if (m_batch.empty()) return;
+            m_consumer->consume_batch(std::span(m_batch.data(), m_batch.size()));
+            m_batch.clear();
+        }
+
+        auto consume(Diagnostic&& diagnostic) -> void {
+            if (!is_concurrent()) {
+                m_consumer->consume(std::move(diagnostic));
+                return;
+            }
+            m_queue.push(std::move(diagnostic));
+            drain();
+        }
     private:
         DiagnosticConverter<LocT>* m_converter;
         DiagnosticConsumer* m_consumer;
-        core::SmallVec<core::FunctionRef<void(builder_t&)>> m_annotations;
+        core::SmallVec<annotation_fn_t> m_annotations;
+        core::MPSCQueue<Diagnostic> m_queue;
+        // Diagnostics popped by the draining thread before they're handed over in one batch.
+        core::SmallVec<Diagnostic, 0> m_batch;
+        DiagnosticFilter m_filter;
+        DiagnosticLimits m_limits;
+        DiagnosticPool m_pool;
+        DiagnosticArena* m_arena{nullptr};
+        DiagnosticCatalogView m_catalog{};
+        std::atomic_flag m_draining{};
+        DiagnosticEmitterMode m_mode{DiagnosticEmitterMode::Sequential};
+        bool m_defer_location{false};
     };
 
     template <typename LocT>
@@ -70,14 +343,17 @@ namespace dark {
             DiagnosticEmitter<LocT>* emitter,
             AnnotateFn annotate
         ) noexcept
-            : m_emitter(&emitter)
+            : m_emitter(emitter)
             , m_annotate_fn(std::move(annotate))
         {
-            m_emitter->m_annotations.push_back(m_annotate_fn);
+            m_emitter->push_annotation(m_annotate_fn);
         }
 
+        DiagnosticAnnotationScope(DiagnosticAnnotationScope const&) = delete;
+        DiagnosticAnnotationScope& operator=(DiagnosticAnnotationScope const&) = delete;
+
         ~DiagnosticAnnotationScope() {
-            m_emitter->m_annotations.pop_back();
+            m_emitter->pop_annotation();
         }
     private:
         DiagnosticEmitter<LocT>* m_emitter;
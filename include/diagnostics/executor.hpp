@@ -0,0 +1,154 @@
+#ifndef AMT_DARK_DIAGNOSTICS_EXECUTOR_HPP
+#define AMT_DARK_DIAGNOSTICS_EXECUTOR_HPP
+
+#include "core/function_ref.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dark {
+
+    /**
+     * @brief Runs independent tasks on the host's threads. Hosts that already own a thread
+     *        pool implement it to let the library render on their workers.
+     */
+    struct DiagnosticExecutor {
+        virtual ~DiagnosticExecutor() = default;
+
+        /**
+         * @brief Calls `task(i)` for every `i` in `[0, count)`, possibly concurrently and in
+         *        any order, and returns once all of them have finished. An exception thrown
+         *        by a task is rethrown after the others have finished.
+         */
+        virtual auto parallel_for(std::size_t count, core::FunctionRef<void(std::size_t)> task) -> void = 0;
+    };
+
+    /**
+     * @brief Fixed-size pool that splits the index range evenly between its threads. A
+     *        thread that runs out of indices steals the remaining ones from the others, so
+     *        diagnostics that are expensive to render don't leave the rest idle.
+     * @note The calling thread takes part in `parallel_for`, so a pool of `n` threads
+     *       spawns `n - 1` workers. Calls to `parallel_for` are serialized.
+     */
+    struct ThreadPoolExecutor: DiagnosticExecutor {
+        // `threads == 0` uses every hardware thread.
+        explicit ThreadPoolExecutor(unsigned threads = 0) {
+            if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+            m_ranges = std::make_unique<Range[]>(threads);
+            m_workers.reserve(threads - 1);
+            for (auto i = 1u; i < threads; ++i) {
+                m_workers.emplace_back([this, i] { run(i); });
+            }
+        }
+        ThreadPoolExecutor(ThreadPoolExecutor const&) = delete;
+        ThreadPoolExecutor(ThreadPoolExecutor &&) = delete;
+        ThreadPoolExecutor& operator=(ThreadPoolExecutor const&) = delete;
+        ThreadPoolExecutor& operator=(ThreadPoolExecutor &&) = delete;
+
+        ~ThreadPoolExecutor() noexcept override {
+            {
+                auto lock = std::lock_guard(m_mutex);
+                m_stop = true;
+            }
+            m_start.notify_all();
+            for (auto& worker: m_workers) worker.join();
+        }
+
+        auto parallel_for(std::size_t count, core::FunctionRef<void(std::size_t)> task) -> void override {
+            if (count == 0) return;
+            auto call_lock = std::lock_guard(m_call_mutex);
+            if (m_workers.empty() || count == 1) {
+                for (auto i = std::size_t{}; i < count; ++i) task(i);
+                return;
+            }
+
+            auto participants = threads();
+            {
+                auto lock = std::lock_guard(m_mutex);
+                m_task = task;
+                for (auto i = std::size_t{}; i < participants; ++i) {
+                    m_ranges[i].next.store(count * i / participants, std::memory_order_relaxed);
+                    m_ranges[i].end = count * (i + 1) / participants;
+                }
+                m_active = m_workers.size();
+                ++m_generation;
+            }
+            m_start.notify_all();
+
+            run_ranges(0);
+
+            auto lock = std::unique_lock(m_mutex);
+            m_done.wait(lock, [this] { return m_active == 0; });
+            m_task = nullptr;
+            if (m_error) std::rethrow_exception(std::exchange(m_error, nullptr));
+        }
+
+        // Number of threads taking part in `parallel_for`, including the caller.
+        constexpr auto threads() const noexcept -> std::size_t { return m_workers.size() + 1; }
+
+    private:
+        struct alignas(64) Range {
+            std::atomic<std::size_t> next{};
+            std::size_t end{};
+        };
+
+        auto run(std::size_t self) -> void {
+            auto generation = std::uint64_t{};
+            while (true) {
+                {
+                    auto lock = std::unique_lock(m_mutex);
+                    m_start.wait(lock, [this, generation] { return m_stop || m_generation != generation; });
+                    if (m_stop) return;
+                    generation = m_generation;
+                }
+
+                run_ranges(self);
+
+                auto lock = std::lock_guard(m_mutex);
+                if (--m_active == 0) m_done.notify_one();
+            }
+        }
+
+        // Drains its own range first and then steals from the others in turn.
+        auto run_ranges(std::size_t self) -> void {
+            auto participants = threads();
+            for (auto k = std::size_t{}; k < participants; ++k) {
+                auto& range = m_ranges[(self + k) % participants];
+                while (true) {
+                    auto index = range.next.fetch_add(1, std::memory_order_relaxed);
+                    if (index >= range.end) break;
+                    try {
+                        m_task(index);
+                    } catch (...) {
+                        auto lock = std::lock_guard(m_mutex);
+                        if (!m_error) m_error = std::current_exception();
+                    }
+                }
+            }
+        }
+
+    private:
+        std::vector<std::thread> m_workers;
+        std::unique_ptr<Range[]> m_ranges;
+        core::FunctionRef<void(std::size_t)> m_task{};
+        std::mutex m_call_mutex;
+        std::mutex m_mutex;
+        std::condition_variable m_start;
+        std::condition_variable m_done;
+        std::uint64_t m_generation{};
+        std::size_t m_active{};
+        std::exception_ptr m_error{};
+        bool m_stop{false};
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_EXECUTOR_HPP
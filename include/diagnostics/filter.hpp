@@ -0,0 +1,149 @@
+#ifndef AMT_DARK_DIAGNOSTICS_FILTER_HPP
+#define AMT_DARK_DIAGNOSTICS_FILTER_HPP
+
+#include "basic.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dark {
+
+    /**
+     * @brief Decides whether a diagnostic should be built at all. The emitter asks the
+     *        filter before formatting arguments are captured, so disabled diagnostics
+     *        only cost a few bit tests.
+     *
+     *        Levels and kinds are stored as bitsets. File rules are matched by path
+     *        prefix and the last matching rule wins; they're only evaluated when there's
+     *        at least one rule and the converter reports a filename.
+     * @note The filter must not be modified while diagnostics are being emitted.
+     */
+    struct DiagnosticFilter {
+        // Kinds below this bound are kept in a dense bitset; the rest in a sorted list.
+        static constexpr std::size_t max_dense_kind = 1 << 16;
+
+        constexpr DiagnosticFilter() noexcept = default;
+
+        constexpr auto enable(DiagnosticLevel level) noexcept -> DiagnosticFilter& {
+            m_disabled_levels &= ~level_bit(level);
+            return *this;
+        }
+
+        constexpr auto disable(DiagnosticLevel level) noexcept -> DiagnosticFilter& {
+            m_disabled_levels |= level_bit(level);
+            return *this;
+        }
+
+        auto enable_kind(detail::diagnostic_kind_t kind) -> DiagnosticFilter& {
+            set_kind(detail::diagnostic_kind_index(kind), false);
+            return *this;
+        }
+
+        auto disable_kind(detail::diagnostic_kind_t kind) -> DiagnosticFilter& {
+            set_kind(detail::diagnostic_kind_index(kind), true);
+            return *this;
+        }
+
+        /**
+         * @brief Enables diagnostics whose filename starts with `prefix`.
+         * @note Requires the converter to implement `DiagnosticConverter::source_filename`.
+         */
+        auto enable_file(std::string_view prefix) -> DiagnosticFilter& {
+            m_file_rules.push_back({ .prefix = std::string(prefix), .enabled = true });
+            return *this;
+        }
+
+        /**
+         * @brief Disables diagnostics whose filename starts with `prefix`.
+         * @note Requires the converter to implement `DiagnosticConverter::source_filename`.
+         */
+        auto disable_file(std::string_view prefix) -> DiagnosticFilter& {
+            m_file_rules.push_back({ .prefix = std::string(prefix), .enabled = false });
+            return *this;
+        }
+
+        // Removes every rule so that all the diagnostics are enabled.
+        auto reset() noexcept -> void {
+            m_disabled_levels = 0;
+            m_disabled_kinds.clear();
+            m_sparse_kinds.clear();
+            m_file_rules.clear();
+        }
+
+        constexpr auto is_enabled(DiagnosticLevel level) const noexcept -> bool {
+            return (m_disabled_levels & level_bit(level)) == 0;
+        }
+
+        constexpr auto is_kind_enabled(detail::diagnostic_kind_t kind) const noexcept -> bool {
+            auto index = detail::diagnostic_kind_index(kind);
+            if (index < max_dense_kind) {
+                auto word = index / bits_per_word;
+                if (word >= m_disabled_kinds.size()) return true;
+                return (m_disabled_kinds[word] & (std::uint64_t{1} << (index % bits_per_word))) == 0;
+            }
+            return !std::binary_search(m_sparse_kinds.begin(), m_sparse_kinds.end(), index);
+        }
+
+        constexpr auto is_enabled(DiagnosticLevel level, detail::diagnostic_kind_t kind) const noexcept -> bool {
+            return is_enabled(level) && is_kind_enabled(kind);
+        }
+
+        constexpr auto has_file_rules() const noexcept -> bool {
+            return !m_file_rules.empty();
+        }
+
+        // An empty filename is always enabled since the rules cannot apply to it.
+        auto is_file_enabled(std::string_view filename) const noexcept -> bool {
+            if (filename.empty()) return true;
+            for (auto i = m_file_rules.size(); i > 0; --i) {
+                auto const& rule = m_file_rules[i - 1];
+                if (filename.starts_with(rule.prefix)) return rule.enabled;
+            }
+            return true;
+        }
+    private:
+        static constexpr std::size_t bits_per_word = 64;
+
+        struct FileRule {
+            std::string prefix;
+            bool enabled;
+        };
+
+        static constexpr auto level_bit(DiagnosticLevel level) noexcept -> std::uint8_t {
+            return static_cast<std::uint8_t>(1u << static_cast<unsigned>(level));
+        }
+
+        auto set_kind(std::size_t index, bool disabled) -> void {
+            if (index < max_dense_kind) {
+                auto word = index / bits_per_word;
+                auto bit = std::uint64_t{1} << (index % bits_per_word);
+                if (word >= m_disabled_kinds.size()) {
+                    if (!disabled) return;
+                    m_disabled_kinds.resize(word + 1, 0);
+                }
+                if (disabled) m_disabled_kinds[word] |= bit;
+                else m_disabled_kinds[word] &= ~bit;
+                return;
+            }
+
+            auto it = std::lower_bound(m_sparse_kinds.begin(), m_sparse_kinds.end(), index);
+            auto found = it != m_sparse_kinds.end() && *it == index;
+            if (disabled && !found) m_sparse_kinds.insert(it, index);
+            else if (!disabled && found) m_sparse_kinds.erase(it);
+        }
+
+        static_assert(diagnostic_level_elements_count <= 8, "Level mask must fit in a byte");
+    private:
+        std::vector<std::uint64_t> m_disabled_kinds;
+        std::vector<std::size_t> m_sparse_kinds;
+        std::vector<FileRule> m_file_rules;
+        std::uint8_t m_disabled_levels{};
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_FILTER_HPP
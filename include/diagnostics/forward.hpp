@@ -1,6 +1,8 @@
 #ifndef AMT_DARK_DIAGNOSTICS_FORWARD_HPP
 #define AMT_DARK_DIAGNOSTICS_FORWARD_HPP
 
+#include "core/config.hpp"
+#include <concepts>
 #include <cstdint>
 namespace dark {
 
@@ -23,12 +25,23 @@ namespace dark {
     template <typename LocT>
     struct DiagnosticEmitter;
 
-    struct Span;
+    template <std::unsigned_integral T>
+    struct BasicSpan;
+    using Span = BasicSpan<dsize_t>;
+    using RelSpan = BasicSpan<doffset_t>;
 
     struct DiagnosticConsumer;
     struct ErrorTrackingDiagnosticConsumer;
     struct SortingDiagnosticConsumer;
     struct StreamDiagnosticConsumer;
+    struct DedupDiagnosticConsumer;
+    struct AsyncDiagnosticConsumer;
+    struct ParallelDiagnosticConsumer;
+    struct JsonLinesDiagnosticConsumer;
+    struct SarifDiagnosticConsumer;
+
+    struct DiagnosticExecutor;
+    struct ThreadPoolExecutor;
 
     namespace builder {
         struct DiagnosticTokenBuilder;
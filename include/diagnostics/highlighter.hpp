@@ -0,0 +1,177 @@
+#ifndef AMT_DARK_DIAGNOSTICS_HIGHLIGHTER_HPP
+#define AMT_DARK_DIAGNOSTICS_HIGHLIGHTER_HPP
+
+#include "core/arena.hpp"
+#include "core/config.hpp"
+#include "core/term/color.hpp"
+#include "span.hpp"
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+namespace dark {
+
+    // Style of a byte range of a line; the span is relative to the start of the text.
+    struct HighlightRange {
+        RelSpan span{};
+        Color text_color{ Color::Default };
+        Color bg_color{ Color::Default };
+        bool bold{false};
+        bool italic{false};
+    };
+
+    /**
+     * @brief Colours source text while it's rendered. The renderer only calls it for the
+     *        lines it draws, after eliding unmarked lines, and only for tokens the
+     *        converter left unstyled, so converters can hand over plain text.
+     */
+    struct LineHighlighter {
+        virtual ~LineHighlighter() = default;
+
+        /**
+         * @brief Appends the styled ranges of the text in increasing order; bytes that
+         *        aren't covered keep the default style.
+         * @param text a line or a plain token of a line, without the newline.
+         */
+        virtual auto highlight(std::string_view text, core::ArenaSmallVec<HighlightRange, 16>& ranges) const -> void = 0;
+    };
+
+    /**
+     * @brief Single pass lexer for C-like languages that colours keywords, literals,
+     *        comments and preprocessor directives. Every line is lexed on its own, so
+     *        comments and raw strings spanning lines are only coloured on their first line.
+     */
+    struct CLikeHighlighter: LineHighlighter {
+        struct Style {
+            HighlightRange keyword{ .text_color = Color::Blue, .bold = true };
+            HighlightRange number{ .text_color = Color::Cyan };
+            HighlightRange string{ .text_color = Color::Green };
+            HighlightRange comment{ .text_color = Color::BrightBlack, .italic = true };
+            HighlightRange preprocessor{ .text_color = Color::Magenta };
+        };
+
+        Style style{};
+
+        constexpr CLikeHighlighter() noexcept = default;
+        constexpr explicit CLikeHighlighter(Style style) noexcept
+            : style(style)
+        {}
+
+        auto highlight(std::string_view text, core::ArenaSmallVec<HighlightRange, 16>& ranges) const -> void override {
+            auto const size = text.size();
+            auto add = [&ranges](HighlightRange range, std::size_t start, std::size_t end) {
+                range.span = RelSpan(static_cast<doffset_t>(start), static_cast<doffset_t>(end));
+                ranges.push_back(range);
+            };
+
+            auto i = std::size_t{};
+            auto first_non_space = true;
+            while (i < size) {
+                auto c = text[i];
+                auto next = i + 1 < size ? text[i + 1] : '\0';
+
+                if (is_space(c)) {
+                    ++i;
+                    continue;
+                }
+
+                if (c == '/' && next == '/') {
+                    add(style.comment, i, size);
+                    break;
+                }
+
+                if (c == '/' && next == '*') {
+                    auto end = text.find("*/", i + 2);
+                    end = end == std::string_view::npos ? size : end + 2;
+                    add(style.comment, i, end);
+                    i = end;
+                    continue;
+                }
+
+                if (c == '#' && first_non_space) {
+                    auto end = i + 1;
+                    while (end < size && is_space(text[end])) ++end;
+                    while (end < size && is_ident(text[end])) ++end;
+                    add(style.preprocessor, i, end);
+                    i = end;
+                    first_non_space = false;
+                    continue;
+                }
+                first_non_space = false;
+
+                if (c == '"' || c == '\'') {
+                    auto end = i + 1;
+                    while (end < size && text[end] != c) {
+                        end += text[end] == '\\' ? 2 : 1;
+                    }
+                    end = std::min(end + 1, size);
+                    add(style.string, i, end);
+                    i = end;
+                    continue;
+                }
+
+                if (is_digit(c) || (c == '.' && is_digit(next))) {
+                    auto end = i + 1;
+                    while (end < size) {
+                        auto d = text[end];
+                        auto exponent = (d == '+' || d == '-') && is_exponent(text[end - 1]);
+                        if (!is_ident(d) && d != '.' && d != '\'' && !exponent) break;
+                        ++end;
+                    }
+                    add(style.number, i, end);
+                    i = end;
+                    continue;
+                }
+
+                if (is_ident(c)) {
+                    auto end = i + 1;
+                    while (end < size && is_ident(text[end])) ++end;
+                    if (is_keyword(text.substr(i, end - i))) add(style.keyword, i, end);
+                    i = end;
+                    continue;
+                }
+
+                ++i;
+            }
+        }
+    private:
+        static constexpr std::array<std::string_view, 84> keywords {
+            "alignas", "alignof", "auto", "bool", "break", "case", "catch", "char",
+            "char16_t", "char32_t", "char8_t", "class", "co_await", "co_return", "co_yield", "concept",
+            "const", "const_cast", "consteval", "constexpr", "constinit", "continue", "decltype", "default",
+            "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export",
+            "extern", "false", "final", "float", "for", "friend", "goto", "if",
+            "import", "inline", "int", "long", "module", "mutable", "namespace", "new",
+            "noexcept", "nullptr", "operator", "override", "private", "protected", "public", "register",
+            "reinterpret_cast", "requires", "return", "short", "signed", "sizeof", "static", "static_assert",
+            "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true",
+            "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual",
+            "void", "volatile", "wchar_t", "while"
+        };
+        static_assert(std::ranges::is_sorted(keywords));
+
+        static constexpr auto is_keyword(std::string_view word) noexcept -> bool {
+            return std::ranges::binary_search(keywords, word);
+        }
+
+        static constexpr auto is_space(char c) noexcept -> bool {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+        }
+
+        static constexpr auto is_digit(char c) noexcept -> bool {
+            return c >= '0' && c <= '9';
+        }
+
+        static constexpr auto is_exponent(char c) noexcept -> bool {
+            return c == 'e' || c == 'E' || c == 'p' || c == 'P';
+        }
+
+        // Bytes of multi-byte UTF-8 sequences are treated as identifier characters.
+        static constexpr auto is_ident(char c) noexcept -> bool {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || is_digit(c) || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+        }
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_HIGHLIGHTER_HPP
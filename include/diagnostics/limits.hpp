@@ -0,0 +1,209 @@
+#ifndef AMT_DARK_DIAGNOSTICS_LIMITS_HPP
+#define AMT_DARK_DIAGNOSTICS_LIMITS_HPP
+
+#include "basic.hpp"
+#include "filter.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace dark {
+
+    /**
+     * @brief Caps the number of diagnostics the emitter builds, like `-ferror-limit`.
+     *        Once a cap is hit, further diagnostics of that class get an inert builder
+     *        and are only counted so that a summary can be emitted on flush.
+     *
+     *        A limit of zero means unlimited. Checks are a single branch when no limit
+     *        is configured and a couple of atomic increments otherwise, so they're safe
+     *        to use from a concurrent emitter.
+     * @note Limits must be configured before diagnostics are emitted. A diagnostic is
+     *       counted when its builder is created.
+     */
+    struct DiagnosticLimits {
+        // Lets the per-file counts be looked up by `std::string_view`.
+        struct FilenameHash {
+            using is_transparent = void;
+
+            auto operator()(std::string_view name) const noexcept -> std::size_t {
+                return std::hash<std::string_view>{}(name);
+            }
+        };
+
+        struct KindCounter {
+            std::size_t limit{};
+            std::size_t file_limit{};
+            std::atomic<std::size_t> count{};
+            std::atomic<std::size_t> suppressed{};
+            // Level of the last suppressed diagnostic, which the summary's code is built from.
+            std::atomic<DiagnosticLevel> suppressed_level{ DiagnosticLevel::Error };
+            std::mutex file_mutex{};
+            // The filename is only copied the first time the file is seen.
+            std::unordered_map<std::string, std::size_t, FilenameHash, std::equal_to<>> file_counts{};
+        };
+
+        DiagnosticLimits() = default;
+        DiagnosticLimits(DiagnosticLimits const&) = delete;
+        DiagnosticLimits(DiagnosticLimits &&) = delete;
+        DiagnosticLimits& operator=(DiagnosticLimits const&) = delete;
+        DiagnosticLimits& operator=(DiagnosticLimits &&) = delete;
+
+        /**
+         * @brief Stops building errors and warnings after `limit` errors.
+         */
+        auto set_error_limit(std::size_t limit) noexcept -> DiagnosticLimits& {
+            m_error_limit = limit;
+            return *this;
+        }
+
+        // At most `limit` diagnostics of the kind in total.
+        auto set_kind_limit(detail::diagnostic_kind_t kind, std::size_t limit) -> DiagnosticLimits& {
+            m_kinds[detail::diagnostic_kind_index(kind)].limit = limit;
+            return *this;
+        }
+
+        /**
+         * @brief At most `limit` diagnostics of the kind per file.
+         * @note Requires the converter to implement `DiagnosticConverter::source_filename`.
+         */
+        auto set_kind_file_limit(detail::diagnostic_kind_t kind, std::size_t limit) -> DiagnosticLimits& {
+            m_kinds[detail::diagnostic_kind_index(kind)].file_limit = limit;
+            return *this;
+        }
+
+        constexpr auto error_limit() const noexcept -> std::size_t { return m_error_limit; }
+
+        auto has_limits() const noexcept -> bool {
+            return m_error_limit != 0 || !m_kinds.empty();
+        }
+
+        auto error_limit_reached() const noexcept -> bool {
+            return m_error_limit != 0 && m_error_count.load(std::memory_order_relaxed) >= m_error_limit;
+        }
+
+        /**
+         * @brief Counts the diagnostic and reports whether it's still under every cap. A
+         *        rejected diagnostic is only counted as suppressed, so it never uses up the
+         *        room under the other caps.
+         * @param filename_fn returns the filename; only called for kinds with a per-file cap.
+         */
+        template <typename FilenameFn>
+        auto try_acquire(DiagnosticLevel level, detail::diagnostic_kind_t kind, FilenameFn&& filename_fn) -> bool {
+            if (!has_limits()) return true;
+
+            if (error_limit_reached()) {
+                m_error_suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            auto* counter = static_cast<KindCounter*>(nullptr);
+            auto filename = std::string_view{};
+            if (auto it = m_kinds.find(detail::diagnostic_kind_index(kind)); it != m_kinds.end()) {
+                counter = &it->second;
+                if (!acquire_kind(*counter, filename_fn, filename)) {
+                    counter->suppressed_level.store(level, std::memory_order_relaxed);
+                    counter->suppressed.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+
+            if (level == DiagnosticLevel::Error && m_error_limit != 0) {
+                if (!try_increment(m_error_count, m_error_limit)) {
+                    if (counter) release_kind(*counter, filename);
+                    m_error_suppressed.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        auto suppressed_by_error_limit() const noexcept -> std::size_t {
+            return m_error_suppressed.load(std::memory_order_relaxed);
+        }
+
+        auto suppressed(detail::diagnostic_kind_t kind) const noexcept -> std::size_t {
+            auto it = m_kinds.find(detail::diagnostic_kind_index(kind));
+            if (it == m_kinds.end()) return 0;
+            return it->second.suppressed.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Calls `fn(kind_index, count, level)` for every kind with suppressed diagnostics
+         *        and `fn(std::nullopt, count, DiagnosticLevel::Error)` for the error limit, then
+         *        clears the suppressed counts so that the next summary only reports new ones.
+         */
+        template <typename Fn>
+        auto take_suppressed(Fn&& fn) -> void {
+            for (auto& [kind, counter]: m_kinds) {
+                auto n = counter.suppressed.exchange(0, std::memory_order_relaxed);
+                if (n != 0) fn(std::optional<std::size_t>(kind), n, counter.suppressed_level.load(std::memory_order_relaxed));
+            }
+            auto n = m_error_suppressed.exchange(0, std::memory_order_relaxed);
+            if (n != 0) fn(std::optional<std::size_t>(), n, DiagnosticLevel::Error);
+        }
+
+        // Clears every counter while keeping the configured limits.
+        auto reset_counts() -> void {
+            m_error_count.store(0, std::memory_order_relaxed);
+            m_error_suppressed.store(0, std::memory_order_relaxed);
+            for (auto& [_, counter]: m_kinds) {
+                counter.count.store(0, std::memory_order_relaxed);
+                counter.suppressed.store(0, std::memory_order_relaxed);
+                auto lock = std::lock_guard(counter.file_mutex);
+                counter.file_counts.clear();
+            }
+        }
+    private:
+        // Increments `count` unless it already reached `limit`.
+        static auto try_increment(std::atomic<std::size_t>& count, std::size_t limit) noexcept -> bool {
+            auto n = count.load(std::memory_order_relaxed);
+            do {
+                if (n >= limit) return false;
+            } while (!count.compare_exchange_weak(n, n + 1, std::memory_order_relaxed));
+            return true;
+        }
+
+        // Takes a slot under the kind's caps; `filename` is set if a per-file slot was taken.
+        template <typename FilenameFn>
+        static auto acquire_kind(KindCounter& counter, FilenameFn& filename_fn, std::string_view& filename) -> bool {
+            if (counter.limit != 0 && !try_increment(counter.count, counter.limit)) return false;
+            if (counter.file_limit == 0) return true;
+
+            std::string_view name = filename_fn();
+            if (name.empty()) return true;
+
+            auto lock = std::lock_guard(counter.file_mutex);
+            auto it = counter.file_counts.find(name);
+            if (it == counter.file_counts.end()) it = counter.file_counts.emplace(std::string(name), 0).first;
+            if (it->second >= counter.file_limit) {
+                if (counter.limit != 0) counter.count.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+            ++it->second;
+            filename = name;
+            return true;
+        }
+
+        // Gives back the slots taken by `acquire_kind` when a later cap rejects the diagnostic.
+        static auto release_kind(KindCounter& counter, std::string_view filename) -> void {
+            if (counter.limit != 0) counter.count.fetch_sub(1, std::memory_order_relaxed);
+            if (filename.empty()) return;
+            auto lock = std::lock_guard(counter.file_mutex);
+            if (auto it = counter.file_counts.find(filename); it != counter.file_counts.end()) --it->second;
+        }
+    private:
+        std::unordered_map<std::size_t, KindCounter> m_kinds;
+        std::size_t m_error_limit{};
+        std::atomic<std::size_t> m_error_count{};
+        std::atomic<std::size_t> m_error_suppressed{};
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_LIMITS_HPP
@@ -0,0 +1,97 @@
+#ifndef AMT_DARK_DIAGNOSTICS_POOL_HPP
+#define AMT_DARK_DIAGNOSTICS_POOL_HPP
+
+#include "basic.hpp"
+#include "core/small_vec.hpp"
+#include <cstddef>
+#include <mutex>
+
+namespace dark {
+
+    /**
+     * @brief Free list of diagnostics whose containers kept their capacity. The emitter
+     *        builds new diagnostics from it and consumers hand rendered diagnostics back
+     *        with `release`, so steady-state emission doesn't allocate.
+     *
+     *        Annotations are kept apart from their diagnostic, cleared but alive, so that
+     *        their spans and strings keep their storage too.
+     * @note Diagnostics built while an arena is attached are never pooled since their
+     *       memory goes away when the arena is reset.
+     */
+    struct DiagnosticPool {
+        static constexpr std::size_t default_max_size = 64;
+        // Pooled annotations per pooled diagnostic.
+        static constexpr std::size_t messages_per_diagnostic = 4;
+
+        explicit DiagnosticPool(std::size_t max_size = default_max_size) noexcept
+            : m_max_size(max_size)
+        {}
+        DiagnosticPool(DiagnosticPool const&) = delete;
+        DiagnosticPool(DiagnosticPool &&) = delete;
+        DiagnosticPool& operator=(DiagnosticPool const&) = delete;
+        DiagnosticPool& operator=(DiagnosticPool &&) = delete;
+
+        // Returns a cleared diagnostic, reusing a pooled one if there is any.
+        auto acquire() -> Diagnostic {
+            auto lock = std::lock_guard(m_mutex);
+            if (m_free.empty()) return {};
+            auto diag = std::move(m_free.back());
+            m_free.pop_back();
+            return diag;
+        }
+
+        // Returns a cleared annotation, reusing a pooled one if there is any.
+        auto acquire_message() -> DiagnosticMessage {
+            auto lock = std::lock_guard(m_mutex);
+            if (m_free_messages.empty()) return {};
+            auto message = std::move(m_free_messages.back());
+            m_free_messages.pop_back();
+            return message;
+        }
+
+        // Clears the diagnostic and keeps it for reuse unless the pool is full.
+        auto release(Diagnostic&& diag) -> void {
+            if (is_arena_backed(diag)) return;
+            for (auto& message: diag.annotations) message.clear();
+            {
+                auto lock = std::lock_guard(m_mutex);
+                // Kept in reverse so that they're handed out again in the same order.
+                auto const max_messages = m_max_size * messages_per_diagnostic;
+                for (auto i = diag.annotations.size(); i > 0 && m_free_messages.size() < max_messages; --i) {
+                    m_free_messages.push_back(std::move(diag.annotations[i - 1]));
+                }
+            }
+            diag.clear();
+            auto lock = std::lock_guard(m_mutex);
+            if (m_free.size() >= m_max_size) return;
+            m_free.push_back(std::move(diag));
+        }
+
+        auto size() const -> std::size_t {
+            auto lock = std::lock_guard(m_mutex);
+            return m_free.size();
+        }
+
+        constexpr auto max_size() const noexcept -> std::size_t { return m_max_size; }
+
+        // Frees every pooled diagnostic.
+        auto clear() -> void {
+            auto lock = std::lock_guard(m_mutex);
+            m_free.clear();
+            m_free_messages.clear();
+        }
+    private:
+        static auto is_arena_backed(Diagnostic const& diag) noexcept -> bool {
+            return diag.annotations.get_allocator().arena() != nullptr
+                || diag.location.source.lines.get_allocator().arena() != nullptr;
+        }
+    private:
+        mutable std::mutex m_mutex;
+        core::SmallVec<Diagnostic, 0> m_free;
+        core::SmallVec<DiagnosticMessage, 0> m_free_messages;
+        std::size_t m_max_size;
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_POOL_HPP
@@ -3,6 +3,8 @@
 
 #include "core/term/canvas.hpp"
 #include "basic.hpp"
+#include "catalog.hpp"
+#include "highlighter.hpp"
 #include "core/term/terminal.hpp"
 #include "core/format_any.hpp"
 #include "core/term/annotated_string.hpp"
@@ -56,6 +58,10 @@ namespace dark {
         std::size_t max_message_characters_per_line{60};
         unsigned max_non_marker_lines{4};
         unsigned diagnostic_kind_padding{4};
+        // Kinds found in the catalog use its precomputed code instead of the formatted kind.
+        DiagnosticCatalogView catalog{};
+        // Colours the unstyled tokens of the drawn lines; must outlive the render call.
+        LineHighlighter const* highlighter{nullptr};
         Color ruler_color{Color::Magenta};
         std::array<Color, diagnostic_level_elements_count> level_to_color{
             /*Help   */ Color::Green,
@@ -104,24 +110,12 @@ namespace dark::internal {
         return colors[static_cast<std::size_t>(level)];
     }
 
-    constexpr auto diagnostic_level_code_prefix(DiagnosticLevel level) noexcept -> std::string_view {
-        switch (level) {
-        case DiagnosticLevel::Help: return "H";
-        case DiagnosticLevel::Note: return "N";
-        case DiagnosticLevel::Warning: return "W";
-        case DiagnosticLevel::Error: return "E";
-        case DiagnosticLevel::Insert: return "I";
-        case DiagnosticLevel::Delete: return "D";
-          break;
-        }
-    }
-
     struct DiagnosticMessageSpanInfo {
         static constexpr auto npos = std::numeric_limits<std::size_t>::max();
         std::size_t message_index{npos};
         std::size_t diagnostic_index;
         DiagnosticLevel level;
-        Span span;
+        RelSpan span;
     };
 
     struct DiagnosticOrphanMessageInfo {
@@ -152,6 +146,37 @@ namespace dark::internal {
         }
     };
 
+    /**
+     * @brief Moves every position of the diagnostic so that its first source line starts at
+     *        zero. The renderer only compares positions with each other, so the output stays
+     *        the same, and the window it draws fits into `doffset_t` even when `dsize_t` is
+     *        64-bit.
+     */
+    static inline auto rebase_diagnostic(Diagnostic& diag) noexcept -> void {
+        auto& lines = diag.location.source.lines;
+        if (lines.empty()) return;
+
+        auto base = lines[0].line_start_offset;
+        for (auto const& line: lines) base = std::min(base, line.line_start_offset);
+        if (base == 0) return;
+
+        auto rebase_tokens = [base](DiagnosticSourceLocationTokens& source) {
+            for (auto& line: source.lines) {
+                line.line_start_offset -= std::min(base, line.line_start_offset);
+                for (auto& tok: line.tokens) {
+                    tok.token_start_offset -= std::min(base, tok.token_start_offset);
+                    if (!tok.marker.empty()) tok.marker = tok.marker - base;
+                }
+            }
+        };
+
+        rebase_tokens(diag.location.source);
+        for (auto& annotation: diag.annotations) {
+            for (auto& span: annotation.spans) span = span - base;
+            rebase_tokens(annotation.tokens);
+        }
+    }
+
     static inline auto normalize_diagnostic_messages(
         Diagnostic& diag
     ) -> NormalizedDiagnosticAnnotations {
@@ -201,7 +226,7 @@ namespace dark::internal {
                     .message_index = message_id,
                     .diagnostic_index = i,
                     .level = annotation.level,
-                    .span = Span(std::max(span.start(), source_span.start()), std::min(span.end(), source_span.end()))
+                    .span = RelSpan(Span(std::max(span.start(), source_span.start()), std::min(span.end(), source_span.end())))
                 });
             }
 
@@ -222,7 +247,10 @@ namespace dark::internal {
         Diagnostic& diag,
         DiagnosticRenderConfig const& config
     ) -> term::BoundingBox {
-        auto code = convert_diagnostic_kind_to_string(diag.kind, config.diagnostic_kind_padding);
+        auto const* entry = config.catalog.find(diag.kind);
+        auto code = entry
+            ? core::CowString(entry->code)
+            : core::CowString(convert_diagnostic_kind_to_string(diag.kind, config.diagnostic_kind_padding));
         auto tag = to_string(diag.level);
         auto span_style = SpanStyle {
             .text_color = diagnostic_level_to_color(std::span(config.level_to_color), diag.level),
@@ -230,12 +258,12 @@ namespace dark::internal {
         };
         auto bbox = term::BoundingBox{};
         if (!code.empty()) {
-            auto prefix = diagnostic_level_code_prefix(diag.level);
+            auto prefix = entry ? std::string_view{} : diagnostic_level_code_prefix(diag.level);
             bbox = canvas.draw_text(
                 AnnotatedString::builder()
                     .with_style(span_style)
                     .push(tag)
-                    .push("[").push(prefix).push(core::CowString(code)).push("]: ")
+                    .push("[").push(prefix).push(std::move(code)).push("]: ")
                     .build(),
                 bbox.x, bbox.bottom_left().second
             ).bbox;
@@ -302,7 +330,7 @@ namespace dark::internal {
         auto line = line_number.has_value() ? vertical : dotted_vertical;
         auto num = line_number
             .transform([width](dsize_t n) -> std::string {
-                return std::format("{:>{}}", n, std::max(width, dsize_t{2}) - 2);
+                return std::format("{:>{}}", n, std::max(width, 2u) - 2);
             })
             .value_or(std::string());
 
@@ -382,7 +410,7 @@ namespace dark::internal {
 
     struct DiagnosticMarker {
         MarkerKind kind;
-        Span span;
+        RelSpan span;
         unsigned annotation_index{};
         bool is_start{true};
     };
@@ -392,17 +420,17 @@ namespace dark::internal {
         // The first marker is always the primary marker even if it's
         // empty. So, markers should be be empty.
         core::SmallVec<DiagnosticMarker, 2> markers{};
-        dsize_t token_start_offset{};
+        doffset_t token_start_offset{};
         Color text_color{ Color::Default };
         Color bg_color{ Color::Default };
         bool bold{false};
         bool italic{false};
         bool is_artificial{false};
         term::TextOverflow overflow{ term::TextOverflow::none };
-        Span overflow_span{};
+        RelSpan overflow_span{};
 
-        constexpr auto span() const noexcept -> Span {
-            return Span::from_size(token_start_offset, static_cast<dsize_t>(text.size()));
+        constexpr auto span() const noexcept -> RelSpan {
+            return RelSpan::from_size(token_start_offset, static_cast<doffset_t>(text.size()));
         }
 
         constexpr auto to_style() const noexcept -> term::Style {
@@ -418,7 +446,7 @@ namespace dark::internal {
     struct NormalizedDiagnosticLineTokens {
         core::SmallVec<NormalizedDiagnosticTokenInfo> tokens;
         dsize_t line_number{};
-        dsize_t line_start_offset{};
+        doffset_t line_start_offset{};
 
         constexpr auto empty() const noexcept -> bool { return tokens.empty(); }
 
@@ -438,7 +466,7 @@ namespace dark::internal {
         auto res = core::SmallVec<NormalizedDiagnosticLineTokens>{};
         auto add_entry = [&res](
             dsize_t line_number,
-            dsize_t line_start_offset
+            doffset_t line_start_offset
         ) -> NormalizedDiagnosticLineTokens& {
             res.push_back(NormalizedDiagnosticLineTokens{
                 .tokens = {},
@@ -447,7 +475,7 @@ namespace dark::internal {
             });
             return res.back();
         };
-        auto& last = add_entry(line.line_number, line.line_start_offset);
+        auto& last = add_entry(line.line_number, to_offset(line.line_start_offset));
         core::SmallVec<std::size_t, 1> insertion_points;
 
         for (auto& tok: line.tokens) {
@@ -470,8 +498,8 @@ namespace dark::internal {
             if (start == an.spans.size()) {
                 last.tokens.push_back(NormalizedDiagnosticTokenInfo {
                     .text = std::move(tok.text),
-                    .markers = { { .kind = MarkerKind::Primary, .span = tok.marker } },
-                    .token_start_offset = tok.token_start_offset,
+                    .markers = { { .kind = MarkerKind::Primary, .span = RelSpan(tok.marker) } },
+                    .token_start_offset = to_offset(tok.token_start_offset),
                     .text_color = tok.text_color,
                     .bg_color = tok.bg_color,
                     .bold = tok.bold,
@@ -497,20 +525,20 @@ namespace dark::internal {
             //      |---- span 1-------|
             //         |--span 2---|
 
-            auto span = tok.span();
-            auto marker = tok.marker;
+            auto span = RelSpan(tok.span());
+            auto marker = RelSpan(tok.marker);
             auto text = std::move(tok.text);
-            auto token_offset = tok.token_start_offset;
+            auto token_offset = to_offset(tok.token_start_offset);
             for (auto i = 0ul; i < insertion_points.size();) {
                 auto index = insertion_points[i];
                 auto split_point = an.spans[index].span.start();
-                auto first = Span(span.start(), split_point);
-                auto end = Span(first.end(), span.end());
-                auto first_marker = Span(
+                auto first = RelSpan(span.start(), split_point);
+                auto end = RelSpan(first.end(), span.end());
+                auto first_marker = RelSpan(
                     marker.start(),
                     std::min(split_point, marker.end())
                 );
-                auto last_marker = Span(first_marker.end(), marker.end());
+                auto last_marker = RelSpan(first_marker.end(), marker.end());
 
                 if (!first.empty()) {
                     last.tokens.push_back(NormalizedDiagnosticTokenInfo {
@@ -544,7 +572,7 @@ namespace dark::internal {
                         for (auto l = 0ul; l < lines.size(); ++l) {
                             auto& el = lines[l];
                             for (auto& itok: el.tokens) {
-                                auto text_size = static_cast<dsize_t>(itok.text.size());
+                                auto text_size = static_cast<doffset_t>(itok.text.size());
                                 if (text_size == 0) continue;
 
                                 last.tokens.push_back(
@@ -553,7 +581,7 @@ namespace dark::internal {
                                         .markers = {
                                             DiagnosticMarker {
                                                 .kind = MarkerKind::Insert,
-                                                .span = Span::from_size(0, text_size),
+                                                .span = RelSpan::from_size(0, text_size),
                                                 .annotation_index = static_cast<unsigned>(index)
                                             }
                                         },
@@ -567,7 +595,7 @@ namespace dark::internal {
                                 );
                             }
                             if (l + 1 < lines.size()) {
-                                last = add_entry(0, line.line_start_offset);
+                                last = add_entry(0, to_offset(line.line_start_offset));
                             }
                         }
                     }
@@ -621,11 +649,11 @@ namespace dark::internal {
 
                     // [.........token.........]
                     //    [..first..][..end..]
-                    auto first = Span(
+                    auto first = RelSpan(
                         top.span.start(),
                         std::min(top.span.end(), span.end())
                     );
-                    auto end = Span(first.end(), top.span.end());
+                    auto end = RelSpan(first.end(), top.span.end());
 
                     auto kind = MarkerKind::Secondary;
                     if (top.level == DiagnosticLevel::Delete) kind = MarkerKind::Delete;
@@ -642,8 +670,8 @@ namespace dark::internal {
                         auto& tmp = l.tokens[k];
                         if (tmp.is_artificial) continue;
                         if (!tmp.span().is_between(end.start())) break;
-                        first = Span(end.start(), std::min(end.end(), tmp.span().end()));
-                        end = Span(first.end(), end.end());
+                        first = RelSpan(end.start(), std::min(end.end(), tmp.span().end()));
+                        end = RelSpan(first.end(), end.end());
                         tmp.markers.push_back({
                             .kind = kind,
                             .span = first,
@@ -704,8 +732,8 @@ namespace dark::internal {
                     assert(s != k);
                     auto lhs = el.markers[s];
                     auto rhs = el.markers[k];
-                    auto l0 = Span(lhs.span.start(), rhs.span.start());
-                    auto l1 = Span(rhs.span.start(), lhs.span.end());
+                    auto l0 = RelSpan(lhs.span.start(), rhs.span.start());
+                    auto l1 = RelSpan(rhs.span.start(), lhs.span.end());
                     el.markers[s].span = l0;
                     lhs.span = l1;
                     lhs.is_start = false;
@@ -779,7 +807,7 @@ namespace dark::internal {
                     auto markers = core::SmallVec<DiagnosticMarker, 2>{};
                     for (auto i = start_index; i < end_index; ++i) {
                         auto m = token.markers[i];
-                        m.span = Span::from_size(m.span.start() - start, m.span.size());
+                        m.span = RelSpan::from_size(m.span.start() - start, m.span.size());
                         markers.push_back(std::move(m));
                     }
 
@@ -846,7 +874,7 @@ namespace dark::internal {
     }
 
     static inline auto fix_newlines(
-        core::SmallVec<DiagnosticLineTokens>& lines
+        decltype(DiagnosticSourceLocationTokens::lines)& lines
     ) noexcept -> void {
         for (auto l = 0ul; l < lines.size(); ++l) {
             // Find the token text with newline
@@ -901,6 +929,207 @@ namespace dark::internal {
         });
     }
 
+    // Lines removed by `window_source_lines`; they're rendered as skipped lines.
+    struct SourceWindow {
+        bool trimmed{false};
+        dsize_t first_line_number{};
+        dsize_t trailing_lines{};
+    };
+
+    /**
+     * @brief Cuts a location that carries a whole file as a single token, e.g. from
+     *        `DiagnosticLocation::from_text`, down to the lines around its markers and
+     *        annotation spans. Runs of at least `max_non_marker_lines` unmarked lines
+     *        would be elided anyway, so they're only counted instead of being split into
+     *        lines and laid out.
+     * @note The token has no line index, so numbering the kept lines still counts the
+     *       newlines of the whole text once. Only that scan depends on the file size;
+     *       use `SourceFile::location` to avoid it.
+     */
+    static inline auto window_source_lines(
+        Diagnostic& diag,
+        unsigned max_non_marker_lines
+    ) -> SourceWindow {
+        auto& lines = diag.location.source.lines;
+        if (lines.size() != 1 || lines[0].tokens.size() != 1 || max_non_marker_lines == 0) return {};
+
+        auto const line_number = lines[0].line_number;
+        auto const line_start_offset = lines[0].line_start_offset;
+        auto const& token = lines[0].tokens[0];
+        auto const text = token.text.to_borrowed();
+        auto const start = token.token_start_offset;
+        auto const end = start + static_cast<dsize_t>(text.size());
+
+        // [begin, end) of the lines covered by every span, relative to the token text.
+        // `end` is the position of the line's newline or the end of the text.
+        auto blocks = core::SmallVec<std::pair<std::size_t, std::size_t>, 8>{};
+        auto add_span = [&](Span span) {
+            if (span.start() > end || span.end() < start) return;
+            auto s = static_cast<std::size_t>(std::clamp(span.start(), start, end) - start);
+            auto e = static_cast<std::size_t>(std::clamp(span.end(), start, end) - start);
+            auto last = e > s ? e - 1 : s;
+            auto begin = s == 0 ? std::string_view::npos : text.rfind('\n', s - 1);
+            auto block_end = text.find('\n', last);
+            blocks.push_back({
+                begin == std::string_view::npos ? 0 : begin + 1,
+                block_end == std::string_view::npos ? text.size() : block_end
+            });
+        };
+
+        if (!token.marker.empty()) add_span(token.marker);
+        for (auto const& a: diag.annotations) {
+            for (auto span: a.spans) add_span(span);
+        }
+        if (blocks.empty()) return {};
+        std::sort(blocks.begin(), blocks.end());
+
+        auto count_newlines = [text](std::size_t from, std::size_t to) {
+            return static_cast<dsize_t>(std::count(text.begin() + static_cast<std::ptrdiff_t>(from), text.begin() + static_cast<std::ptrdiff_t>(to), '\n'));
+        };
+
+        struct Piece {
+            std::size_t begin;
+            std::size_t end;
+            dsize_t line_number;
+        };
+        auto pieces = core::SmallVec<Piece, 4>{};
+        auto window = SourceWindow{ .trimmed = false, .first_line_number = line_number };
+
+        // Newlines before `counted`, which is the start of the current piece.
+        auto counted = blocks[0].first;
+        auto newlines = count_newlines(0, counted);
+        auto current = Piece{ .begin = 0, .end = blocks[0].second, .line_number = line_number };
+        if (newlines >= max_non_marker_lines) {
+            current.begin = blocks[0].first;
+            current.line_number = line_number + newlines;
+            window.trimmed = true;
+        }
+
+        for (auto i = 1ul; i < blocks.size(); ++i) {
+            auto [begin, block_end] = blocks[i];
+            if (begin <= current.end + 1) {
+                current.end = std::max(current.end, block_end);
+                continue;
+            }
+
+            auto gap = count_newlines(current.end + 1, begin);
+            if (gap < max_non_marker_lines) {
+                current.end = block_end;
+                continue;
+            }
+
+            newlines += count_newlines(counted, current.end + 1) + gap;
+            counted = begin;
+            pieces.push_back(current);
+            current = Piece{ .begin = begin, .end = block_end, .line_number = line_number + newlines };
+            window.trimmed = true;
+        }
+
+        if (current.end < text.size()) {
+            auto trailing = count_newlines(current.end + 1, text.size()) + 1;
+            if (trailing < max_non_marker_lines) {
+                current.end = text.size();
+            } else {
+                window.trailing_lines = trailing;
+                window.trimmed = true;
+            }
+        }
+        pieces.push_back(current);
+
+        if (!window.trimmed) return {};
+
+        auto const source = std::move(lines[0].tokens[0]);
+        lines.clear();
+        for (auto const& piece: pieces) {
+            auto offset = start + static_cast<dsize_t>(piece.begin);
+            auto marker = source.marker;
+            if (!marker.empty()) {
+                // Keeps the newline so that a marker at the end of a line stays visible.
+                auto s = std::max(marker.start(), offset);
+                auto e = std::min(marker.end(), start + static_cast<dsize_t>(piece.end) + 1);
+                marker = s < e ? Span(s, e) : Span{};
+            }
+
+            auto line = DiagnosticLineTokens{
+                .tokens = {},
+                .line_number = piece.line_number,
+                .line_start_offset = piece.begin == 0 ? line_start_offset : offset
+            };
+            line.tokens.push_back(DiagnosticTokenInfo{
+                .text = source.text.substr(piece.begin, piece.end - piece.begin),
+                .token_start_offset = offset,
+                .marker = marker,
+                .text_color = source.text_color,
+                .bg_color = source.bg_color,
+                .bold = source.bold,
+                .italic = source.italic,
+            });
+            lines.push_back(std::move(line));
+        }
+        return window;
+    }
+
+    /**
+     * @brief Splits every unstyled token of the line into the ranges reported by the
+     *        highlighter. The pieces keep the token's text storage and their share of
+     *        its marker.
+     */
+    static inline auto highlight_line(
+        DiagnosticLineTokens& line,
+        LineHighlighter const& highlighter
+    ) -> void {
+        auto is_plain = [](DiagnosticTokenInfo const& tok) {
+            return tok.text_color == Color::Default && tok.bg_color == Color::Default && !tok.bold && !tok.italic;
+        };
+        if (std::none_of(line.tokens.begin(), line.tokens.end(), is_plain)) return;
+
+        auto tokens = core::ArenaSmallVec<DiagnosticTokenInfo>{};
+        auto ranges = core::ArenaSmallVec<HighlightRange, 16>{};
+        for (auto& tok: line.tokens) {
+            if (!is_plain(tok) || tok.text.empty()) {
+                tokens.push_back(std::move(tok));
+                continue;
+            }
+
+            ranges.clear();
+            highlighter.highlight(tok.text.to_borrowed(), ranges);
+            if (ranges.empty()) {
+                tokens.push_back(std::move(tok));
+                continue;
+            }
+
+            auto const size = tok.text.size();
+            auto add_piece = [&tokens, &tok, size](std::size_t start, std::size_t end, HighlightRange const& style) {
+                auto piece_start = tok.token_start_offset + static_cast<dsize_t>(start);
+                auto piece_end = tok.token_start_offset + static_cast<dsize_t>(end);
+                // The last piece keeps the part of the marker past the text, e.g. the newline.
+                if (end == size) piece_end = std::max(piece_end, tok.marker.end());
+                auto s = std::max(piece_start, tok.marker.start());
+                auto e = std::min(piece_end, tok.marker.end());
+                tokens.push_back(DiagnosticTokenInfo{
+                    .text = tok.text.substr(start, end - start),
+                    .token_start_offset = piece_start,
+                    .marker = !tok.marker.empty() && s < e ? Span(s, e) : Span{},
+                    .text_color = style.text_color,
+                    .bg_color = style.bg_color,
+                    .bold = style.bold,
+                    .italic = style.italic,
+                });
+            };
+
+            auto pos = std::size_t{};
+            for (auto const& range: ranges) {
+                auto start = std::clamp<std::size_t>(range.span.start(), pos, size);
+                auto end = std::clamp<std::size_t>(range.span.end(), start, size);
+                if (start > pos) add_piece(pos, start, HighlightRange{});
+                if (end > start) add_piece(start, end, range);
+                pos = end;
+            }
+            if (pos < size) add_piece(pos, size, HighlightRange{});
+        }
+        line.tokens = std::move(tokens);
+    }
+
     // Message index to marker coords
     using message_marker_t = std::unordered_map<term::Point, core::SmallVec<DiagnosticMarker, 2>>;
 
@@ -911,7 +1140,8 @@ namespace dark::internal {
         term::BoundingBox ruler_container,
         term::BoundingBox container,
         message_marker_t& marker_to_message,
-        DiagnosticRenderConfig const& config
+        DiagnosticRenderConfig const& config,
+        SourceWindow const& window = {}
     ) noexcept -> term::BoundingBox {
         static constexpr auto tab_width = term::Canvas::tab_width;
         char tab_indent_buff[tab_width] = {' '};
@@ -929,7 +1159,7 @@ namespace dark::internal {
         auto has_any_marker = [&as](DiagnosticLineTokens const& line) {
             if (line.has_any_marker()) return true;
             for (auto const& el: as.spans) {
-                if (line.span().intersects(el.span)) {
+                if (RelSpan(line.span()).intersects(el.span)) {
                     return true;
                 }
             }
@@ -956,11 +1186,37 @@ namespace dark::internal {
             }
         };
 
+        auto draw_skipped_lines = [&](std::size_t count) {
+            ruler_container = render_ruler(
+                canvas,
+                ruler_container,
+                {},
+                "",
+                config.dotted_vertical,
+                config.ruler_color
+            );
+            canvas.draw_text(
+                std::format("... skipped {} lines ...", count),
+                container.x + 4,
+                container.y,
+                { .dim = true, .italic = true, .group_id = GroupId::diagnostic_source }
+            );
+            container.y++;
+        };
+
         ruler_container.y = container.y;
 
+        // Lines cut out by `window_source_lines` show up as gaps in the line numbers.
+        auto next_line_number = window.first_line_number;
+
         for (auto l = 0ul; l < lines.size();) {
             auto& line = lines[l];
 
+            if (window.trimmed) {
+                if (line.line_number > next_line_number) draw_skipped_lines(line.line_number - next_line_number);
+                next_line_number = line.line_number + 1;
+            }
+
             // Adds ellipsis if consecutive non-marked lines are present, and it exceeds `max_non_marker_lines` from config
             if (!has_any_marker(line) && skip_check_for == 0) {
                 auto number_of_non_marker_lines = 0ul;
@@ -973,21 +1229,8 @@ namespace dark::internal {
                 }
 
                 if (number_of_non_marker_lines >= config.max_non_marker_lines) {
-                    ruler_container = render_ruler(
-                        canvas,
-                        ruler_container,
-                        {},
-                        "",
-                        config.dotted_vertical,
-                        config.ruler_color
-                    );
-                    canvas.draw_text(
-                        std::format("... skipped {} lines ...", number_of_non_marker_lines),
-                        container.x + 4,
-                        container.y,
-                        { .dim = true, .italic = true, .group_id = GroupId::diagnostic_source }
-                    );
-                    container.y++;
+                    draw_skipped_lines(number_of_non_marker_lines);
+                    next_line_number = lines[l - 1].line_number + 1;
                     continue;
                 }
 
@@ -1009,6 +1252,7 @@ namespace dark::internal {
 
             ++l;
             if (line.tokens.empty()) continue;
+            if (config.highlighter) highlight_line(line, *config.highlighter);
 
             auto normalized_tokens = normalize_diagnostic_line(line, as);
 
@@ -1222,7 +1466,7 @@ namespace dark::internal {
                                 marker_start = token.markers[0].span.start();
                                 // 1. precompute markers and set non-secondary markers' relative position to 0.
                                 {
-                                    auto primary_span = Span();
+                                    auto primary_span = RelSpan();
                                     for (auto const& m: token.markers) {
                                         if (m.kind == MarkerKind::Primary) {
                                             primary_span = m.span;
@@ -1527,7 +1771,7 @@ namespace dark::internal {
                                     } else {
                                         token.overflow = term::TextOverflow::start_ellipsis;
                                     }
-                                    token.overflow_span = Span(0, static_cast<dsize_t>(txt.size()));
+                                    token.overflow_span = RelSpan(0, static_cast<doffset_t>(txt.size()));
                                     break;
                                 }
                             } else {
@@ -1545,9 +1789,9 @@ namespace dark::internal {
                                         text_size -= dec;
                                         s += len;
                                     }
-                                    token.overflow_span = Span(
-                                        static_cast<dsize_t>(s),
-                                        static_cast<dsize_t>(txt.size())
+                                    token.overflow_span = RelSpan(
+                                        static_cast<doffset_t>(s),
+                                        static_cast<doffset_t>(txt.size())
                                     );
                                     token.overflow = term::TextOverflow::ellipsis;
                                 } else {
@@ -1558,9 +1802,9 @@ namespace dark::internal {
                                         cols_occupied -= txt[s] == '\t' ? tab_width : 1u;
                                         s += len;
                                     }
-                                    token.overflow_span = Span::from_size(
+                                    token.overflow_span = RelSpan::from_size(
                                         0,
-                                        static_cast<dsize_t>(s)
+                                        static_cast<doffset_t>(s)
                                     );
                                     token.overflow = term::TextOverflow::start_ellipsis;
                                 }
@@ -1623,13 +1867,13 @@ namespace dark::internal {
                                 if (actual_size <= diff) {
                                     {
                                         NormalizedDiagnosticTokenInfo& token = *b;
-                                        token.overflow_span = Span(0, static_cast<dsize_t>(token.text.size()));
+                                        token.overflow_span = RelSpan(0, static_cast<doffset_t>(token.text.size()));
                                         token.overflow = term::TextOverflow::middle_ellipsis;
                                     }
 
                                     for (auto it = b + 1; it != end; ++it) {
                                         NormalizedDiagnosticTokenInfo& token = *it;
-                                        token.overflow_span = Span(0, static_cast<dsize_t>(token.text.size()));
+                                        token.overflow_span = RelSpan(0, static_cast<doffset_t>(token.text.size()));
                                         token.overflow = term::TextOverflow::none;
                                     }
                                     cols_occupied -= actual_size;
@@ -1667,9 +1911,9 @@ namespace dark::internal {
                                                 ed += len;
                                             }
 
-                                            token.overflow_span = Span(
-                                                static_cast<dsize_t>(i),
-                                                static_cast<dsize_t>(std::min(txt.size(), ed))
+                                            token.overflow_span = RelSpan(
+                                                static_cast<doffset_t>(i),
+                                                static_cast<doffset_t>(std::min(txt.size(), ed))
                                             );
                                             token.overflow = term::TextOverflow::middle_ellipsis;
                                             diff -= std::min(diff, count_text_len(txt.substr(i)));
@@ -1690,9 +1934,9 @@ namespace dark::internal {
                                             diff -= std::min(diff, inc);
 
                                             if (diff == 0) {
-                                                token.overflow_span = Span(
-                                                    static_cast<dsize_t>(0),
-                                                    static_cast<dsize_t>(i + len)
+                                                token.overflow_span = RelSpan(
+                                                    static_cast<doffset_t>(0),
+                                                    static_cast<doffset_t>(i + len)
                                                 );
                                                 token.overflow = term::TextOverflow::none;
                                             }
@@ -1775,7 +2019,7 @@ namespace dark::internal {
                                 if (occupied + inc >= total_canvas_cols) {
                                     auto markers = token.markers;
                                     token.markers.clear();
-                                    auto sz = static_cast<dsize_t>(j);
+                                    auto sz = static_cast<doffset_t>(j);
                                     NormalizedDiagnosticTokenInfo t0{
                                         .text = token.text.substr(j),
                                         .markers = {},
@@ -1788,11 +2032,11 @@ namespace dark::internal {
                                     for (auto& m: markers) {
                                         auto left = m;
                                         auto right = m;
-                                        left.span = Span(
+                                        left.span = RelSpan(
                                             m.span.start(),
                                             std::min(sz, m.span.end())
                                         );
-                                        right.span = Span(
+                                        right.span = RelSpan(
                                             std::max(m.span.start(), sz) - sz,
                                             m.span.end()
                                         );
@@ -1832,6 +2076,8 @@ namespace dark::internal {
             ++container.y;
         }
 
+        if (window.trailing_lines) draw_skipped_lines(window.trailing_lines);
+
         return container;
     }
 
@@ -2351,7 +2597,7 @@ namespace dark::internal {
             auto y = container.y + 1;
             // if there are more than 1 items show the bullet points.
             auto should_show_bullet_points = j - i > 1;
-            auto content_width = dsize_t{};
+            auto content_width = unsigned{};
 
             // iterate over the diagnostic messages.
             for (; i < j; ++i) {
@@ -2363,7 +2609,7 @@ namespace dark::internal {
                         .text_color = diagnostic_level_to_color(std::span(config.level_to_color), level),
                         .group_id = GroupId::diagnostic_orphan_message
                     });
-                    padding = static_cast<dsize_t>(should_show_bullet_points) + static_cast<dsize_t>(core::utf8::calculate_size(bp));
+                    padding = static_cast<unsigned>(should_show_bullet_points) + static_cast<unsigned>(core::utf8::calculate_size(bp));
                 }
                 [[maybe_unused]] auto [text_container, p] = canvas.draw_text(
                     as.messages[as.orphans[i].message_index],
@@ -2906,6 +3152,11 @@ namespace dark {
     ) -> void {
         using namespace internal;
 
+        diag.resolve_location();
+        // Windowing cuts a whole-file token down first, so the base is the start of the
+        // kept lines rather than of the file.
+        auto window = window_source_lines(diag, config.max_non_marker_lines);
+        rebase_diagnostic(diag);
         auto canvas = term::Canvas(term.columns());
         auto bbox = render_diagnostic_message(canvas, diag, config);
         auto line_number_width = static_cast<unsigned>(calculate_max_number_line_width(diag)) + 1;
@@ -2941,7 +3192,8 @@ namespace dark {
             ruler_container,
             content_container,
             message_markers,
-            config
+            config,
+            window
         );
 
         ruler_container.y = content_container.y;
@@ -0,0 +1,143 @@
+#ifndef AMT_DARK_DIAGNOSTICS_SOURCE_COLUMN_INDEX_HPP
+#define AMT_DARK_DIAGNOSTICS_SOURCE_COLUMN_INDEX_HPP
+
+#include "../core/config.hpp"
+#include "../core/utf8.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace dark {
+
+    // Code units a column is counted in; LSP clients default to UTF-16.
+    enum class ColumnUnit: std::uint8_t {
+        UTF8,
+        UTF16,
+        UTF32
+    };
+
+    struct SourcePosition {
+        dsize_t line_number{}; // 1-based; 0 is invalid
+        dsize_t column{}; // 0-based, in the requested unit
+
+        constexpr auto operator==(SourcePosition const&) const noexcept -> bool = default;
+    };
+
+    struct SourcePositionRange {
+        SourcePosition start{};
+        SourcePosition end{};
+
+        constexpr auto operator==(SourcePositionRange const&) const noexcept -> bool = default;
+    };
+
+    namespace detail {
+        // Checks eight bytes at a time.
+        constexpr auto is_ascii(std::string_view text) noexcept -> bool {
+            auto i = std::size_t{};
+            if (!std::is_constant_evaluated()) {
+                for (; i + 8 <= text.size(); i += 8) {
+                    std::uint64_t word;
+                    std::memcpy(&word, text.data() + i, sizeof(word));
+                    if (word & 0x8080808080808080ull) return false;
+                }
+            }
+            for (; i < text.size(); ++i) {
+                if (static_cast<unsigned char>(text[i]) >= 0x80) return false;
+            }
+            return true;
+        }
+    } // namespace detail
+
+    /**
+     * @brief Converts the byte columns of a UTF-8 line to UTF-16 or UTF-32 columns and back.
+     *        ASCII-only lines convert in O(1). Other lines keep a checkpoint every
+     *        `checkpoint_stride` bytes, so a conversion only scans from the closest one
+     *        instead of from the line start.
+     *
+     *        The index doesn't keep the text; every query takes the same line text it
+     *        was built from. Columns inside a character round down to its start.
+     */
+    struct LineColumnIndex {
+        static constexpr doffset_t checkpoint_stride = 64;
+
+        constexpr LineColumnIndex() noexcept = default;
+
+        explicit LineColumnIndex(std::string_view line)
+            : m_size(static_cast<doffset_t>(line.size()))
+            , m_ascii(detail::is_ascii(line))
+        {
+            if (m_ascii) return;
+            auto point = Checkpoint{};
+            auto next = checkpoint_stride;
+            for (auto i = std::size_t{}; i < line.size();) {
+                if (i >= next) {
+                    point.byte = static_cast<doffset_t>(i);
+                    m_checkpoints.push_back(point);
+                    next = static_cast<doffset_t>(i) + checkpoint_stride;
+                }
+                auto len = core::utf8::get_length(line[i]);
+                point.utf16 += len == 4 ? 2 : 1;
+                point.utf32 += 1;
+                i += len;
+            }
+        }
+
+        constexpr auto is_ascii() const noexcept -> bool { return m_ascii; }
+        constexpr auto size() const noexcept -> doffset_t { return m_size; }
+
+        // Byte column to `unit` column.
+        constexpr auto to_units(std::string_view line, doffset_t byte_column, ColumnUnit unit) const noexcept -> doffset_t {
+            byte_column = std::min(byte_column, m_size);
+            if (m_ascii || unit == ColumnUnit::UTF8) return byte_column;
+
+            auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), byte_column, [](doffset_t col, Checkpoint const& p) {
+                return col < p.byte;
+            });
+            auto point = it == m_checkpoints.begin() ? Checkpoint{} : *(it - 1);
+            for (auto i = point.byte; i < byte_column;) {
+                auto len = core::utf8::get_length(line[i]);
+                if (i + len > byte_column) break;
+                point.utf16 += len == 4 ? 2 : 1;
+                point.utf32 += 1;
+                i += len;
+            }
+            return unit == ColumnUnit::UTF16 ? point.utf16 : point.utf32;
+        }
+
+        // `unit` column to byte column; columns past the end are clamped to the line size.
+        constexpr auto to_bytes(std::string_view line, doffset_t column, ColumnUnit unit) const noexcept -> doffset_t {
+            if (m_ascii || unit == ColumnUnit::UTF8) return std::min(column, m_size);
+
+            auto units = [unit](Checkpoint const& p) { return unit == ColumnUnit::UTF16 ? p.utf16 : p.utf32; };
+            auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), column, [&units](doffset_t col, Checkpoint const& p) {
+                return col < units(p);
+            });
+            auto point = it == m_checkpoints.begin() ? Checkpoint{} : *(it - 1);
+            auto i = point.byte;
+            auto current = units(point);
+            while (i < m_size) {
+                auto len = core::utf8::get_length(line[i]);
+                auto step = unit == ColumnUnit::UTF16 && len == 4 ? 2u : 1u;
+                if (current + step > column) break;
+                current += step;
+                i += len;
+            }
+            return std::min(i, m_size);
+        }
+    private:
+        struct Checkpoint {
+            doffset_t byte{};
+            doffset_t utf16{};
+            doffset_t utf32{};
+        };
+
+        std::vector<Checkpoint> m_checkpoints;
+        doffset_t m_size{};
+        bool m_ascii{true};
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_SOURCE_COLUMN_INDEX_HPP
@@ -0,0 +1,127 @@
+#ifndef AMT_DARK_DIAGNOSTICS_SOURCE_ENCODING_HPP
+#define AMT_DARK_DIAGNOSTICS_SOURCE_ENCODING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace dark {
+
+    enum class SourceEncoding: std::uint8_t {
+        UTF8,
+        Latin1,
+        UTF16LE,
+        UTF16BE
+    };
+
+    // Encoding announced by a byte order mark; `UTF8` when there's none.
+    [[nodiscard]] constexpr auto detect_encoding(std::string_view text) noexcept -> SourceEncoding {
+        if (text.starts_with("\xFF\xFE")) return SourceEncoding::UTF16LE;
+        if (text.starts_with("\xFE\xFF")) return SourceEncoding::UTF16BE;
+        return SourceEncoding::UTF8;
+    }
+
+    namespace detail {
+        static constexpr char32_t replacement_character = 0xFFFD;
+
+        constexpr auto code_unit_size(SourceEncoding encoding) noexcept -> std::size_t {
+            return encoding == SourceEncoding::UTF16LE || encoding == SourceEncoding::UTF16BE ? 2 : 1;
+        }
+
+        // Size of the byte order mark of a UTF-16 text.
+        constexpr auto bom_size(std::string_view text, SourceEncoding encoding) noexcept -> std::size_t {
+            if (encoding == SourceEncoding::UTF16LE && text.starts_with("\xFF\xFE")) return 2;
+            if (encoding == SourceEncoding::UTF16BE && text.starts_with("\xFE\xFF")) return 2;
+            return 0;
+        }
+
+        constexpr auto code_unit_at(std::string_view text, std::size_t pos, SourceEncoding encoding) noexcept -> char16_t {
+            auto lo = static_cast<unsigned char>(text[pos]);
+            auto hi = static_cast<unsigned char>(text[pos + 1]);
+            if (encoding == SourceEncoding::UTF16BE) std::swap(lo, hi);
+            return static_cast<char16_t>(lo | (hi << 8));
+        }
+
+        // Whether the text ends with the code unit `c`.
+        constexpr auto ends_with_unit(std::string_view text, SourceEncoding encoding, char c) noexcept -> bool {
+            auto unit = code_unit_size(encoding);
+            if (text.size() < unit) return false;
+            if (unit == 1) return text.back() == c;
+            return code_unit_at(text, text.size() - 2, encoding) == static_cast<char16_t>(c);
+        }
+
+        /**
+         * @brief Calls `fn(code_point)` for every code point of a Latin-1 or UTF-16 text.
+         *        Unpaired surrogates and a trailing odd byte become U+FFFD.
+         */
+        template <typename Fn>
+        constexpr auto for_each_code_point(std::string_view text, SourceEncoding encoding, Fn&& fn) -> void {
+            if (code_unit_size(encoding) == 1) {
+                for (auto c: text) fn(static_cast<char32_t>(static_cast<unsigned char>(c)));
+                return;
+            }
+
+            auto i = std::size_t{};
+            for (; i + 2 <= text.size(); i += 2) {
+                char32_t cp = code_unit_at(text, i, encoding);
+                if (cp >= 0xD800 && cp <= 0xDBFF && i + 4 <= text.size()) {
+                    auto low = code_unit_at(text, i + 2, encoding);
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        fn(0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00));
+                        i += 2;
+                        continue;
+                    }
+                }
+                fn(cp >= 0xD800 && cp <= 0xDFFF ? replacement_character : cp);
+            }
+            if (i < text.size()) fn(replacement_character);
+        }
+
+        constexpr auto utf8_size(char32_t cp) noexcept -> std::size_t {
+            if (cp < 0x80) return 1;
+            if (cp < 0x800) return 2;
+            if (cp < 0x10000) return 3;
+            return 4;
+        }
+    } // namespace detail
+
+    // Number of bytes the text takes once it's transcoded to UTF-8.
+    [[nodiscard]] constexpr auto utf8_length(std::string_view text, SourceEncoding encoding) noexcept -> std::size_t {
+        if (encoding == SourceEncoding::UTF8) return text.size();
+        auto size = std::size_t{};
+        detail::for_each_code_point(text, encoding, [&size](char32_t cp) { size += detail::utf8_size(cp); });
+        return size;
+    }
+
+    [[nodiscard]] inline auto transcode_to_utf8(std::string_view text, SourceEncoding encoding) -> std::string {
+        if (encoding == SourceEncoding::UTF8) return std::string(text);
+        auto res = std::string();
+        res.reserve(utf8_length(text, encoding));
+        detail::for_each_code_point(text, encoding, [&res](char32_t cp) {
+            switch (detail::utf8_size(cp)) {
+                case 1: res.push_back(static_cast<char>(cp)); break;
+                case 2: {
+                    res.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+                    res.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+                } break;
+                case 3: {
+                    res.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+                    res.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                    res.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+                } break;
+                default: {
+                    res.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+                    res.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+                    res.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                    res.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+                } break;
+            }
+        });
+        return res;
+    }
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_SOURCE_ENCODING_HPP
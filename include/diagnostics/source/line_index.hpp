@@ -0,0 +1,242 @@
+#ifndef AMT_DARK_DIAGNOSTICS_SOURCE_LINE_INDEX_HPP
+#define AMT_DARK_DIAGNOSTICS_SOURCE_LINE_INDEX_HPP
+
+#include "../core/config.hpp"
+#include "encoding.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define DARK_DIAGNOSTICS_SSE2
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define DARK_DIAGNOSTICS_NEON
+#endif
+
+namespace dark {
+
+    struct SourceLineInfo {
+        dsize_t line_number{}; // 1-based; 0 is invalid
+        dsize_t line_start_offset{};
+        dsize_t column{}; // 0-based byte offset from the line start
+    };
+
+    namespace detail {
+        /**
+         * @brief Calls `fn(offset)` for every '\n' in the text in increasing order. Scans
+         *        16 bytes at a time with SSE2/NEON and falls back to `memchr` for the tail.
+         */
+        template <typename Fn>
+        inline auto for_each_newline(std::string_view text, Fn&& fn) -> void {
+            auto const* data = text.data();
+            auto const size = text.size();
+            auto i = std::size_t{};
+
+            #if defined(DARK_DIAGNOSTICS_SSE2)
+            auto const nl = _mm_set1_epi8('\n');
+            for (; i + 16 <= size; i += 16) {
+                auto chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i));
+                auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl)));
+                while (mask) {
+                    fn(i + static_cast<std::size_t>(std::countr_zero(mask)));
+                    mask &= mask - 1;
+                }
+            }
+            #elif defined(DARK_DIAGNOSTICS_NEON)
+            auto const nl = vdupq_n_u8('\n');
+            for (; i + 16 <= size; i += 16) {
+                auto eq = vceqq_u8(vld1q_u8(reinterpret_cast<std::uint8_t const*>(data + i)), nl);
+                // Narrows every byte of the comparison to a nibble.
+                auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+                while (mask) {
+                    auto bit = static_cast<unsigned>(std::countr_zero(mask));
+                    fn(i + (bit >> 2));
+                    mask &= ~(std::uint64_t{0xF} << (bit & ~3u));
+                }
+            }
+            #endif
+
+            while (i < size) {
+                auto const* ptr = static_cast<char const*>(std::memchr(data + i, '\n', size - i));
+                if (ptr == nullptr) break;
+                auto pos = static_cast<std::size_t>(ptr - data);
+                fn(pos);
+                i = pos + 1;
+            }
+        }
+    } // namespace detail
+
+    // Describes how an edit changed the lines of an index.
+    struct LineEdit {
+        dsize_t line_number{}; // 1-based line containing the start of the edit
+        dsize_t removed_lines{}; // lines after `line_number` that were merged into it
+        dsize_t inserted_lines{}; // lines after `line_number` that were created
+        std::ptrdiff_t delta{}; // change in the text size
+    };
+
+    /**
+     * @brief Offsets of every line start in a source text. Built once with a vectorized
+     *        newline scan; offset to line queries are a binary search.
+     *
+     *        Edits are applied in place: the lines touched by the edit are rescanned and
+     *        the offsets after it are shifted lazily. The pending shift only has to be
+     *        moved across the lines between two consecutive edits, so typing is
+     *        proportional to the edit size rather than the file size.
+     */
+    struct LineIndex {
+        LineIndex() = default;
+
+        explicit LineIndex(std::string_view text) {
+            build(text);
+        }
+
+        auto build(std::string_view text) -> void {
+            build(text, SourceEncoding::UTF8);
+        }
+
+        // UTF-16 newlines are the '\n' bytes that form a whole code unit with a zero byte.
+        auto build(std::string_view text, SourceEncoding encoding) -> void {
+            assert(text.size() <= static_cast<std::size_t>(static_cast<dsize_t>(~dsize_t{})) && "Source is too large for dsize_t");
+            m_starts.clear();
+            m_starts.reserve(text.size() / 64 + 1);
+            m_starts.push_back(0);
+            switch (encoding) {
+                case SourceEncoding::UTF16LE: {
+                    detail::for_each_newline(text, [this, text](std::size_t pos) {
+                        if (pos % 2 == 0 && pos + 1 < text.size() && text[pos + 1] == '\0') {
+                            m_starts.push_back(static_cast<dsize_t>(pos + 2));
+                        }
+                    });
+                } break;
+                case SourceEncoding::UTF16BE: {
+                    detail::for_each_newline(text, [this, text](std::size_t pos) {
+                        if (pos % 2 == 1 && text[pos - 1] == '\0') {
+                            m_starts.push_back(static_cast<dsize_t>(pos + 1));
+                        }
+                    });
+                } break;
+                default: {
+                    detail::for_each_newline(text, [this](std::size_t pos) {
+                        m_starts.push_back(static_cast<dsize_t>(pos + 1));
+                    });
+                } break;
+            }
+            m_size = static_cast<dsize_t>(text.size());
+            m_shift_from = m_starts.size();
+            m_shift = 0;
+        }
+
+        /**
+         * @brief Updates the index after `removed` bytes at `offset` were replaced by `inserted`.
+         * @param inserted the new text; only scanned for newlines.
+         */
+        auto replace(dsize_t offset, dsize_t removed, std::string_view inserted) -> LineEdit {
+            assert(!m_starts.empty() && offset + removed <= m_size);
+            // Indices of the line starts inside the replaced range.
+            auto first = static_cast<std::size_t>(find_line(offset));
+            auto last = static_cast<std::size_t>(find_line(offset + removed));
+
+            move_shift_to(first);
+            m_starts.erase(m_starts.begin() + static_cast<std::ptrdiff_t>(first), m_starts.begin() + static_cast<std::ptrdiff_t>(last));
+
+            auto new_starts = std::vector<dsize_t>();
+            detail::for_each_newline(inserted, [&](std::size_t pos) {
+                new_starts.push_back(static_cast<dsize_t>(offset + pos + 1));
+            });
+            m_starts.insert(m_starts.begin() + static_cast<std::ptrdiff_t>(first), new_starts.begin(), new_starts.end());
+
+            auto delta = static_cast<dsize_t>(inserted.size()) - removed;
+            m_shift_from = first + new_starts.size();
+            m_shift += delta;
+            m_size += delta;
+            if (m_shift_from == m_starts.size()) m_shift = 0;
+
+            return {
+                .line_number = static_cast<dsize_t>(first),
+                .removed_lines = static_cast<dsize_t>(last - first),
+                .inserted_lines = static_cast<dsize_t>(new_starts.size()),
+                .delta = static_cast<std::ptrdiff_t>(inserted.size()) - static_cast<std::ptrdiff_t>(removed)
+            };
+        }
+
+        // Number of lines; a trailing newline starts an empty last line.
+        constexpr auto line_count() const noexcept -> dsize_t {
+            return static_cast<dsize_t>(m_starts.size());
+        }
+
+        constexpr auto text_size() const noexcept -> dsize_t { return m_size; }
+
+        // @param line_number 1-based line number.
+        constexpr auto line_start(dsize_t line_number) const noexcept -> dsize_t {
+            assert(line_number > 0 && line_number <= line_count());
+            return start_at(line_number - 1);
+        }
+
+        // End of the line excluding the newline.
+        constexpr auto line_end(dsize_t line_number) const noexcept -> dsize_t {
+            assert(line_number > 0 && line_number <= line_count());
+            if (line_number == line_count()) return m_size;
+            return start_at(line_number) - 1;
+        }
+
+        // Offsets past the end are clamped to the last line.
+        constexpr auto find_line(dsize_t offset) const noexcept -> dsize_t {
+            if (m_starts.empty()) return 0;
+            // Both halves are sorted by their real offsets; the stored values after the
+            // split may have wrapped around, so they're compared after adding the shift.
+            auto split = m_shift_from;
+            if (split < m_starts.size() && m_starts[split] + m_shift <= offset) {
+                auto it = std::upper_bound(
+                    m_starts.begin() + static_cast<std::ptrdiff_t>(split) + 1, m_starts.end(), offset,
+                    [shift = m_shift](dsize_t off, dsize_t stored) { return off < stored + shift; }
+                );
+                return static_cast<dsize_t>(it - m_starts.begin());
+            }
+            auto it = std::upper_bound(m_starts.begin() + 1, m_starts.begin() + static_cast<std::ptrdiff_t>(split), offset);
+            return static_cast<dsize_t>(it - m_starts.begin());
+        }
+
+        constexpr auto info(dsize_t offset) const noexcept -> SourceLineInfo {
+            auto line = find_line(offset);
+            if (line == 0) return {};
+            auto start = start_at(line - 1);
+            return {
+                .line_number = line,
+                .line_start_offset = start,
+                .column = offset - start
+            };
+        }
+
+        constexpr auto empty() const noexcept -> bool { return m_starts.empty(); }
+    private:
+        constexpr auto start_at(std::size_t index) const noexcept -> dsize_t {
+            return m_starts[index] + (index >= m_shift_from ? m_shift : dsize_t{});
+        }
+
+        // Applies or un-applies the pending shift so that it starts at `index`.
+        auto move_shift_to(std::size_t index) noexcept -> void {
+            if (m_shift != 0) {
+                for (auto i = m_shift_from; i < index; ++i) m_starts[i] += m_shift;
+                for (auto i = index; i < m_shift_from; ++i) m_starts[i] -= m_shift;
+            }
+            m_shift_from = index;
+        }
+    private:
+        // Entries at or after `m_shift_from` are stored without `m_shift`; the arithmetic
+        // is modular so a negative shift is just a large unsigned value.
+        std::vector<dsize_t> m_starts;
+        std::size_t m_shift_from{};
+        dsize_t m_shift{};
+        dsize_t m_size{};
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_SOURCE_LINE_INDEX_HPP
@@ -0,0 +1,156 @@
+#ifndef AMT_DARK_DIAGNOSTICS_SOURCE_MAPPED_SOURCE_FILE_HPP
+#define AMT_DARK_DIAGNOSTICS_SOURCE_MAPPED_SOURCE_FILE_HPP
+
+#include "../core/config.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#ifdef DARK_OS_UNIX
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#elifdef DARK_OS_WIN
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#endif
+
+namespace dark {
+
+    enum class MappedFileAdvice: std::uint8_t {
+        Normal,
+        Sequential, // e.g. while the line index is built
+        Random,     // e.g. while the renderer reads a few lines
+        WillNeed
+    };
+
+    /**
+     * @brief Read-only memory mapping of a file. The text isn't copied; pages are read
+     *        by the kernel when they're touched, so rendering a few lines of a huge file
+     *        only reads those pages.
+     * @note The file must not be truncated while it's mapped.
+     */
+    struct MappedSourceFile {
+        constexpr MappedSourceFile() noexcept = default;
+
+        // Throws `std::system_error` if the file cannot be opened or mapped.
+        explicit MappedSourceFile(std::string const& path) {
+            #ifdef DARK_OS_UNIX
+                auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd == -1) throw std::system_error(errno, std::generic_category(), "Failed to open " + path);
+
+                struct stat st{};
+                if (::fstat(fd, &st) == -1) {
+                    auto err = errno;
+                    ::close(fd);
+                    throw std::system_error(err, std::generic_category(), "Failed to stat " + path);
+                }
+
+                m_size = static_cast<std::size_t>(st.st_size);
+                if (m_size != 0) {
+                    auto* ptr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (ptr == MAP_FAILED) {
+                        auto err = errno;
+                        ::close(fd);
+                        throw std::system_error(err, std::generic_category(), "Failed to map " + path);
+                    }
+                    m_data = static_cast<char const*>(ptr);
+                }
+                // The mapping keeps the file alive.
+                ::close(fd);
+            #elifdef DARK_OS_WIN
+                auto file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+                if (file == INVALID_HANDLE_VALUE) {
+                    throw std::system_error(static_cast<int>(::GetLastError()), std::system_category(), "Failed to open " + path);
+                }
+
+                LARGE_INTEGER size{};
+                if (!::GetFileSizeEx(file, &size)) {
+                    auto err = ::GetLastError();
+                    ::CloseHandle(file);
+                    throw std::system_error(static_cast<int>(err), std::system_category(), "Failed to stat " + path);
+                }
+
+                m_size = static_cast<std::size_t>(size.QuadPart);
+                if (m_size != 0) {
+                    auto mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                    auto* ptr = mapping ? ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+                    auto err = ::GetLastError();
+                    if (mapping) ::CloseHandle(mapping);
+                    if (ptr == nullptr) {
+                        ::CloseHandle(file);
+                        throw std::system_error(static_cast<int>(err), std::system_category(), "Failed to map " + path);
+                    }
+                    m_data = static_cast<char const*>(ptr);
+                }
+                ::CloseHandle(file);
+            #endif
+        }
+
+        MappedSourceFile(MappedSourceFile const&) = delete;
+        MappedSourceFile& operator=(MappedSourceFile const&) = delete;
+
+        MappedSourceFile(MappedSourceFile&& other) noexcept
+            : m_data(std::exchange(other.m_data, nullptr))
+            , m_size(std::exchange(other.m_size, 0))
+        {}
+
+        MappedSourceFile& operator=(MappedSourceFile&& other) noexcept {
+            if (this == &other) return *this;
+            unmap();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+            return *this;
+        }
+
+        ~MappedSourceFile() {
+            unmap();
+        }
+
+        constexpr auto text() const noexcept -> std::string_view { return { m_data, m_size }; }
+        constexpr auto data() const noexcept -> char const* { return m_data; }
+        constexpr auto size() const noexcept -> std::size_t { return m_size; }
+        constexpr auto empty() const noexcept -> bool { return m_size == 0; }
+
+        // Hints the kernel about the upcoming access pattern; it's a no-op where unsupported.
+        auto advise(MappedFileAdvice advice) const noexcept -> void {
+            #ifdef DARK_OS_UNIX
+                if (m_data == nullptr) return;
+                auto flag = MADV_NORMAL;
+                switch (advice) {
+                    case MappedFileAdvice::Normal: flag = MADV_NORMAL; break;
+                    case MappedFileAdvice::Sequential: flag = MADV_SEQUENTIAL; break;
+                    case MappedFileAdvice::Random: flag = MADV_RANDOM; break;
+                    case MappedFileAdvice::WillNeed: flag = MADV_WILLNEED; break;
+                }
+                ::madvise(const_cast<char*>(m_data), m_size, flag);
+            #else
+                (void)advice;
+            #endif
+        }
+    private:
+        auto unmap() noexcept -> void {
+            if (m_data == nullptr) return;
+            #ifdef DARK_OS_UNIX
+                ::munmap(const_cast<char*>(m_data), m_size);
+            #elifdef DARK_OS_WIN
+                ::UnmapViewOfFile(m_data);
+            #endif
+            m_data = nullptr;
+            m_size = 0;
+        }
+    private:
+        char const* m_data{};
+        std::size_t m_size{};
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_SOURCE_MAPPED_SOURCE_FILE_HPP
@@ -0,0 +1,198 @@
+#ifndef AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_BUFFER_HPP
+#define AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_BUFFER_HPP
+
+#include "../basic.hpp"
+#include "../span.hpp"
+#include "line_index.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dark {
+
+    /**
+     * @brief Editable source text for editor and language server sessions. Edits update
+     *        the line index and the cached line tokens incrementally; only the lines
+     *        touched by an edit are rescanned or re-tokenized.
+     *
+     *        Cached tokens are stored relative to their line start, so lines after an
+     *        edit stay valid even though their offsets moved. Locations built from the
+     *        buffer own their text since the buffer may change under them.
+     */
+    struct SourceBuffer {
+        // Appends the tokens of a line to `tokens`; token offsets are relative to the line start.
+        using tokenizer_t = std::function<void(std::string_view line, core::ArenaSmallVec<DiagnosticTokenInfo>& tokens)>;
+
+        SourceBuffer(std::string filename, std::string text, tokenizer_t tokenizer = {})
+            : m_filename(std::move(filename))
+            , m_text(std::move(text))
+            , m_index(m_text)
+            , m_tokenizer(std::move(tokenizer))
+        {}
+
+        SourceBuffer(SourceBuffer const&) = delete;
+        SourceBuffer(SourceBuffer &&) = delete;
+        SourceBuffer& operator=(SourceBuffer const&) = delete;
+        SourceBuffer& operator=(SourceBuffer &&) = delete;
+
+        constexpr auto filename() const noexcept -> std::string_view { return m_filename; }
+        constexpr auto text() const noexcept -> std::string_view { return m_text; }
+        constexpr auto size() const noexcept -> dsize_t { return m_index.text_size(); }
+        constexpr auto line_count() const noexcept -> dsize_t { return m_index.line_count(); }
+        constexpr auto line_index() const noexcept -> LineIndex const& { return m_index; }
+
+        // Incremented on every edit.
+        constexpr auto version() const noexcept -> std::uint64_t { return m_version; }
+
+        constexpr auto line_info(dsize_t offset) const noexcept -> SourceLineInfo {
+            return m_index.info(offset);
+        }
+
+        // Line text without the line terminator.
+        constexpr auto line_text(dsize_t line_number) const noexcept -> std::string_view {
+            auto start = m_index.line_start(line_number);
+            auto text = std::string_view(m_text).substr(start, m_index.line_end(line_number) - start);
+            if (text.ends_with('\r')) text.remove_suffix(1);
+            return text;
+        }
+
+        /**
+         * @brief Replaces the bytes in `range` with `text`. The range is clamped to the buffer.
+         * @return the lines affected by the edit.
+         */
+        auto replace(Span range, std::string_view text) -> LineEdit {
+            auto start = std::min(range.start(), size());
+            auto removed = std::min(range.end(), size()) - start;
+            m_text.replace(start, removed, text);
+            auto edit = m_index.replace(start, removed, text);
+            invalidate(edit);
+            ++m_version;
+            return edit;
+        }
+
+        auto insert(dsize_t offset, std::string_view text) -> LineEdit {
+            return replace(Span(offset, offset), text);
+        }
+
+        auto erase(Span range) -> LineEdit {
+            return replace(range, {});
+        }
+
+        // Replaces the whole text; drops every cached line.
+        auto set_text(std::string text) -> void {
+            m_text = std::move(text);
+            m_index.build(m_text);
+            m_cache.clear();
+            ++m_version;
+        }
+
+        // Changing the tokenizer drops every cached line.
+        auto set_tokenizer(tokenizer_t tokenizer) -> void {
+            m_tokenizer = std::move(tokenizer);
+            m_cache.clear();
+        }
+
+        /**
+         * @brief Tokens of a line with absolute offsets. Lines are tokenized on first use
+         *        and cached until an edit touches them. Without a tokenizer the whole line
+         *        is a single token.
+         */
+        auto line_tokens(dsize_t line_number) -> DiagnosticLineTokens {
+            assert(line_number > 0 && line_number <= line_count());
+            auto const& cached = cached_line(line_number);
+            auto start = m_index.line_start(line_number);
+
+            auto line = DiagnosticLineTokens{ .tokens = {}, .line_number = line_number, .line_start_offset = start };
+            line.tokens.reserve(cached.tokens.size());
+            for (auto const& tok: cached.tokens) {
+                line.tokens.push_back(tok);
+                line.tokens.back().token_start_offset += start;
+            }
+            return line;
+        }
+
+        /**
+         * @brief Builds a location containing only the lines covered by the marker.
+         * @param marker absolute span from the start of the buffer.
+         */
+        auto location(Span marker) -> DiagnosticLocation {
+            auto tokens = DiagnosticSourceLocationTokens{};
+            auto first = m_index.find_line(marker.start());
+            auto last = marker.empty() ? first : m_index.find_line(marker.end() - 1);
+            for (auto l = first; l <= last && l != 0; ++l) {
+                auto line = line_tokens(l);
+                if (!marker.empty()) line.clip_marker(marker, std::min(m_index.line_end(l) + 1, size()));
+                tokens.lines.push_back(std::move(line));
+            }
+            return { filename(), std::move(tokens) };
+        }
+    private:
+        // Stored on the heap rather than in the arena that's active while tokenizing.
+        struct CachedLine {
+            std::vector<DiagnosticTokenInfo> tokens{};
+            bool valid{ false };
+        };
+
+        auto cached_line(dsize_t line_number) -> CachedLine const& {
+            if (m_cache.size() != line_count()) m_cache.resize(line_count());
+            auto& cached = m_cache[line_number - 1];
+            if (cached.valid) return cached;
+
+            cached.tokens.clear();
+            auto text = line_text(line_number);
+            if (m_tokenizer) {
+                auto tokens = core::ArenaSmallVec<DiagnosticTokenInfo>{};
+                m_tokenizer(text, tokens);
+                cached.tokens.assign(tokens.begin(), tokens.end());
+                // The text moves with every edit, so the cache cannot borrow it.
+                for (auto& tok: cached.tokens) {
+                    if (tok.text.is_borrowed()) tok.text = core::CowString(tok.text.to_owned());
+                }
+            } else {
+                // Empty lines keep a token so that a marker can point at them.
+                cached.tokens.push_back(DiagnosticTokenInfo{ .text = core::CowString(std::string(text)) });
+            }
+            cached.valid = true;
+            return cached;
+        }
+
+        // Drops the cache entries of the edited lines and shifts the ones after them.
+        auto invalidate(LineEdit const& edit) -> void {
+            if (m_cache.empty()) return;
+            auto first = static_cast<std::size_t>(edit.line_number - 1);
+            if (first >= m_cache.size()) {
+                m_cache.clear();
+                return;
+            }
+            auto removed = std::min<std::size_t>(edit.removed_lines + 1u, m_cache.size() - first);
+            auto inserted = static_cast<std::size_t>(edit.inserted_lines) + 1u;
+            auto it = m_cache.begin() + static_cast<std::ptrdiff_t>(first);
+
+            // Most edits stay within their lines, so the entries are reset in place and keep
+            // their token storage; only a change in the line count shifts the cache.
+            auto const reused = std::min(removed, inserted);
+            for (auto i = std::size_t{}; i < reused; ++i) it[static_cast<std::ptrdiff_t>(i)].valid = false;
+            it += static_cast<std::ptrdiff_t>(reused);
+            if (removed > inserted) {
+                m_cache.erase(it, it + static_cast<std::ptrdiff_t>(removed - inserted));
+            } else if (inserted > removed) {
+                m_cache.insert(it, inserted - removed, CachedLine{});
+            }
+        }
+    private:
+        std::string m_filename;
+        std::string m_text;
+        LineIndex m_index;
+        tokenizer_t m_tokenizer;
+        std::vector<CachedLine> m_cache;
+        std::uint64_t m_version{};
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_BUFFER_HPP
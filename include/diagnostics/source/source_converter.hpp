@@ -0,0 +1,49 @@
+#ifndef AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_CONVERTER_HPP
+#define AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_CONVERTER_HPP
+
+#include "../converter.hpp"
+#include "source_location.hpp"
+#include "source_manager.hpp"
+#include <cstdint>
+#include <string_view>
+
+namespace dark {
+
+    /**
+     * @brief Converts encoded ranges using a `SourceManager`. The emitter stores the 8-byte
+     *        range until conversion, which can be deferred, and sorting compares keys
+     *        derived from it without converting it.
+     */
+    struct SourceRangeConverter: DiagnosticConverter<SourceRange> {
+        explicit SourceRangeConverter(SourceManager const& manager) noexcept
+            : m_manager(&manager)
+        {}
+
+        auto convert_loc(loc_t loc, builder_t& /*builder*/) const -> DiagnosticLocation override {
+            return m_manager->location(loc);
+        }
+
+        auto supports_deferred_conversion() const noexcept -> bool override { return true; }
+
+        auto convert_deferred_loc(loc_t loc) const -> DiagnosticLocation override {
+            return m_manager->location(loc);
+        }
+
+        auto source_filename(loc_t loc) const -> std::string_view override {
+            auto [id, _] = m_manager->decode(loc.start);
+            if (!id) return {};
+            return m_manager->file(id).filename();
+        }
+
+        auto location_key(loc_t loc) const noexcept -> std::uint64_t override {
+            return m_manager->sort_key(loc.start);
+        }
+
+        constexpr auto manager() const noexcept -> SourceManager const& { return *m_manager; }
+    private:
+        SourceManager const* m_manager;
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_CONVERTER_HPP
@@ -0,0 +1,330 @@
+#ifndef AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_FILE_HPP
+#define AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_FILE_HPP
+
+#include "../basic.hpp"
+#include "../core/small_vec.hpp"
+#include "../span.hpp"
+#include "column_index.hpp"
+#include "encoding.hpp"
+#include "line_index.hpp"
+#include "mapped_source_file.hpp"
+#include "source_location.hpp"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace dark {
+
+    /**
+     * @brief Source text together with its line index. Locations built from it borrow
+     *        the text, so the file must outlive the diagnostics that refer to it. The
+     *        text is either owned, borrowed or memory-mapped.
+     *
+     *        Latin-1 and UTF-16 files are kept in their encoding; only the lines that
+     *        end up in a location are transcoded to UTF-8, once each. Offsets such as
+     *        markers and `line_info` are byte offsets of the encoded text, while the
+     *        tokens of a location use the UTF-8 offsets from `utf8_offset`; such locations
+     *        have `has_byte_offsets` unset.
+     */
+    struct SourceFile {
+        struct BorrowedTag{};
+
+        SourceFile(std::string filename, std::string text, SourceEncoding encoding = SourceEncoding::UTF8)
+            : m_filename(std::move(filename))
+            , m_storage(std::move(text))
+            , m_text(m_storage)
+        {
+            build_index(encoding);
+        }
+
+        // Doesn't copy the text; it must outlive the file.
+        SourceFile(std::string filename, std::string_view text, BorrowedTag, SourceEncoding encoding = SourceEncoding::UTF8)
+            : m_filename(std::move(filename))
+            , m_text(text)
+        {
+            build_index(encoding);
+        }
+
+        SourceFile(std::string filename, MappedSourceFile mapping, SourceEncoding encoding = SourceEncoding::UTF8)
+            : m_filename(std::move(filename))
+            , m_mapping(std::move(mapping))
+            , m_text(m_mapping.text())
+        {
+            m_mapping.advise(MappedFileAdvice::Sequential);
+            build_index(encoding);
+            // Only a few lines are read afterwards.
+            m_mapping.advise(MappedFileAdvice::Random);
+        }
+
+        SourceFile(SourceFile const&) = delete;
+        SourceFile(SourceFile &&) = delete;
+        SourceFile& operator=(SourceFile const&) = delete;
+        SourceFile& operator=(SourceFile &&) = delete;
+
+        // Maps the file read-only; throws `std::system_error` if it cannot be mapped.
+        static auto map(std::string path, SourceEncoding encoding = SourceEncoding::UTF8) -> SourceFile {
+            auto mapping = MappedSourceFile(path);
+            return SourceFile(std::move(path), std::move(mapping), encoding);
+        }
+
+        constexpr auto filename() const noexcept -> std::string_view { return m_filename; }
+        constexpr auto text() const noexcept -> std::string_view { return m_text; }
+        constexpr auto size() const noexcept -> dsize_t { return m_index.text_size(); }
+        constexpr auto line_count() const noexcept -> dsize_t { return m_index.line_count(); }
+        constexpr auto line_index() const noexcept -> LineIndex const& { return m_index; }
+        constexpr auto is_mapped() const noexcept -> bool { return m_mapping.data() != nullptr; }
+        constexpr auto encoding() const noexcept -> SourceEncoding { return m_encoding; }
+
+        // Only valid once the file is registered in a `SourceManager`.
+        constexpr auto id() const noexcept -> FileId { return m_id; }
+        constexpr auto base() const noexcept -> SourceLocation { return m_base; }
+
+        // Encodes an offset of this file; the file must be registered in a `SourceManager`.
+        constexpr auto encode(dsize_t offset) const noexcept -> SourceLocation {
+            assert(m_base.is_valid() && offset <= size());
+            return m_base.advance(offset);
+        }
+
+        constexpr auto encode(Span span) const noexcept -> SourceRange {
+            return { .start = encode(span.start()), .size = span.size() };
+        }
+
+        constexpr auto line_info(dsize_t offset) const noexcept -> SourceLineInfo {
+            return m_index.info(offset);
+        }
+
+        // Line text in UTF-8 without the line terminator; other encodings are transcoded on first use.
+        auto line_text(dsize_t line_number) const -> std::string_view {
+            if (m_encoding == SourceEncoding::UTF8) return raw_line_text(line_number);
+            return transcoded_line(line_number);
+        }
+
+        // Line bytes in the source encoding without the line terminator or a byte order mark.
+        constexpr auto raw_line_text(dsize_t line_number) const noexcept -> std::string_view {
+            auto start = line_number == 1 ? m_bom : m_index.line_start(line_number);
+            auto end = line_number == line_count() ? size() : m_index.line_start(line_number + 1);
+            auto text = m_text.substr(start, std::max(end, start) - start);
+            auto unit = detail::code_unit_size(m_encoding);
+            if (detail::ends_with_unit(text, m_encoding, '\n')) text.remove_suffix(unit);
+            if (detail::ends_with_unit(text, m_encoding, '\r')) text.remove_suffix(unit);
+            return text;
+        }
+
+        /**
+         * @brief Maps a byte offset of the encoded text to the offset used by the tokens of
+         *        a location. It's the identity for UTF-8. Otherwise every line starts at
+         *        twice its encoded offset, which leaves room for the UTF-8 text, so the
+         *        mapping only transcodes the line prefix.
+         */
+        constexpr auto utf8_offset(dsize_t offset) const noexcept -> dsize_t {
+            if (m_encoding == SourceEncoding::UTF8) return offset;
+            offset = std::min(offset, size());
+            auto line = m_index.find_line(offset);
+            auto start = line == 1 ? m_bom : m_index.line_start(line);
+            auto prefix = m_text.substr(start, offset - std::min(offset, start));
+            return utf8_line_start(line) + static_cast<dsize_t>(utf8_length(prefix, m_encoding));
+        }
+
+        // Maps the spans of annotations on a non-UTF-8 file; see `utf8_offset`.
+        constexpr auto utf8_span(Span span) const noexcept -> Span {
+            if (m_encoding == SourceEncoding::UTF8) return span;
+            return Span(utf8_offset(span.start()), utf8_offset(span.end()));
+        }
+
+        constexpr auto utf8_line_start(dsize_t line_number) const noexcept -> dsize_t {
+            auto start = m_index.line_start(line_number);
+            return m_encoding == SourceEncoding::UTF8 ? start : start * 2;
+        }
+
+        // End of the line including the newline, in token offsets.
+        constexpr auto utf8_line_end(dsize_t line_number) const noexcept -> dsize_t {
+            if (m_encoding == SourceEncoding::UTF8) return std::min(m_index.line_end(line_number) + 1, size());
+            if (line_number == line_count()) return utf8_offset(size());
+            return utf8_line_start(line_number + 1);
+        }
+
+        /**
+         * @brief Line and column of an offset with the column counted in `unit`, e.g. for
+         *        LSP positions. The column index of a line is built on first use.
+         */
+        auto position(dsize_t offset, ColumnUnit unit) const -> SourcePosition {
+            auto line = m_index.find_line(std::min(offset, size()));
+            if (line == 0) return {};
+            auto byte_column = utf8_offset(offset) - utf8_line_start(line);
+            return {
+                .line_number = line,
+                .column = column_index(line).to_units(line_text(line), to_offset(byte_column), unit)
+            };
+        }
+
+        /**
+         * @brief Start and end positions of a span, e.g. an LSP range. A span within a
+         *        single line, which most are, looks up the line and its column index once.
+         */
+        auto position(Span span, ColumnUnit unit) const -> SourcePositionRange {
+            auto start = std::min(span.start(), size());
+            auto end = std::min(span.end(), size());
+            auto line = m_index.find_line(start);
+            if (line == 0) return {};
+            if (line != line_count() && end >= m_index.line_start(line + 1)) {
+                return { .start = position(start, unit), .end = position(end, unit) };
+            }
+
+            auto const& index = column_index(line);
+            auto text = line_text(line);
+            auto line_start = utf8_line_start(line);
+            auto column = [&](dsize_t offset) {
+                return index.to_units(text, to_offset(utf8_offset(offset) - line_start), unit);
+            };
+            return {
+                .start = { .line_number = line, .column = column(start) },
+                .end = { .line_number = line, .column = column(end) }
+            };
+        }
+
+        // Offset of a position; lines and columns past the end are clamped.
+        auto offset(SourcePosition position, ColumnUnit unit) const -> dsize_t {
+            if (m_index.empty()) return 0;
+            auto line = std::clamp(position.line_number, dsize_t{1}, line_count());
+            auto column = std::min<dsize_t>(position.column, std::numeric_limits<doffset_t>::max());
+            auto bytes = column_index(line).to_bytes(line_text(line), to_offset(column), unit);
+            if (m_encoding == SourceEncoding::UTF8) return m_index.line_start(line) + bytes;
+
+            // Walks the encoded line until it covers `bytes` of UTF-8.
+            auto start = line == 1 ? m_bom : m_index.line_start(line);
+            auto encoded = dsize_t{};
+            auto utf8 = std::size_t{};
+            auto unit_size = detail::code_unit_size(m_encoding);
+            detail::for_each_code_point(raw_line_text(line), m_encoding, [&](char32_t cp) {
+                if (utf8 >= bytes) return;
+                utf8 += detail::utf8_size(cp);
+                encoded += static_cast<dsize_t>(unit_size == 1 ? 1 : (cp >= 0x10000 ? 4 : 2));
+            });
+            return start + encoded;
+        }
+
+        /**
+         * @brief Builds a location containing only the lines covered by the marker. Every
+         *        line becomes a single borrowed token.
+         * @param marker absolute span from the start of the source text.
+         */
+        auto location(Span marker) const -> DiagnosticLocation {
+            return location(marker, {}, 0);
+        }
+
+        /**
+         * @brief Builds a location containing only the lines within `context_lines` of the
+         *        marker or any of the spans, e.g. the annotation spans of a diagnostic. The
+         *        rest of the file is never touched, so the cost doesn't depend on its size.
+         *        Lines between two windows are left out.
+         */
+        auto location(Span marker, std::span<Span const> spans, dsize_t context_lines) const -> DiagnosticLocation {
+            auto builder = DiagnosticSourceLocationTokens::builder();
+            if (m_index.empty()) return { filename(), builder.build(), m_encoding == SourceEncoding::UTF8 };
+
+            // Line ranges [first, last] around every span.
+            auto ranges = core::SmallVec<std::pair<dsize_t, dsize_t>, 4>{};
+            auto add_range = [&](Span span) {
+                auto first = m_index.find_line(span.start());
+                auto last = span.empty() ? first : m_index.find_line(span.end() - 1);
+                ranges.push_back({
+                    first - std::min(first - 1, context_lines),
+                    last + std::min(line_count() - last, context_lines)
+                });
+            };
+            add_range(marker);
+            for (auto span: spans) add_range(span);
+            std::sort(ranges.begin(), ranges.end());
+
+            auto marker_line = m_index.find_line(marker.start());
+            auto utf8_marker = utf8_span(marker);
+            auto next = dsize_t{1};
+            for (auto [first, last]: ranges) {
+                for (auto line = std::max(first, next); line <= last; ++line) {
+                    auto start = utf8_line_start(line);
+                    auto text = line_text(line);
+                    // Keeps the newline so that a marker at the end of a line stays visible.
+                    auto end = utf8_line_end(line);
+                    auto s = std::max(utf8_marker.start(), start);
+                    auto e = std::min(utf8_marker.end(), std::max(end, start));
+                    (void)builder.add_text(
+                        core::CowString(text, core::CowString::BorrowedTag{}),
+                        line,
+                        start,
+                        start,
+                        marker.empty()
+                            ? (line == marker_line ? utf8_marker : Span{})
+                            : (s < e ? Span(s, e) : Span{})
+                    );
+                }
+                next = std::max(next, last + 1);
+            }
+            return { filename(), builder.build(), m_encoding == SourceEncoding::UTF8 };
+        }
+    private:
+        friend struct SourceManager;
+
+        auto build_index(SourceEncoding encoding) -> void {
+            // Non-UTF-8 token offsets go up to twice the size; see `utf8_offset`.
+            auto limit = std::numeric_limits<dsize_t>::max() / (encoding == SourceEncoding::UTF8 ? 1 : 2);
+            if (m_text.size() > limit) {
+                throw std::length_error("Source file is too large for dsize_t");
+            }
+            m_encoding = encoding;
+            m_bom = static_cast<dsize_t>(detail::bom_size(m_text, encoding));
+            m_index.build(m_text, encoding);
+        }
+
+        auto column_index(dsize_t line_number) const -> LineColumnIndex const& {
+            {
+                auto lock = std::shared_lock(m_columns_mutex);
+                auto it = m_columns.find(line_number);
+                if (it != m_columns.end()) return it->second;
+            }
+            auto index = LineColumnIndex(line_text(line_number));
+            auto lock = std::unique_lock(m_columns_mutex);
+            auto [it, _] = m_columns.try_emplace(line_number, std::move(index));
+            return it->second;
+        }
+
+        auto transcoded_line(dsize_t line_number) const -> std::string_view {
+            {
+                auto lock = std::shared_lock(m_utf8_mutex);
+                auto it = m_utf8_lines.find(line_number);
+                if (it != m_utf8_lines.end()) return *it->second;
+            }
+            auto text = std::make_unique<std::string const>(transcode_to_utf8(raw_line_text(line_number), m_encoding));
+            auto lock = std::unique_lock(m_utf8_mutex);
+            // Another thread might have transcoded the line in the meantime.
+            auto [it, _] = m_utf8_lines.try_emplace(line_number, std::move(text));
+            return *it->second;
+        }
+    private:
+        std::string m_filename;
+        std::string m_storage;
+        MappedSourceFile m_mapping;
+        std::string_view m_text;
+        LineIndex m_index;
+        FileId m_id{};
+        SourceLocation m_base{};
+        SourceEncoding m_encoding{ SourceEncoding::UTF8 };
+        dsize_t m_bom{};
+        // Lines are only transcoded once and stay at stable addresses since tokens borrow them.
+        mutable std::shared_mutex m_utf8_mutex;
+        mutable std::unordered_map<dsize_t, std::unique_ptr<std::string const>> m_utf8_lines;
+        // Node-based, so the returned references survive later insertions.
+        mutable std::shared_mutex m_columns_mutex;
+        mutable std::unordered_map<dsize_t, LineColumnIndex> m_columns;
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_FILE_HPP
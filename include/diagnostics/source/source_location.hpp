@@ -0,0 +1,51 @@
+#ifndef AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_LOCATION_HPP
+#define AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_LOCATION_HPP
+
+#include "../core/config.hpp"
+#include <compare>
+#include <cstdint>
+
+namespace dark {
+
+    // Index of a file in the `SourceManager`; zero is invalid.
+    struct FileId {
+        dsize_t value{};
+
+        constexpr auto is_valid() const noexcept -> bool { return value != 0; }
+        constexpr explicit operator bool() const noexcept { return is_valid(); }
+        constexpr auto operator<=>(FileId const&) const noexcept = default;
+    };
+
+    /**
+     * @brief Clang-style encoded location. Every file registered in a `SourceManager` owns
+     *        a contiguous range of a global offset space, so a location is a single integer
+     *        and comparing two locations is an integer compare. Locations of different
+     *        files are ordered by registration order.
+     */
+    struct SourceLocation {
+        dsize_t raw{}; // zero is invalid
+
+        constexpr auto is_valid() const noexcept -> bool { return raw != 0; }
+        constexpr explicit operator bool() const noexcept { return is_valid(); }
+        constexpr auto operator<=>(SourceLocation const&) const noexcept = default;
+
+        constexpr auto advance(dsize_t offset) const noexcept -> SourceLocation {
+            return { raw + offset };
+        }
+    };
+
+    // Encoded location with a length; it's the `LocT` for `SourceRangeConverter`.
+    struct SourceRange {
+        SourceLocation start{};
+        dsize_t size{};
+
+        constexpr auto is_valid() const noexcept -> bool { return start.is_valid(); }
+        constexpr auto end() const noexcept -> SourceLocation { return start.advance(size); }
+        constexpr auto operator<=>(SourceRange const&) const noexcept = default;
+    };
+
+    static_assert(sizeof(SourceLocation) == sizeof(dsize_t));
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_LOCATION_HPP
@@ -0,0 +1,174 @@
+#ifndef AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_MANAGER_HPP
+#define AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_MANAGER_HPP
+
+#include "source_file.hpp"
+#include "source_location.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dark {
+
+    /**
+     * @brief Owns the source files of a compilation so that converters can look them up
+     *        by name and diagnostics can borrow their text. Every file gets a `FileId` and
+     *        a range of the encoded location space, so a `SourceLocation` can be decoded
+     *        back to its file and offset.
+     * @note Adding files is not thread-safe; lookups are.
+     */
+    struct SourceManager {
+        SourceManager() = default;
+        SourceManager(SourceManager const&) = delete;
+        SourceManager(SourceManager &&) = delete;
+        SourceManager& operator=(SourceManager const&) = delete;
+        SourceManager& operator=(SourceManager &&) = delete;
+
+        // Adding a file with an existing name makes lookups return the new one.
+        auto add(std::string filename, std::string text, SourceEncoding encoding = SourceEncoding::UTF8) -> SourceFile& {
+            return register_file(m_files.emplace_back(std::move(filename), std::move(text), encoding));
+        }
+
+        // Doesn't copy the text; it must outlive the manager.
+        auto add_borrowed(std::string filename, std::string_view text, SourceEncoding encoding = SourceEncoding::UTF8) -> SourceFile& {
+            return register_file(m_files.emplace_back(std::move(filename), text, SourceFile::BorrowedTag{}, encoding));
+        }
+
+        // Memory-maps the file; throws `std::system_error` if it cannot be mapped.
+        auto add_mapped(std::string path, SourceEncoding encoding = SourceEncoding::UTF8) -> SourceFile& {
+            auto mapping = MappedSourceFile(path);
+            return register_file(m_files.emplace_back(std::move(path), std::move(mapping), encoding));
+        }
+
+        auto find(std::string_view filename) const noexcept -> SourceFile const* {
+            auto it = m_lookup.find(filename);
+            if (it == m_lookup.end()) return nullptr;
+            return &m_files[it->second];
+        }
+
+        auto find_id(std::string_view filename) const noexcept -> FileId {
+            auto const* file = find(filename);
+            return file ? file->id() : FileId{};
+        }
+
+        auto file(FileId id) const noexcept -> SourceFile const& {
+            assert(id.is_valid() && id.value <= m_files.size());
+            return m_files[id.value - 1];
+        }
+
+        auto encode(FileId id, dsize_t offset) const noexcept -> SourceLocation {
+            return file(id).encode(offset);
+        }
+
+        // Returns an invalid id for locations that don't belong to any file.
+        auto decode(SourceLocation loc) const noexcept -> std::pair<FileId, dsize_t> {
+            if (!loc.is_valid() || m_bases.empty()) return {};
+            auto it = std::upper_bound(m_bases.begin(), m_bases.end(), loc.raw);
+            if (it == m_bases.begin()) return {};
+            auto index = static_cast<std::size_t>(it - m_bases.begin()) - 1;
+            auto offset = loc.raw - m_bases[index];
+            if (offset > m_files[index].size()) return {};
+            return { FileId{ static_cast<dsize_t>(index + 1) }, offset };
+        }
+
+        /**
+         * @brief Non-zero key that orders locations like their converted locations, by
+         *        filename and then offset, whereas encoded locations follow the order the
+         *        files were registered in. Zero if the location doesn't belong to any file.
+         * @note Registering a file shifts the keys of the files whose names sort after it,
+         *       so keys are only comparable if every file was registered before them.
+         */
+        auto sort_key(SourceLocation loc) const noexcept -> std::uint64_t {
+            auto [id, offset] = decode(loc);
+            if (!id) return 0;
+            return m_sorted_bases[id.value - 1] + offset;
+        }
+
+        // Builds the location of an encoded range; see `SourceFile::location`.
+        auto location(SourceRange range) const -> DiagnosticLocation {
+            auto [id, offset] = decode(range.start);
+            if (!id) return {};
+            return file(id).location(Span::from_size(offset, range.size));
+        }
+
+        // Position of an encoded location with the column counted in `unit`; see `SourceFile::position`.
+        auto position(SourceLocation loc, ColumnUnit unit) const -> SourcePosition {
+            auto [id, offset] = decode(loc);
+            if (!id) return {};
+            return file(id).position(offset, unit);
+        }
+
+        auto position(SourceRange range, ColumnUnit unit) const -> SourcePositionRange {
+            auto [id, offset] = decode(range.start);
+            if (!id) return {};
+            return file(id).position(Span::from_size(offset, range.size), unit);
+        }
+
+        auto operator[](std::size_t index) const noexcept -> SourceFile const& {
+            assert(index < m_files.size());
+            return m_files[index];
+        }
+
+        auto size() const noexcept -> std::size_t { return m_files.size(); }
+        auto empty() const noexcept -> bool { return m_files.empty(); }
+
+        auto begin() const noexcept { return m_files.begin(); }
+        auto end() const noexcept { return m_files.end(); }
+    private:
+        auto register_file(SourceFile& file) -> SourceFile& {
+            // Every file reserves one extra location for its end.
+            auto needed = static_cast<std::size_t>(file.size()) + 1;
+            if (needed > static_cast<std::size_t>(std::numeric_limits<dsize_t>::max() - m_next_base)) {
+                m_files.pop_back();
+                throw std::length_error("Source manager ran out of encoded locations");
+            }
+
+            file.m_id = FileId{ static_cast<dsize_t>(m_files.size()) };
+            file.m_base = SourceLocation{ m_next_base };
+            m_bases.push_back(m_next_base);
+            m_next_base += static_cast<dsize_t>(needed);
+            m_lookup[file.filename()] = m_files.size() - 1;
+            add_sorted_base(m_files.size() - 1, needed);
+            return file;
+        }
+
+        // Files with the same name keep their registration order.
+        auto add_sorted_base(std::size_t index, std::size_t needed) -> void {
+            auto name = m_files[index].filename();
+            auto pos = std::upper_bound(m_by_name.begin(), m_by_name.end(), name, [this](std::string_view lhs, std::size_t rhs) {
+                return lhs < m_files[rhs].filename();
+            });
+
+            auto base = std::uint64_t{1};
+            if (pos != m_by_name.begin()) {
+                auto prev = *(pos - 1);
+                base = m_sorted_bases[prev] + m_files[prev].size() + 1;
+            }
+            for (auto it = pos; it != m_by_name.end(); ++it) m_sorted_bases[*it] += needed;
+            m_sorted_bases.push_back(base);
+            m_by_name.insert(pos, index);
+        }
+    private:
+        // Deque keeps the files, and the filenames used as keys, at stable addresses.
+        std::deque<SourceFile> m_files;
+        std::unordered_map<std::string_view, std::size_t> m_lookup;
+        // Start of every file's encoded range; zero is never used.
+        std::vector<dsize_t> m_bases;
+        dsize_t m_next_base{1};
+        // Start of every file's key range when the files are laid out by filename.
+        std::vector<std::uint64_t> m_sorted_bases;
+        // File indices ordered by filename.
+        std::vector<std::size_t> m_by_name;
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_SOURCE_SOURCE_MANAGER_HPP
@@ -0,0 +1,139 @@
+#ifndef AMT_DARK_DIAGNOSTICS_SOURCE_TOKEN_LINE_CACHE_HPP
+#define AMT_DARK_DIAGNOSTICS_SOURCE_TOKEN_LINE_CACHE_HPP
+
+#include "../basic.hpp"
+#include "../span.hpp"
+#include "line_index.hpp"
+#include "source_file.hpp"
+#include "source_location.hpp"
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dark {
+
+    /**
+     * @brief Tokenized lines keyed by (file, line) for syntax-highlighting converters.
+     *        A line is tokenized once and every later location that covers it copies
+     *        the cached tokens, which borrow the file text when the tokenizer does.
+     *
+     *        The text of a cached file must therefore stay alive and unchanged while the
+     *        cache or any location built from it is in use, which `SourceFile` guarantees.
+     *        Editable text belongs in a `SourceBuffer`, whose cache owns its tokens.
+     *
+     *        The cache is shared across diagnostics and threads: lookups take a shared
+     *        lock and the tokenizer runs outside of any lock, so it must be reentrant.
+     */
+    struct TokenLineCache {
+        // Appends the tokens of a line to `tokens`; token offsets are relative to the line start.
+        using tokenizer_t = std::function<void(std::string_view line, core::ArenaSmallVec<DiagnosticTokenInfo>& tokens)>;
+
+        explicit TokenLineCache(tokenizer_t tokenizer) noexcept
+            : m_tokenizer(std::move(tokenizer))
+        {}
+
+        TokenLineCache(TokenLineCache const&) = delete;
+        TokenLineCache(TokenLineCache &&) = delete;
+        TokenLineCache& operator=(TokenLineCache const&) = delete;
+        TokenLineCache& operator=(TokenLineCache &&) = delete;
+
+        /**
+         * @brief Tokens of a line with absolute offsets. The line is tokenized on first use.
+         * @param text line text without the line terminator.
+         */
+        auto line(FileId file, dsize_t line_number, std::string_view text, dsize_t line_start_offset) -> DiagnosticLineTokens {
+            assert(file.is_valid() && line_number > 0);
+            {
+                auto lock = std::shared_lock(m_mutex);
+                if (auto const* cached = find(file, line_number)) {
+                    return rebase(*cached, line_number, line_start_offset);
+                }
+            }
+
+            auto tokens = core::ArenaSmallVec<DiagnosticTokenInfo>{};
+            if (m_tokenizer) m_tokenizer(text, tokens);
+            // Empty lines keep a token so that a marker can point at them.
+            if (tokens.empty()) tokens.push_back(DiagnosticTokenInfo{ .text = core::CowString(text, core::CowString::BorrowedTag{}) });
+
+            auto lock = std::unique_lock(m_mutex);
+            auto& lines = m_files[file.value];
+            if (lines.size() < line_number) lines.resize(line_number);
+            auto& cached = lines[line_number - 1];
+            // Another thread might have filled the line in the meantime.
+            if (!cached.valid) {
+                cached.tokens.assign(tokens.begin(), tokens.end());
+                cached.valid = true;
+            }
+            return rebase(cached, line_number, line_start_offset);
+        }
+
+        // The file must be registered in a `SourceManager`.
+        auto line(SourceFile const& file, dsize_t line_number) -> DiagnosticLineTokens {
+            return line(file.id(), line_number, file.line_text(line_number), file.utf8_line_start(line_number));
+        }
+
+        /**
+         * @brief Builds a location containing only the lines covered by the marker.
+         * @param marker absolute span from the start of the source text.
+         */
+        auto location(SourceFile const& file, Span marker) -> DiagnosticLocation {
+            auto tokens = DiagnosticSourceLocationTokens{};
+            auto const& index = file.line_index();
+            auto first = index.find_line(marker.start());
+            auto last = marker.empty() ? first : index.find_line(marker.end() - 1);
+            auto utf8_marker = file.utf8_span(marker);
+            for (auto l = first; l <= last && l != 0; ++l) {
+                auto tokens_of_line = line(file, l);
+                if (!marker.empty()) tokens_of_line.clip_marker(utf8_marker, file.utf8_line_end(l));
+                tokens.lines.push_back(std::move(tokens_of_line));
+            }
+            return { file.filename(), std::move(tokens), file.encoding() == SourceEncoding::UTF8 };
+        }
+
+        // Drops every line of a file, e.g. before its `SourceFile` is destroyed.
+        auto invalidate(FileId file) -> void {
+            auto lock = std::unique_lock(m_mutex);
+            m_files.erase(file.value);
+        }
+
+        auto clear() -> void {
+            auto lock = std::unique_lock(m_mutex);
+            m_files.clear();
+        }
+    private:
+        // Stored on the heap rather than in the arena of the thread that tokenized it.
+        struct CachedLine {
+            std::vector<DiagnosticTokenInfo> tokens{};
+            bool valid{ false };
+        };
+
+        auto find(FileId file, dsize_t line_number) const noexcept -> CachedLine const* {
+            auto it = m_files.find(file.value);
+            if (it == m_files.end() || it->second.size() < line_number) return nullptr;
+            auto const& cached = it->second[line_number - 1];
+            return cached.valid ? &cached : nullptr;
+        }
+
+        static auto rebase(CachedLine const& cached, dsize_t line_number, dsize_t line_start_offset) -> DiagnosticLineTokens {
+            auto line = DiagnosticLineTokens{ .tokens = {}, .line_number = line_number, .line_start_offset = line_start_offset };
+            line.tokens.reserve(cached.tokens.size());
+            for (auto const& tok: cached.tokens) {
+                line.tokens.push_back(tok);
+                line.tokens.back().token_start_offset += line_start_offset;
+            }
+            return line;
+        }
+    private:
+        tokenizer_t m_tokenizer;
+        mutable std::shared_mutex m_mutex;
+        std::unordered_map<dsize_t, std::vector<CachedLine>> m_files;
+    };
+
+} // namespace dark
+
+#endif // AMT_DARK_DIAGNOSTICS_SOURCE_TOKEN_LINE_CACHE_HPP
@@ -14,68 +14,83 @@
 
 namespace dark {
 
-    struct Span {
-        using size_type = dsize_t;
-        constexpr Span() noexcept = default;
-        constexpr Span(Span const&) noexcept = default;
-        constexpr Span(Span &&) noexcept = default;
-        constexpr Span& operator=(Span const&) noexcept = default;
-        constexpr Span& operator=(Span &&) noexcept = default;
-        constexpr ~Span() noexcept = default;
-
-        constexpr Span(size_type start, size_type end) noexcept
+    /**
+     * @brief Half-open range of positions. `Span` holds absolute positions inside a source text,
+     *        while `RelSpan` holds positions relative to a line or the rendered window and stays
+     *        32-bit in the large-file mode.
+     */
+    template <std::unsigned_integral T>
+    struct BasicSpan {
+        using size_type = T;
+        constexpr BasicSpan() noexcept = default;
+        constexpr BasicSpan(BasicSpan const&) noexcept = default;
+        constexpr BasicSpan(BasicSpan &&) noexcept = default;
+        constexpr BasicSpan& operator=(BasicSpan const&) noexcept = default;
+        constexpr BasicSpan& operator=(BasicSpan &&) noexcept = default;
+        constexpr ~BasicSpan() noexcept = default;
+
+        constexpr BasicSpan(size_type start, size_type end) noexcept
             : m_start(start)
             , m_size(std::max(start, end) - start)
         {}
 
-        constexpr Span(size_type start) noexcept
+        constexpr BasicSpan(size_type start) noexcept
             : m_start(start)
             , m_size(1)
         {}
 
+        // Converts between absolute and relative spans; the caller guarantees that the
+        // positions fit into `size_type`.
+        template <std::unsigned_integral U>
+            requires (!std::same_as<T, U>)
+        explicit constexpr BasicSpan(BasicSpan<U> other) noexcept
+            : m_start(static_cast<size_type>(other.start()))
+            , m_size(static_cast<size_type>(other.size()))
+        {}
+
         constexpr auto start() const noexcept -> size_type { return m_start; }
         constexpr auto size() const noexcept -> size_type { return m_size; }
         constexpr auto end() const noexcept -> size_type { return start() + size(); }
         constexpr auto empty() const noexcept -> bool { return size() == 0; }
 
-        static constexpr auto from_size(size_type start, size_type size) noexcept -> Span {
-            return Span(start, start + size);
+        static constexpr auto from_size(size_type start, size_type size) noexcept -> BasicSpan {
+            return BasicSpan(start, start + size);
         }
 
-        constexpr auto shift(std::ptrdiff_t offset) const noexcept -> Span {
+        constexpr auto shift(std::ptrdiff_t offset) const noexcept -> BasicSpan {
             auto s = static_cast<std::ptrdiff_t>(start()) + offset;
             auto e = std::max<std::ptrdiff_t>(s + size(), 0);
-            return Span(
+            return BasicSpan(
                 static_cast<size_type>(std::max<std::ptrdiff_t>(s, 0)),
                 static_cast<size_type>(e)
             );
         }
 
-        template <std::integral T>
-        constexpr auto operator+(T offset) const noexcept -> Span {
+        template <std::integral I>
+        constexpr auto operator+(I offset) const noexcept -> BasicSpan {
             return shift(static_cast<std::ptrdiff_t>(offset));
         }
 
-        template <std::integral T>
-        constexpr auto operator-(T offset) const noexcept -> Span {
+        template <std::integral I>
+        constexpr auto operator-(I offset) const noexcept -> BasicSpan {
             return shift(-static_cast<std::ptrdiff_t>(offset));
         }
 
-        constexpr auto clip_start(size_type start) const noexcept -> Span {
-            return Span(
+        constexpr auto clip_start(size_type start) const noexcept -> BasicSpan {
+            return BasicSpan(
                 std::max(start, this->start()),
                 end()
             );
         }
 
-        constexpr auto clip_end(size_type end) const noexcept -> Span {
-            return Span(
+        constexpr auto clip_end(size_type end) const noexcept -> BasicSpan {
+            return BasicSpan(
                 start(),
                 std::max(end, this->end())
             );
         }
 
-        constexpr auto intersects(Span other, bool inclusice = false) const noexcept -> bool {
+        constexpr auto intersects(BasicSpan other, bool inclusice = false) const noexcept -> bool {
             if (other.empty() || empty()) return false;
             // Case 1: Intersection
             //          [------------)
@@ -100,10 +115,10 @@ namespace dark {
             if (start() > other.start()) {
                 std::swap(lhs, rhs);
             }
-            return rhs.start() < lhs.end() + static_cast<dsize_t>(inclusice);
+            return rhs.start() < lhs.end() + static_cast<size_type>(inclusice);
         }
 
-        auto calculate_intersections(Span other) const noexcept -> core::SmallVec<Span, 3> {
+        auto calculate_intersections(BasicSpan other) const noexcept -> core::SmallVec<BasicSpan, 3> {
             // Case 1: Intersection
             // [-----------)
             //        [---------)
@@ -138,19 +153,19 @@ namespace dark {
             if (lhs == rhs) return { lhs };
 
             if (rhs.end() <= lhs.end()) {
-                auto s1 = Span(lhs.start(), rhs.start());
-                auto s2 = Span(rhs.start(), rhs.end());
-                auto s3 = Span(rhs.end(), lhs.end());
+                auto s1 = BasicSpan(lhs.start(), rhs.start());
+                auto s2 = BasicSpan(rhs.start(), rhs.end());
+                auto s3 = BasicSpan(rhs.end(), lhs.end());
                 return {s1, s2, s3};
             } else {
-                auto s1 = Span(lhs.start(), rhs.start());
-                auto s2 = Span(rhs.start(), lhs.end());
-                auto s3 = Span(lhs.end(), rhs.end());
+                auto s1 = BasicSpan(lhs.start(), rhs.start());
+                auto s2 = BasicSpan(rhs.start(), lhs.end());
+                auto s3 = BasicSpan(lhs.end(), rhs.end());
                 return {s1, s2, s3};
             }
         }
 
-        constexpr auto force_merge(Span other) const noexcept -> Span {
+        constexpr auto force_merge(BasicSpan other) const noexcept -> BasicSpan {
             // Case 1: Intersection
             // [-----------)
             //        [---------)
@@ -165,30 +180,30 @@ namespace dark {
             //       V
             // [------------------------)
 
-            return Span(
+            return BasicSpan(
                 std::min(start(), other.start()),
                 std::max(end(), other.end())
             );
         }
 
-        constexpr auto merge(Span other) const noexcept -> std::optional<Span> {
+        constexpr auto merge(BasicSpan other) const noexcept -> std::optional<BasicSpan> {
             if (!intersects(other)) return {};
             return force_merge(other);
         }
 
-        constexpr auto operator==(Span const& other) const noexcept -> bool = default;
+        constexpr auto operator==(BasicSpan const& other) const noexcept -> bool = default;
 
-        constexpr auto is_between(Span parent, bool inclusive = false) const noexcept -> bool {
-            return parent.start() >= start() && (end() + static_cast<dsize_t>(inclusive)) > parent.end();
+        constexpr auto is_between(BasicSpan parent, bool inclusive = false) const noexcept -> bool {
+            return parent.start() >= start() && (end() + static_cast<size_type>(inclusive)) > parent.end();
         }
 
-        constexpr auto is_between(dsize_t el, bool inclusive = false) const noexcept -> bool {
-            return el >= start() && el < (end() + static_cast<dsize_t>(inclusive));
+        constexpr auto is_between(size_type el, bool inclusive = false) const noexcept -> bool {
+            return el >= start() && el < (end() + static_cast<size_type>(inclusive));
         }
 
-        constexpr auto center() const noexcept -> dsize_t { return start() + size() / 2; }
+        constexpr auto center() const noexcept -> size_type { return start() + size() / 2; }
 
-        friend std::ostream& operator<<(std::ostream& os, Span const& s) {
+        friend std::ostream& operator<<(std::ostream& os, BasicSpan const& s) {
             return os << "Span(start=" << s.start() << ", end=" << s.end() << ", size=" << s.size() << ')';
         }
     private:
@@ -196,6 +211,9 @@ namespace dark {
         size_type m_size{};
     };
 
+    using Span = BasicSpan<dsize_t>;
+    using RelSpan = BasicSpan<doffset_t>;
+
     namespace detail {
         template <typename S>
         concept IsSpan = std::same_as<std::remove_cvref_t<S>, Span>;
@@ -204,8 +222,8 @@ namespace dark {
 } // namespace dark
 
 
-template <>
-struct std::formatter<dark::Span> {
+template <typename T>
+struct std::formatter<dark::BasicSpan<T>> {
     constexpr auto parse(auto& ctx) {
         auto it = ctx.begin();
         while (it != ctx.end()) {
@@ -215,16 +233,16 @@ struct std::formatter<dark::Span> {
         return it;
     }
 
-    auto format(dark::Span const& s, auto& ctx) const {
+    auto format(dark::BasicSpan<T> const& s, auto& ctx) const {
         return std::format_to(ctx.out(), "Span(start={}, end={}, size={})", s.start(), s.end(), s.size());
     }
 };
 
-template <>
-struct std::hash<dark::Span> {
-    constexpr auto operator()(dark::Span const& s) const noexcept -> std::size_t {
-        auto h0 = std::hash<dark::dsize_t>{}(s.start());
-        auto h1 = std::hash<dark::dsize_t>{}(s.size());
+template <typename T>
+struct std::hash<dark::BasicSpan<T>> {
+    constexpr auto operator()(dark::BasicSpan<T> const& s) const noexcept -> std::size_t {
+        auto h0 = std::hash<T>{}(s.start());
+        auto h1 = std::hash<T>{}(s.size());
         return h0 ^ (h1 << 1);
     }
 };
@@ -0,0 +1,107 @@
+#include "diagnostics/core/buffer.hpp"
+#include "diagnostics/core/term/terminal.hpp"
+#include "diagnostics/renderer.hpp"
+#include "mock.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <string_view>
+
+using namespace dark;
+
+TEST_CASE("Buffer", "[buffer]") {
+    SECTION("Construction") {
+        auto buffer = core::Buffer();
+        REQUIRE(buffer.empty());
+        REQUIRE(buffer.capacity() == 0);
+
+        auto reserved = core::Buffer(1000);
+        REQUIRE(reserved.empty());
+        REQUIRE(reserved.capacity() >= 1000);
+    }
+
+    SECTION("Append") {
+        auto buffer = core::Buffer();
+        buffer.append("Hello");
+        buffer.push_back(',');
+        buffer.append(" World");
+        REQUIRE(buffer.view() == "Hello, World");
+        REQUIRE(buffer.size() == 12);
+
+        auto capacity = buffer.capacity();
+        buffer.clear();
+        REQUIRE(buffer.empty());
+        REQUIRE(buffer.capacity() == capacity);
+    }
+
+    SECTION("Growth keeps the contents") {
+        auto buffer = core::Buffer();
+        auto expected = std::string{};
+        for (auto i = 0u; i < 1000; ++i) {
+            buffer.append("abc");
+            expected += "abc";
+        }
+        REQUIRE(buffer.view() == expected);
+    }
+
+    SECTION("Copy and move") {
+        auto buffer = core::Buffer();
+        buffer.append("Test");
+
+        auto copy = buffer;
+        REQUIRE(copy.view() == "Test");
+        REQUIRE(buffer.view() == "Test");
+
+        auto moved = std::move(copy);
+        REQUIRE(moved.view() == "Test");
+        REQUIRE(copy.empty());
+    }
+}
+
+TEST_CASE("Buffer Writer", "[buffer:writer]") {
+    auto make_diagnostic = [] {
+        return Diagnostic{
+            .level = DiagnosticLevel::Error,
+            .kind = DiagnosticKind::InvalidFunctionDefinition,
+            .location = DiagnosticLocation {
+                .filename = "a.cpp",
+                .source = DiagnosticSourceLocationTokens::builder()
+                    .begin_line(1, 0)
+                        .add_token("void", 0, Span(0, 3))
+                        .add_token(" ", 4, Span(4, 4))
+                        .add_token("main", 5, Span(5, 8))
+                    .end_line()
+                    .build()
+            },
+            .message = core::BasicFormatter("Expected {}", "a return type")
+        };
+    };
+
+    auto buffer = core::Buffer();
+    {
+        auto diag = make_diagnostic();
+        auto term = Terminal<core::Buffer>(Writer<core::Buffer>(buffer, 40), TerminalColorMode::Disable);
+        REQUIRE(term.columns() == 40);
+        REQUIRE(!term.colors_enabled());
+        render_diagnostic(term, diag);
+    }
+
+    auto text = std::string{};
+    {
+        auto diag = make_diagnostic();
+        auto term = Terminal<std::string>(Writer<std::string>(text, 40), TerminalColorMode::Disable);
+        render_diagnostic(term, diag);
+    }
+
+    REQUIRE(!buffer.empty());
+    REQUIRE(buffer.view() == text);
+    REQUIRE(buffer.view().find("Expected a return type") != std::string_view::npos);
+    REQUIRE(buffer.view().find('\x1b') == std::string_view::npos);
+
+    SECTION("Colors are enabled explicitly") {
+        auto colored = core::Buffer();
+        auto diag = make_diagnostic();
+        auto term = Terminal<core::Buffer>(Writer<core::Buffer>(colored, 40), TerminalColorMode::Enable);
+        render_diagnostic(term, diag);
+        REQUIRE(colored.view().find('\x1b') != std::string_view::npos);
+    }
+}
@@ -1,13 +1,156 @@
 #include "diagnostics/basic.hpp"
+#include "diagnostics/consumers/async.hpp"
+#include "diagnostics/consumers/dedup.hpp"
 #include "diagnostics/consumers/error_tracking.hpp"
+#include "diagnostics/consumers/json.hpp"
+#include "diagnostics/consumers/parallel.hpp"
+#include "diagnostics/consumers/sarif.hpp"
 #include "diagnostics/consumers/sorting.hpp"
+#include "diagnostics/consumers/stream.hpp"
+#include "diagnostics/executor.hpp"
 #include "mock.hpp"
 #include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 using namespace dark;
 
+namespace {
+    auto make_numbered_diagnostics(unsigned count) -> std::vector<Diagnostic> {
+        auto diagnostics = std::vector<Diagnostic>{};
+        for (auto i = 0u; i < count; ++i) {
+            diagnostics.push_back(Diagnostic{
+                .level = DiagnosticLevel::Error,
+                .kind = DiagnosticKind::InvalidFunctionDefinition,
+                .location = DiagnosticLocation {
+                    .filename = "a.cpp",
+                    .source = DiagnosticSourceLocationTokens::builder()
+                        .begin_line(i + 1, 0)
+                            .add_token("void", 0, Span(0, 3))
+                        .end_line()
+                        .build()
+                },
+                .message = core::BasicFormatter("Diagnostic {}", i)
+            });
+        }
+        return diagnostics;
+    }
+
+    auto read_file(FILE* file) -> std::string {
+        auto text = std::string{};
+        std::rewind(file);
+        char buffer[512];
+        for (auto n = std::size_t{}; (n = std::fread(buffer, 1, sizeof(buffer), file)) != 0;) {
+            text.append(buffer, n);
+        }
+        return text;
+    }
+
+    // Warning with a note, an insertion and a deletion on line 3, which starts at offset 20.
+    auto make_fixit_diagnostic() -> Diagnostic {
+        auto diag = Diagnostic{
+            .level = DiagnosticLevel::Warning,
+            .kind = DiagnosticKind::InvalidFunctionDefinition,
+            .location = DiagnosticLocation {
+                .filename = "a.cpp",
+                .source = DiagnosticSourceLocationTokens::builder()
+                    .begin_line(3, 20)
+                        .add_token("int", 20)
+                        .add_token(" ", 23)
+                        .add_token("x", 24, Span(24, 25))
+                        .add_token(";", 25)
+                    .end_line()
+                    .build()
+            },
+            .message = core::BasicFormatter("unused variable \"{}\"", std::string_view{"x"})
+        };
+        diag.annotations.push_back(DiagnosticMessage{
+            .message = term::AnnotatedString::builder().push("declared here").build(),
+            .spans = { Span(20, 23) },
+            .level = DiagnosticLevel::Note
+        });
+        diag.annotations.push_back(DiagnosticMessage{
+            .message = term::AnnotatedString::builder().push("add attribute").build(),
+            .tokens = DiagnosticSourceLocationTokens::builder()
+                .add_text("[[maybe_unused]] ", 0, 0, 0)
+                .build(),
+            .spans = { Span::from_size(20, 17) },
+            .level = DiagnosticLevel::Insert
+        });
+        diag.annotations.push_back(DiagnosticMessage{
+            .spans = { Span(24, 25) },
+            .level = DiagnosticLevel::Delete
+        });
+        return diag;
+    }
+
+    // Fails on any source text containing "boom", so one diagnostic of a batch can fail to render.
+    struct ThrowingHighlighter: LineHighlighter {
+        auto highlight(std::string_view text, core::ArenaSmallVec<HighlightRange, 16>&) const -> void override {
+            if (text.find("boom") != std::string_view::npos) throw std::runtime_error("highlighter failed");
+        }
+    };
+
+    // Renders the diagnostics through a stream consumer into a temporary file.
+    auto render_to_file(StreamLockMode mode, bool batch) -> std::string {
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        {
+            auto diagnostics = make_numbered_diagnostics(16);
+            auto consumer = StreamDiagnosticConsumer(file, {}, mode);
+            if (batch) {
+                consumer.consume_batch(diagnostics);
+            } else {
+                for (auto& d: diagnostics) consumer.consume(std::move(d));
+            }
+            consumer.flush();
+        }
+        auto text = read_file(file);
+        std::fclose(file);
+        return text;
+    }
+} // namespace
+
 TEST_CASE("Stream Consumer", "[stream_consumer]") {
-    // TODO: Add tests after implementing consume function.
+    auto expected = render_to_file(StreamLockMode::PerDiagnostic, false);
+    REQUIRE(!expected.empty());
+    REQUIRE(render_to_file(StreamLockMode::PerDiagnostic, true) == expected);
+
+    SECTION("Buffered") {
+        REQUIRE(render_to_file(StreamLockMode::Buffered, false) == expected);
+        REQUIRE(render_to_file(StreamLockMode::Buffered, true) == expected);
+    }
+
+    SECTION("Buffered in process") {
+        REQUIRE(render_to_file(StreamLockMode::BufferedInProcess, false) == expected);
+        REQUIRE(render_to_file(StreamLockMode::BufferedInProcess, true) == expected);
+    }
+
+    SECTION("Moving hands over the buffered output exactly once") {
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        {
+            auto diagnostics = make_numbered_diagnostics(16);
+            auto first = StreamDiagnosticConsumer(file, {}, StreamLockMode::Buffered);
+            for (auto i = 0u; i < 8; ++i) first.consume(std::move(diagnostics[i]));
+
+            auto second = StreamDiagnosticConsumer(file, {}, StreamLockMode::Buffered);
+            for (auto i = 8u; i < 16; ++i) second.consume(std::move(diagnostics[i]));
+
+            // `first` writes its own output before taking over `second`'s.
+            first = std::move(second);
+            auto third = std::move(first);
+            third.flush();
+        }
+        REQUIRE(read_file(file) == expected);
+        std::fclose(file);
+    }
 }
 
 TEST_CASE("Error Tracking Consumer", "[error_consumer]") {
@@ -27,6 +170,8 @@ TEST_CASE("Error Tracking Consumer", "[error_consumer]") {
 
         consumer.consume(std::move(diag));
         REQUIRE(consumer.seen_error() == true);
+        REQUIRE(consumer.error_count() == 1);
+        REQUIRE(consumer.warning_count() == 0);
 
         consumer.reset();
         REQUIRE(consumer.seen_error() == false);
@@ -47,8 +192,10 @@ TEST_CASE("Error Tracking Consumer", "[error_consumer]") {
 
         consumer.consume(std::move(diag));
         REQUIRE(consumer.seen_error() == false);
+        REQUIRE(consumer.warning_count() == 1);
 
         consumer.reset();
+        REQUIRE(consumer.warning_count() == 0);
         REQUIRE(consumer.seen_error() == false);
     }
 }
@@ -189,4 +336,440 @@ TEST_CASE("Sorting Consumer", "[sorting_consumer]") {
 
         mock_consumer.clear();
     }
+
+    {
+        // Keys decide the order of the keyed diagnostics, and the ones without a key go
+        // after them rather than making every diagnostic compare converted locations.
+        auto make_keyed = [](std::string_view filename, std::uint64_t key) {
+            return Diagnostic{
+                .level = DiagnosticLevel::Error,
+                .kind = DiagnosticKind::InvalidFunctionDefinition,
+                .location = DiagnosticLocation { .filename = filename },
+                .message = core::BasicFormatter("TEst {}", 3),
+                .location_key = key
+            };
+        };
+
+        auto consumer = SortingDiagnosticConsumer(&mock_consumer);
+        consumer.consume(Diagnostic{
+            .level = DiagnosticLevel::Note,
+            .kind = DiagnosticKind::InvalidFunctionDefinition,
+            .message = core::BasicFormatter("TEst {}", 3)
+        });
+        consumer.consume(make_keyed("b.cpp", 2));
+        consumer.consume(make_keyed("z.cpp", 1));
+        consumer.flush();
+
+        REQUIRE(mock_consumer.diagnostics.size() == 3);
+        REQUIRE(mock_consumer.diagnostics[0].location.filename == "z.cpp");
+        REQUIRE(mock_consumer.diagnostics[1].location.filename == "b.cpp");
+        REQUIRE(mock_consumer.diagnostics[2].level == DiagnosticLevel::Note);
+
+        mock_consumer.clear();
+    }
+
+    {
+        // Without keys, diagnostics that have no location at all still go last.
+        auto consumer = SortingDiagnosticConsumer(&mock_consumer);
+        consumer.consume(Diagnostic{
+            .level = DiagnosticLevel::Note,
+            .kind = DiagnosticKind::InvalidFunctionDefinition,
+            .message = core::BasicFormatter("TEst {}", 3)
+        });
+        consumer.consume(Diagnostic{
+            .level = DiagnosticLevel::Error,
+            .kind = DiagnosticKind::InvalidFunctionDefinition,
+            .location = DiagnosticLocation {
+                .filename = "a.cpp",
+                .source = DiagnosticSourceLocationTokens::builder()
+                    .begin_line(1, 0)
+                        .add_token("void", 10, Span(10, 13))
+                    .end_line()
+                    .build()
+            },
+            .message = core::BasicFormatter("TEst {}", 3)
+        });
+        consumer.flush();
+
+        REQUIRE(mock_consumer.diagnostics.size() == 2);
+        REQUIRE(mock_consumer.diagnostics[0].location.filename == "a.cpp");
+        REQUIRE(mock_consumer.diagnostics[1].level == DiagnosticLevel::Note);
+
+        mock_consumer.clear();
+    }
+}
+
+TEST_CASE("Batch Consume", "[batch_consumer]") {
+    struct BatchConsumer: TestConsumer {
+        std::size_t single_calls{};
+        std::size_t batch_calls{};
+
+        auto consume(Diagnostic&& d) -> void override {
+            ++single_calls;
+            TestConsumer::consume(std::move(d));
+        }
+
+        auto consume_batch(std::span<Diagnostic> diagnostics) -> void override {
+            ++batch_calls;
+            for (auto& d: diagnostics) TestConsumer::consume(std::move(d));
+        }
+    };
+
+    auto make_diagnostic = [](DiagnosticLevel level, std::string_view filename) {
+        return Diagnostic{
+            .level = level,
+            .kind = DiagnosticKind::InvalidFunctionDefinition,
+            .location = DiagnosticLocation {
+                .filename = filename,
+                .source = DiagnosticSourceLocationTokens::builder()
+                    .begin_line(1, 0)
+                        .add_token("void", 10, Span(10, 13))
+                    .end_line()
+                    .build()
+            },
+            .message = core::BasicFormatter("TEst {}", 3)
+        };
+    };
+
+    auto batch_consumer = BatchConsumer();
+    auto error_tracking = ErrorTrackingDiagnosticConsumer(&batch_consumer);
+    auto sorting = SortingDiagnosticConsumer(&error_tracking);
+
+    auto diagnostics = std::vector<Diagnostic>{};
+    diagnostics.push_back(make_diagnostic(DiagnosticLevel::Error, "c.cpp"));
+    diagnostics.push_back(make_diagnostic(DiagnosticLevel::Warning, "a.cpp"));
+    sorting.consume_batch(diagnostics);
+    sorting.consume(make_diagnostic(DiagnosticLevel::Error, "b.cpp"));
+    REQUIRE(batch_consumer.diagnostics.empty());
+
+    sorting.flush();
+
+    // The sorted diagnostics are forwarded through the chain in a single call.
+    REQUIRE(batch_consumer.batch_calls == 1);
+    REQUIRE(batch_consumer.single_calls == 0);
+    REQUIRE(error_tracking.error_count() == 2);
+    REQUIRE(error_tracking.warning_count() == 1);
+    REQUIRE(batch_consumer.diagnostics.size() == 3);
+    REQUIRE(batch_consumer.diagnostics[0].location.filename == "a.cpp");
+    REQUIRE(batch_consumer.diagnostics[1].location.filename == "b.cpp");
+    REQUIRE(batch_consumer.diagnostics[2].location.filename == "c.cpp");
+}
+
+TEST_CASE("Dedup Consumer", "[dedup_consumer]") {
+    auto mock_consumer = TestConsumer();
+    auto consumer = DedupDiagnosticConsumer(&mock_consumer);
+
+    auto make_diagnostic = [](std::string_view filename, unsigned arg, Span marker) {
+        auto diag = Diagnostic{
+            .level = DiagnosticLevel::Error,
+            .kind = DiagnosticKind::InvalidFunctionDefinition,
+            .location = DiagnosticLocation {
+                .filename = filename,
+                .source = DiagnosticSourceLocationTokens::builder()
+                    .begin_line(1, 0)
+                        .add_token("void", 10, marker)
+                    .end_line()
+                    .build()
+            },
+            .message = core::BasicFormatter("Invalid {} at {}", std::string_view{"test"}, arg)
+        };
+        diag.annotations.push_back(DiagnosticMessage{
+            .message = term::AnnotatedString::builder().push("note").build(),
+            .spans = { Span(10, 12) },
+            .level = DiagnosticLevel::Note
+        });
+        return diag;
+    };
+
+    consumer.consume(make_diagnostic("a.cpp", 1, Span(10, 13)));
+    consumer.consume(make_diagnostic("a.cpp", 1, Span(10, 13)));
+    REQUIRE(mock_consumer.diagnostics.size() == 1);
+    REQUIRE(consumer.dropped() == 1);
+
+    // Any structural difference keeps the diagnostic.
+    consumer.consume(make_diagnostic("b.cpp", 1, Span(10, 13)));
+    consumer.consume(make_diagnostic("a.cpp", 2, Span(10, 13)));
+    consumer.consume(make_diagnostic("a.cpp", 1, Span(11, 13)));
+    REQUIRE(mock_consumer.diagnostics.size() == 4);
+
+    auto batch = std::vector<Diagnostic>{};
+    batch.push_back(make_diagnostic("a.cpp", 1, Span(10, 13)));
+    batch.push_back(make_diagnostic("c.cpp", 1, Span(10, 13)));
+    batch.push_back(make_diagnostic("c.cpp", 1, Span(10, 13)));
+    consumer.consume_batch(batch);
+    REQUIRE(mock_consumer.diagnostics.size() == 5);
+    REQUIRE(mock_consumer.diagnostics[4].location.filename == "c.cpp");
+    REQUIRE(consumer.dropped() == 3);
+
+    consumer.reset();
+    consumer.consume(make_diagnostic("a.cpp", 1, Span(10, 13)));
+    REQUIRE(mock_consumer.diagnostics.size() == 6);
+
+    SECTION("Dropped duplicates go back to the pool") {
+        auto pool = DiagnosticPool();
+        consumer.set_pool(&pool);
+        consumer.consume(make_diagnostic("a.cpp", 1, Span(10, 13)));
+        REQUIRE(pool.size() == 1);
+
+        auto duplicates = std::vector<Diagnostic>{};
+        duplicates.push_back(make_diagnostic("a.cpp", 1, Span(10, 13)));
+        duplicates.push_back(make_diagnostic("d.cpp", 1, Span(10, 13)));
+        consumer.consume_batch(duplicates);
+        REQUIRE(pool.size() == 2);
+        REQUIRE(mock_consumer.diagnostics.size() == 7);
+    }
+
+#ifdef DARK_DIAGNOSTICS_LARGE_FILES
+    SECTION("Spans past 4 GiB") {
+        // Packed into one word as `start << 32 | size`, both markers would read as 2^32 + 1.
+        auto const four_gib = dsize_t{1} << 32;
+        consumer.consume(make_diagnostic("a.cpp", 1, Span::from_size(0, four_gib + 1)));
+        consumer.consume(make_diagnostic("a.cpp", 1, Span::from_size(1, 1)));
+        REQUIRE(mock_consumer.diagnostics.size() == 8);
+    }
+#endif
+}
+
+TEST_CASE("Async Consumer", "[async_consumer]") {
+    auto mock_consumer = TestConsumer();
+
+    auto make_diagnostic = [](unsigned arg) {
+        return Diagnostic{
+            .level = DiagnosticLevel::Error,
+            .kind = DiagnosticKind::InvalidFunctionDefinition,
+            .location = DiagnosticLocation {
+                .filename = "a.cpp",
+                .source = DiagnosticSourceLocationTokens::builder()
+                    .begin_line(1, 0)
+                        .add_token("void", 10, Span(10, 13))
+                    .end_line()
+                    .build()
+            },
+            .message = core::BasicFormatter("Diagnostic {}", arg)
+        };
+    };
+
+    auto consumer = AsyncDiagnosticConsumer(&mock_consumer, 2);
+    REQUIRE(consumer.capacity() == 2);
+
+    // The queue holds two diagnostics, so emitting waits for the render thread.
+    for (auto i = 0u; i < 8; ++i) consumer.consume(make_diagnostic(i));
+    consumer.flush();
+    REQUIRE(consumer.pending() == 0);
+    REQUIRE(mock_consumer.diagnostics.size() == 8);
+    for (auto i = 0u; i < 8; ++i) {
+        REQUIRE(mock_consumer.diagnostics[i].message.format().to_borrowed() == std::format("Diagnostic {}", i));
+    }
+
+    auto batch = std::vector<Diagnostic>{};
+    for (auto i = 8u; i < 13; ++i) batch.push_back(make_diagnostic(i));
+    consumer.consume_batch(batch);
+    consumer.flush();
+    REQUIRE(mock_consumer.diagnostics.size() == 13);
+    REQUIRE(mock_consumer.diagnostics[12].message.format().to_borrowed() == "Diagnostic 12");
+}
+
+TEST_CASE("Thread Pool Executor", "[executor]") {
+    auto executor = ThreadPoolExecutor(4);
+    REQUIRE(executor.threads() == 4);
+
+    auto hits = std::vector<std::atomic<unsigned>>(1000);
+    executor.parallel_for(hits.size(), [&hits](std::size_t i) {
+        hits[i].fetch_add(1, std::memory_order_relaxed);
+    });
+    for (auto const& hit: hits) REQUIRE(hit.load() == 1);
+}
+
+TEST_CASE("Parallel Consumer", "[parallel_consumer]") {
+    auto* serial_file = std::tmpfile();
+    auto* parallel_file = std::tmpfile();
+    REQUIRE(serial_file != nullptr);
+    REQUIRE(parallel_file != nullptr);
+
+    {
+        auto diagnostics = make_numbered_diagnostics(64);
+        auto consumer = StreamDiagnosticConsumer(serial_file);
+        consumer.consume_batch(diagnostics);
+        consumer.flush();
+    }
+
+    {
+        auto executor = ThreadPoolExecutor(4);
+        auto diagnostics = make_numbered_diagnostics(64);
+        auto consumer = ParallelDiagnosticConsumer(parallel_file, &executor);
+        consumer.consume(std::move(diagnostics[0]));
+        consumer.consume_batch(std::span(diagnostics).subspan(1));
+        consumer.flush();
+    }
+
+    auto expected = read_file(serial_file);
+    REQUIRE(!expected.empty());
+    REQUIRE(read_file(parallel_file) == expected);
+
+    std::fclose(serial_file);
+    std::fclose(parallel_file);
+}
+
+TEST_CASE("Parallel Consumer Failure", "[parallel_consumer]") {
+    auto highlighter = ThrowingHighlighter{};
+    auto config = DiagnosticRenderConfig{ .highlighter = &highlighter };
+
+    auto* serial_file = std::tmpfile();
+    auto* parallel_file = std::tmpfile();
+    REQUIRE(serial_file != nullptr);
+    REQUIRE(parallel_file != nullptr);
+
+    {
+        auto diagnostics = make_numbered_diagnostics(8);
+        auto consumer = StreamDiagnosticConsumer(serial_file, config);
+        consumer.consume_batch(diagnostics);
+        consumer.flush();
+    }
+    auto prefix = read_file(serial_file);
+    REQUIRE(!prefix.empty());
+
+    {
+        auto executor = ThreadPoolExecutor(4);
+        auto diagnostics = make_numbered_diagnostics(32);
+        diagnostics[8].location.source = DiagnosticSourceLocationTokens::builder()
+            .begin_line(9, 0)
+                .add_token("boom", 0, Span(0, 3))
+            .end_line()
+            .build();
+
+        auto consumer = ParallelDiagnosticConsumer(parallel_file, &executor, config);
+        consumer.consume(std::move(diagnostics[0]));
+        REQUIRE_THROWS(consumer.consume_batch(std::span(diagnostics).subspan(1)));
+
+        // Only the diagnostics before the failed one were written, and nothing of the
+        // failed batch is left behind for the next one.
+        auto retry = make_numbered_diagnostics(8);
+        consumer.consume_batch(retry);
+        consumer.flush();
+    }
+
+    REQUIRE(read_file(parallel_file) == prefix + prefix);
+
+    std::fclose(serial_file);
+    std::fclose(parallel_file);
+}
+
+TEST_CASE("JSON Lines Consumer", "[json_consumer]") {
+    auto* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    {
+        auto consumer = JsonLinesDiagnosticConsumer(file);
+        consumer.consume(make_fixit_diagnostic());
+        auto batch = std::vector<Diagnostic>{};
+        batch.push_back(make_fixit_diagnostic());
+        consumer.consume_batch(batch);
+        consumer.flush();
+    }
+
+    auto line = std::string_view(
+        R"({"level":"warning","kind":1,"code":"W0001","message":"unused variable \"x\"",)"
+        R"("location":{"file":"a.cpp","line":3,"column":5,"span":{"start":24,"end":25,"line":3,"column":5}},)"
+        R"("annotations":[{"level":"note","message":"declared here","spans":[{"start":20,"end":23,"line":3,"column":1}]}],)"
+        R"("fixits":[{"kind":"insert","message":"add attribute","spans":[{"start":20,"end":37,"line":3,"column":1}],"text":"[[maybe_unused]] "},)"
+        R"({"kind":"delete","message":"","spans":[{"start":24,"end":25,"line":3,"column":5}]}]})"
+    );
+    auto expected = std::string(line) + "\n" + std::string(line) + "\n";
+    REQUIRE(read_file(file) == expected);
+    std::fclose(file);
+}
+
+TEST_CASE("JSON Lines Consumer Without Byte Offsets", "[json_consumer]") {
+    auto* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    {
+        auto consumer = JsonLinesDiagnosticConsumer(file);
+        auto diag = Diagnostic{
+            .level = DiagnosticLevel::Error,
+            .kind = DiagnosticKind::InvalidFunctionDefinition,
+            .location = make_fixit_diagnostic().location,
+            .message = core::BasicFormatter("error")
+        };
+        diag.location.has_byte_offsets = false;
+        consumer.consume(std::move(diag));
+    }
+    REQUIRE(read_file(file) ==
+        R"({"level":"error","kind":1,"code":"E0001","message":"error",)"
+        R"("location":{"file":"a.cpp","line":3,"column":5,"span":{"line":3,"column":5}},)"
+        R"("annotations":[],"fixits":[]})" "\n"
+    );
+    std::fclose(file);
+}
+
+TEST_CASE("SARIF Consumer", "[sarif_consumer]") {
+    SECTION("Empty log") {
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        {
+            auto consumer = SarifDiagnosticConsumer(file, "dark");
+        }
+        REQUIRE(read_file(file) ==
+            R"({"version":"2.1.0","$schema":"https://json.schemastore.org/sarif-2.1.0.json",)"
+            R"("runs":[{"tool":{"driver":{"name":"dark"}},"results":[]}]})" "\n"
+        );
+        std::fclose(file);
+    }
+
+    SECTION("Results") {
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        {
+            auto consumer = SarifDiagnosticConsumer(file, "dark", "1.0");
+            consumer.consume(make_fixit_diagnostic());
+            consumer.consume(make_fixit_diagnostic());
+            consumer.flush();
+            REQUIRE(consumer.is_open());
+            consumer.finish();
+            REQUIRE(!consumer.is_open());
+        }
+
+        auto result = std::string_view(
+            R"({"ruleId":"W0001","level":"warning","message":{"text":"unused variable \"x\""},)"
+            R"("locations":[{"physicalLocation":{"artifactLocation":{"uri":"a.cpp"},"region":{"startLine":3,"byteOffset":24,"byteLength":1}}}],)"
+            R"("relatedLocations":[{"id":0,"message":{"text":"declared here"},)"
+            R"("physicalLocation":{"artifactLocation":{"uri":"a.cpp"},"region":{"startLine":3,"byteOffset":20,"byteLength":3}}}],)"
+            R"("fixes":[{"description":{"text":"add attribute"},"artifactChanges":[{"artifactLocation":{"uri":"a.cpp"},)"
+            R"("replacements":[{"deletedRegion":{"byteOffset":20,"byteLength":0},"insertedContent":{"text":"[[maybe_unused]] "}}]}]},)"
+            R"({"artifactChanges":[{"artifactLocation":{"uri":"a.cpp"},"replacements":[{"deletedRegion":{"byteOffset":24,"byteLength":1}}]}]}]})"
+        );
+        auto expected = std::string(
+            R"({"version":"2.1.0","$schema":"https://json.schemastore.org/sarif-2.1.0.json",)"
+            R"("runs":[{"tool":{"driver":{"name":"dark","version":"1.0"}},"results":[)"
+        );
+        expected += result;
+        expected += ",";
+        expected += result;
+        expected += "]}]}\n";
+        REQUIRE(read_file(file) == expected);
+        std::fclose(file);
+    }
+
+    SECTION("Locations without byte offsets") {
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        {
+            auto consumer = SarifDiagnosticConsumer(file, "dark");
+            auto diag = make_fixit_diagnostic();
+            diag.location.has_byte_offsets = false;
+            consumer.consume(std::move(diag));
+            consumer.finish();
+            // Finishing twice doesn't write a second log.
+            consumer.finish();
+        }
+
+        REQUIRE(read_file(file) ==
+            R"({"version":"2.1.0","$schema":"https://json.schemastore.org/sarif-2.1.0.json",)"
+            R"("runs":[{"tool":{"driver":{"name":"dark"}},"results":[)"
+            R"({"ruleId":"W0001","level":"warning","message":{"text":"unused variable \"x\""},)"
+            R"("locations":[{"physicalLocation":{"artifactLocation":{"uri":"a.cpp"},"region":{"startLine":3}}}],)"
+            R"("relatedLocations":[{"id":0,"message":{"text":"declared here"},)"
+            R"("physicalLocation":{"artifactLocation":{"uri":"a.cpp"},"region":{"startLine":3}}}],)"
+            R"("fixes":[]}]}]})" "\n"
+        );
+        std::fclose(file);
+    }
 }
@@ -1,4 +1,5 @@
 #include <catch2/catch_test_macros.hpp>
+#include <string>
 #include <string_view>
 #include "diagnostics/core/cow_string.hpp"
 
@@ -55,4 +56,24 @@ TEST_CASE("Cow String", "[cow_string]") {
             REQUIRE(sv == cs);
         }
     }
+
+    SECTION("Copying an owned string") {
+        // Long enough to live on the heap, so a double free or a dangling copy shows up.
+        auto text = std::string(64, 'x');
+        auto expected = std::string_view(text);
+        auto original = CowString(text);
+        {
+            auto copy = original;
+            REQUIRE(copy.is_owned());
+            REQUIRE(copy == expected);
+            REQUIRE(copy.data() != original.data());
+        }
+        REQUIRE(original.is_owned());
+        REQUIRE(original == expected);
+
+        auto assigned = CowString();
+        assigned = original;
+        REQUIRE(assigned == expected);
+        REQUIRE(original == expected);
+    }
 }
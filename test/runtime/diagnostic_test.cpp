@@ -2,10 +2,19 @@
 #include "diagnostics/basic.hpp"
 #include "mock.hpp"
 #include <catch2/catch_test_macros.hpp>
+#include <array>
 #include <cstring>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
+#if defined(DARK_DIAGNOSTICS_LARGE_FILES) && defined(DARK_OS_UNIX)
+    #include <sys/mman.h>
+#endif
+
 using namespace dark;
 
 TEST_CASE("Diagnostic Builder", "[diagnostic:builder]") {
@@ -361,3 +370,615 @@ TEST_CASE("Tokenized Diagnostic Builder Output", "[tokenized_diagnostic:output]"
         REQUIRE(iter.empty());
     }
 }
+
+TEST_CASE("Concurrent Diagnostic Emitter", "[diagnostic:emitter]") {
+    auto simple_converter = std::make_unique<SimpleConverter>(
+        "void test( int a, int c );",
+        "main.cpp"
+    );
+
+    static constexpr auto InvalidFunctionPrototype = dark_make_diagnostic(
+        DiagnosticKind::InvalidFunctionPrototype,
+        "The prototype is defined here"
+    );
+
+    constexpr auto number_of_threads = 4ul;
+    constexpr auto diagnostics_per_thread = 64ul;
+
+    auto consumer = TestConsumer();
+    {
+        auto emitter = DiagnosticEmitter<Span>(
+            simple_converter.get(),
+            &consumer,
+            DiagnosticEmitterMode::Concurrent
+        );
+        REQUIRE(emitter.is_concurrent());
+
+        auto workers = std::vector<std::thread>{};
+        for (auto t = 0ul; t < number_of_threads; ++t) {
+            workers.emplace_back([&emitter, t] {
+                auto note = [t](builder::DiagnosticBuilder<Span>& b) {
+                    (void)b.begin_annotation()
+                        .note(core::CowString(std::format("worker {}", t), core::CowString::OwnedTag{}))
+                        .end_annotation();
+                };
+                auto scope = DiagnosticAnnotationScope<Span, decltype(note)>(&emitter, note);
+                for (auto i = 0ul; i < diagnostics_per_thread; ++i) {
+                    emitter.warn(Span(0, 3), InvalidFunctionPrototype).emit();
+                }
+            });
+        }
+        for (auto& w: workers) w.join();
+        emitter.drain();
+    }
+
+    REQUIRE(consumer.diagnostics.size() == number_of_threads * diagnostics_per_thread);
+
+    // Every diagnostic only carries the annotation of the thread that emitted it.
+    auto per_worker = std::array<std::size_t, number_of_threads>{};
+    for (auto const& diag: consumer.diagnostics) {
+        REQUIRE(diag.annotations.size() == 1);
+        auto const& message = diag.annotations[0].message.strings;
+        REQUIRE(message.size() == 1);
+        auto text = message[0].first.to_borrowed();
+        REQUIRE(text.starts_with("worker "));
+        auto id = static_cast<std::size_t>(text.back() - '0');
+        REQUIRE(id < number_of_threads);
+        ++per_worker[id];
+    }
+
+    for (auto count: per_worker) REQUIRE(count == diagnostics_per_thread);
+}
+
+namespace {
+    // Overwrites the stack below the caller before emitting, so an annotation that
+    // references a dead frame no longer finds its callable.
+    [[gnu::noinline]] auto emit_from_deeper_frame(DiagnosticEmitter<Span>& emitter, std::size_t count) -> void {
+        static constexpr auto InvalidFunctionPrototype = dark_make_diagnostic(
+            DiagnosticKind::InvalidFunctionPrototype,
+            "The prototype is defined here"
+        );
+
+        volatile char scratch[4096];
+        for (auto& c: scratch) c = static_cast<char>(0xAB);
+        for (auto i = std::size_t{}; i < count; ++i) {
+            emitter.warn(Span(0, 3), InvalidFunctionPrototype).emit();
+        }
+    }
+} // namespace
+
+TEST_CASE("Concurrent Annotation Scope From Another Frame", "[diagnostic:emitter]") {
+    static_assert(core::detail::is_function_ref<core::FunctionRef<void()>&>);
+
+    auto simple_converter = std::make_unique<SimpleConverter>(
+        "void test( int a, int c );",
+        "main.cpp"
+    );
+
+    auto consumer = TestConsumer();
+    {
+        auto emitter = DiagnosticEmitter<Span>(
+            simple_converter.get(),
+            &consumer,
+            DiagnosticEmitterMode::Concurrent
+        );
+
+        auto note = [](builder::DiagnosticBuilder<Span>& b) {
+            (void)b.begin_annotation().note("scoped note").end_annotation();
+        };
+        auto scope = DiagnosticAnnotationScope<Span, decltype(note)>(&emitter, note);
+        emit_from_deeper_frame(emitter, 4);
+        emitter.drain();
+    }
+
+    REQUIRE(consumer.diagnostics.size() == 4);
+    for (auto const& diag: consumer.diagnostics) {
+        REQUIRE(diag.annotations.size() == 1);
+        REQUIRE(diag.annotations[0].message.strings[0].first.to_borrowed() == "scoped note");
+    }
+}
+
+TEST_CASE("Diagnostic Arena", "[diagnostic:arena]") {
+    auto simple_converter = std::make_unique<SimpleConverter>(
+        "void test( int a, int c );",
+        "main.cpp"
+    );
+    auto mock = Mock(simple_converter.get());
+    auto arena = DiagnosticArena();
+    mock.emitter.set_arena(&arena);
+
+    static constexpr auto InvalidFunctionPrototype = dark_make_diagnostic(
+        DiagnosticKind::InvalidFunctionPrototype,
+        "The prototype is defined here"
+    );
+
+    mock.emitter
+        .error(Span(0, 3), InvalidFunctionPrototype)
+        .begin_annotation()
+            .insert(")", 2)
+            .remove(Span(4, 8))
+            .warn(Span(6, 10), Span(25, 27))
+            .note("Try to fix the error")
+        .end_annotation()
+        .emit();
+
+    // The annotations spilled out of the inline storage, so they must live in the arena.
+    REQUIRE(mock.diagnostics().size() == 1);
+    auto const& diag = mock.diagnostics()[0];
+    REQUIRE(diag.annotations.size() == 4);
+    REQUIRE(arena.capacity() > 0);
+    REQUIRE(arena.owns(diag.annotations.data()));
+    REQUIRE(core::Arena::current() == nullptr);
+
+    // The arena is only installed while a builder allocates, so builders can end in any
+    // order and code running between their calls doesn't allocate from it.
+    {
+        auto first = mock.emitter.error(Span(0, 3), InvalidFunctionPrototype);
+        auto second = mock.emitter.warn(Span(4, 8), InvalidFunctionPrototype);
+        REQUIRE(core::Arena::current() == nullptr);
+        auto unrelated = core::ArenaSmallVec<int, 1>{ 1, 2, 3 };
+        REQUIRE(!arena.owns(unrelated.data()));
+        first.emit();
+        second.emit();
+    }
+    REQUIRE(core::Arena::current() == nullptr);
+    REQUIRE(mock.diagnostics().size() == 3);
+
+    mock.clear();
+    mock.emitter.set_arena(nullptr);
+    arena.reset();
+
+    // Nothing is allocated from the arena once it is detached.
+    auto ptr = core::ArenaAllocator<int>().allocate(4);
+    REQUIRE(!arena.owns(ptr));
+    core::ArenaAllocator<int>().deallocate(ptr, 4);
+}
+
+TEST_CASE("Deferred Location Conversion", "[diagnostic:deferred]") {
+    struct CountingConverter: SimpleConverter {
+        using SimpleConverter::SimpleConverter;
+        mutable std::size_t conversions{};
+
+        auto supports_deferred_conversion() const noexcept -> bool override { return true; }
+
+        auto convert_deferred_loc(loc_t loc) const -> DiagnosticLocation override {
+            ++conversions;
+            return DiagnosticLocation::from_text(filename, source, 1, 0, loc.start(), loc);
+        }
+    };
+
+    // The location is stored inline, so deferring doesn't allocate.
+    static_assert(IsDeferrableLocation<Span>);
+    static_assert(std::is_trivially_copyable_v<DeferredLocation>);
+
+    auto converter = CountingConverter("void test( int a, int c );", "main.cpp");
+    auto mock = Mock(&converter);
+    mock.emitter.defer_location_conversion();
+
+    static constexpr auto InvalidFunctionPrototype = dark_make_diagnostic(
+        DiagnosticKind::InvalidFunctionPrototype,
+        "The prototype is defined here"
+    );
+
+    mock.emitter
+        .error(Span(1, 4), InvalidFunctionPrototype)
+        .begin_annotation()
+            .error("explicit span", Span(5, 9))
+        .end_annotation()
+        .emit();
+
+    // Nothing has looked at the location yet.
+    REQUIRE(converter.conversions == 0);
+    REQUIRE(mock.consumer.diagnostics.size() == 1);
+
+    auto& diag = mock.consumer.diagnostics[0];
+    REQUIRE(diag.has_deferred_location());
+    REQUIRE(diag.location.filename.empty());
+
+    auto& location = diag.resolve_location();
+    REQUIRE(converter.conversions == 1);
+    REQUIRE(!diag.has_deferred_location());
+    REQUIRE(location.filename == "main.cpp");
+    REQUIRE(location.line_info() == std::make_pair(dsize_t{1}, dsize_t{2}));
+
+    (void)diag.resolve_location();
+    REQUIRE(converter.conversions == 1);
+}
+
+TEST_CASE("Diagnostic Filter", "[diagnostic:filter]") {
+    struct FileConverter: SimpleConverter {
+        using SimpleConverter::SimpleConverter;
+        mutable std::size_t conversions{};
+
+        auto convert_loc(loc_t loc, builder_t& builder) const -> DiagnosticLocation override {
+            ++conversions;
+            return SimpleConverter::convert_loc(loc, builder);
+        }
+
+        auto source_filename(loc_t /*loc*/) const -> std::string_view override {
+            return filename;
+        }
+    };
+
+    auto converter = FileConverter("void test( int a, int c );", "src/vendor/main.cpp");
+    auto mock = Mock(&converter);
+
+    static constexpr auto InvalidFunctionDefinition = dark_make_diagnostic(
+        DiagnosticKind::InvalidFunctionDefinition,
+        "Invalid function definition for {}",
+        std::string_view
+    );
+
+    static constexpr auto InvalidFunctionPrototype = dark_make_diagnostic(
+        DiagnosticKind::InvalidFunctionPrototype,
+        "The prototype is defined here"
+    );
+
+    SECTION("Kind and level rules") {
+        mock.emitter.filter()
+            .disable_kind(DiagnosticKind::InvalidFunctionPrototype)
+            .disable(DiagnosticLevel::Warning);
+
+        REQUIRE(!mock.emitter.filter().is_kind_enabled(DiagnosticKind::InvalidFunctionPrototype));
+        REQUIRE(mock.emitter.filter().is_kind_enabled(DiagnosticKind::InvalidFunctionDefinition));
+
+        auto builder = mock.emitter.error(Span(1, 4), InvalidFunctionPrototype);
+        REQUIRE(!builder.is_enabled());
+        builder
+            .begin_annotation()
+                .note("dropped", Span(5, 9))
+            .end_annotation()
+            .emit();
+
+        mock.emitter.warn(Span(1, 4), InvalidFunctionDefinition, std::string_view{"test"}).emit();
+        REQUIRE(mock.diagnostics().empty());
+        REQUIRE(converter.conversions == 0);
+
+        mock.emitter.error(Span(1, 4), InvalidFunctionDefinition, std::string_view{"test"}).emit();
+        REQUIRE(mock.diagnostics().size() == 1);
+        REQUIRE(converter.conversions == 1);
+
+        mock.emitter.filter().enable_kind(DiagnosticKind::InvalidFunctionPrototype);
+        mock.emitter.error(Span(1, 4), InvalidFunctionPrototype).emit();
+        REQUIRE(mock.diagnostics().size() == 2);
+    }
+
+    SECTION("Sparse kinds") {
+        auto filter = DiagnosticFilter();
+        filter.disable_kind(DiagnosticFilter::max_dense_kind + 10);
+        REQUIRE(!filter.is_kind_enabled(DiagnosticFilter::max_dense_kind + 10));
+        REQUIRE(filter.is_kind_enabled(DiagnosticFilter::max_dense_kind + 11));
+        filter.enable_kind(DiagnosticFilter::max_dense_kind + 10);
+        REQUIRE(filter.is_kind_enabled(DiagnosticFilter::max_dense_kind + 10));
+    }
+
+    SECTION("File rules") {
+        mock.emitter.filter().disable_file("src/vendor/");
+        mock.emitter.error(Span(1, 4), InvalidFunctionPrototype).emit();
+        REQUIRE(mock.diagnostics().empty());
+
+        // The last matching rule wins.
+        mock.emitter.filter().enable_file("src/vendor/main");
+        mock.emitter.error(Span(1, 4), InvalidFunctionPrototype).emit();
+        REQUIRE(mock.diagnostics().size() == 1);
+
+        mock.emitter.filter().reset();
+        REQUIRE(!mock.emitter.filter().has_file_rules());
+    }
+}
+
+TEST_CASE("Diagnostic Limits", "[diagnostic:limits]") {
+    auto simple_converter = std::make_unique<SimpleConverter>(
+        "void test( int a, int c );",
+        "main.cpp"
+    );
+    auto mock = Mock(simple_converter.get());
+
+    static constexpr auto InvalidFunctionDefinition = dark_make_diagnostic(
+        DiagnosticKind::InvalidFunctionDefinition,
+        "Invalid function definition"
+    );
+
+    static constexpr auto InvalidFunctionPrototype = dark_make_diagnostic(
+        DiagnosticKind::InvalidFunctionPrototype,
+        "The prototype is defined here"
+    );
+
+    SECTION("Kind limit") {
+        mock.emitter.limits().set_kind_limit(DiagnosticKind::InvalidFunctionPrototype, 2);
+        for (auto i = 0; i < 5; ++i) {
+            mock.emitter.warn(Span(1, 4), InvalidFunctionPrototype).emit();
+        }
+        mock.emitter.warn(Span(1, 4), InvalidFunctionDefinition).emit();
+
+        REQUIRE(mock.diagnostics().size() == 3);
+        REQUIRE(mock.emitter.limits().suppressed(DiagnosticKind::InvalidFunctionPrototype) == 3);
+
+        mock.emitter.flush();
+        REQUIRE(mock.diagnostics().size() == 4);
+        auto const& summary = mock.diagnostics()[3];
+        REQUIRE(summary.level == DiagnosticLevel::Note);
+        REQUIRE(summary.kind == DiagnosticKind::InvalidFunctionPrototype);
+        REQUIRE(summary.message.format().to_borrowed() == "3 further diagnostics of kind W0002 suppressed");
+        REQUIRE(mock.emitter.limits().suppressed(DiagnosticKind::InvalidFunctionPrototype) == 0);
+    }
+
+    SECTION("Error limit") {
+        mock.emitter.limits().set_error_limit(2);
+        for (auto i = 0; i < 4; ++i) {
+            mock.emitter.error(Span(1, 4), InvalidFunctionDefinition).emit();
+        }
+        mock.emitter.warn(Span(1, 4), InvalidFunctionPrototype).emit();
+
+        REQUIRE(mock.diagnostics().size() == 2);
+        REQUIRE(mock.emitter.limits().error_limit_reached());
+        REQUIRE(mock.emitter.limits().suppressed_by_error_limit() == 3);
+
+        mock.emitter.flush();
+        REQUIRE(mock.diagnostics().size() == 3);
+        REQUIRE(mock.diagnostics()[2].message.format().to_borrowed() == "too many errors emitted; 3 further diagnostics suppressed");
+    }
+
+    SECTION("Rejected diagnostics don't use up the other caps") {
+        struct FileConverter: SimpleConverter {
+            using SimpleConverter::SimpleConverter;
+
+            auto source_filename(loc_t /*loc*/) const -> std::string_view override {
+                return filename;
+            }
+        };
+
+        auto converter = FileConverter("void test( int a, int c );", "a.cpp");
+        auto file_mock = Mock(&converter);
+        file_mock.emitter.limits()
+            .set_kind_limit(DiagnosticKind::InvalidFunctionPrototype, 2)
+            .set_kind_file_limit(DiagnosticKind::InvalidFunctionPrototype, 1);
+
+        file_mock.emitter.warn(Span(1, 4), InvalidFunctionPrototype).emit();
+        // Rejected by the per-file cap, so it isn't counted against the kind cap.
+        file_mock.emitter.warn(Span(1, 4), InvalidFunctionPrototype).emit();
+        converter.filename = "b.cpp";
+        file_mock.emitter.warn(Span(1, 4), InvalidFunctionPrototype).emit();
+        converter.filename = "c.cpp";
+        file_mock.emitter.warn(Span(1, 4), InvalidFunctionPrototype).emit();
+
+        REQUIRE(file_mock.diagnostics().size() == 2);
+        REQUIRE(file_mock.emitter.limits().suppressed(DiagnosticKind::InvalidFunctionPrototype) == 2);
+    }
+
+    SECTION("A concurrent emitter hands the summary over in a batch") {
+        struct BatchConsumer: TestConsumer {
+            std::size_t single_calls{};
+
+            auto consume(Diagnostic&& d) -> void override {
+                ++single_calls;
+                TestConsumer::consume(std::move(d));
+            }
+
+            auto consume_batch(std::span<Diagnostic> diagnostics) -> void override {
+                for (auto& d: diagnostics) TestConsumer::consume(std::move(d));
+            }
+        };
+
+        auto consumer = BatchConsumer();
+        auto emitter = DiagnosticEmitter<Span>(
+            simple_converter.get(),
+            &consumer,
+            DiagnosticEmitterMode::Concurrent
+        );
+        emitter.limits().set_kind_limit(DiagnosticKind::InvalidFunctionPrototype, 1);
+        for (auto i = 0; i < 3; ++i) {
+            emitter.error(Span(1, 4), InvalidFunctionPrototype).emit();
+        }
+        emitter.flush();
+
+        REQUIRE(consumer.single_calls == 0);
+        REQUIRE(consumer.diagnostics.size() == 2);
+        REQUIRE(consumer.diagnostics[1].message.format().to_borrowed() == "2 further diagnostics of kind E0002 suppressed");
+    }
+}
+
+namespace {
+    constexpr auto test_catalog = make_diagnostic_catalog(
+        DiagnosticCatalogEntry {
+            .kind = DiagnosticKind::InvalidFunctionDefinition,
+            .code = "bad-definition",
+            .level = DiagnosticLevel::Error,
+            .enabled = true,
+            .format = "Invalid function definition for {}"
+        },
+        DiagnosticCatalogEntry {
+            .kind = DiagnosticKind::InvalidFunctionPrototype,
+            .code = "bad-prototype",
+            .level = DiagnosticLevel::Warning,
+            .enabled = false,
+            .format = "The prototype is defined here"
+        }
+    );
+} // namespace
+
+TEST_CASE("Diagnostic Catalog", "[diagnostic:catalog]") {
+    static_assert(test_catalog.is_dense());
+    static_assert(test_catalog.find(DiagnosticKind::InvalidFunctionPrototype)->code == "bad-prototype");
+    static_assert(test_catalog.find(100) == nullptr);
+
+    static constexpr auto InvalidFunctionDefinition = dark_make_catalog_diagnostic(
+        test_catalog,
+        DiagnosticKind::InvalidFunctionDefinition,
+        std::string_view
+    );
+
+    static constexpr auto InvalidFunctionPrototype = dark_make_catalog_diagnostic(
+        test_catalog,
+        DiagnosticKind::InvalidFunctionPrototype
+    );
+
+    auto simple_converter = std::make_unique<SimpleConverter>(
+        "void test( int a, int c );",
+        "main.cpp"
+    );
+    auto mock = Mock(simple_converter.get());
+    test_catalog.view().apply_defaults(mock.emitter.filter());
+
+    mock.emitter.warn(Span(1, 4), InvalidFunctionPrototype).emit();
+    mock.emitter.error(Span(1, 4), InvalidFunctionDefinition, std::string_view{"test"}).emit();
+    REQUIRE(mock.diagnostics().size() == 1);
+
+    auto& consumer = mock.consumer;
+    render_diagnostic(consumer.term, consumer.diagnostics[0], { .catalog = test_catalog.view() });
+
+    auto iter = mock.line_iter();
+    REQUIRE(iter.next() == "Error[bad-definition]: Invalid function definition for test");
+
+    // `report` takes the level from the catalog.
+    mock.emitter.set_catalog(test_catalog.view());
+    mock.emitter.filter().enable_kind(DiagnosticKind::InvalidFunctionPrototype);
+    mock.emitter.report(Span(1, 4), InvalidFunctionPrototype).emit();
+    mock.emitter.report(Span(1, 4), InvalidFunctionDefinition, std::string_view{"test"}).emit();
+    REQUIRE(mock.diagnostics().size() == 3);
+    REQUIRE(mock.diagnostics()[1].level == DiagnosticLevel::Warning);
+    REQUIRE(mock.diagnostics()[2].level == DiagnosticLevel::Error);
+}
+
+TEST_CASE("Diagnostic Pool", "[diagnostic:pool]") {
+    auto simple_converter = std::make_unique<SimpleConverter>(
+        "void test( int a, int c );",
+        "main.cpp"
+    );
+    auto mock = Mock(simple_converter.get());
+
+    static constexpr auto InvalidFunctionPrototype = dark_make_diagnostic(
+        DiagnosticKind::InvalidFunctionPrototype,
+        "The prototype is defined here"
+    );
+
+    auto emit = [&mock] {
+        mock.emitter
+            .error(Span(0, 3), InvalidFunctionPrototype)
+            .begin_annotation()
+                .insert(")", 2)
+                .remove(Span(4, 8))
+                .warn(Span(6, 10), Span(25, 27))
+                .note("Try to fix the error")
+            .end_annotation()
+            .emit();
+    };
+
+    emit();
+    REQUIRE(mock.consumer.diagnostics.size() == 1);
+
+    auto& pool = mock.emitter.pool();
+    auto* annotations = mock.consumer.diagnostics[0].annotations.data();
+    // Two spans don't fit the inline storage of the warning's span list.
+    auto* warning_spans = mock.consumer.diagnostics[0].annotations[2].spans.data();
+    pool.release(std::move(mock.consumer.diagnostics[0]));
+    mock.clear();
+    REQUIRE(pool.size() == 1);
+
+    // The next diagnostic reuses the annotation storage of the recycled one.
+    emit();
+    REQUIRE(pool.size() == 0);
+    REQUIRE(mock.consumer.diagnostics.size() == 1);
+    auto const& diag = mock.consumer.diagnostics[0];
+    REQUIRE(diag.annotations.size() == 4);
+    REQUIRE(diag.annotations.data() == annotations);
+    REQUIRE(diag.annotations[2].spans.data() == warning_spans);
+    REQUIRE(diag.annotations[2].spans.size() == 2);
+    REQUIRE(diag.message.format().to_borrowed() == "The prototype is defined here");
+
+    SECTION("Cleared diagnostics keep their capacity") {
+        auto recycled = Diagnostic{};
+        for (auto i = 0; i < 4; ++i) recycled.annotations.emplace_back();
+        auto capacity = recycled.annotations.capacity();
+        recycled.clear();
+        REQUIRE(recycled.annotations.empty());
+        REQUIRE(recycled.annotations.capacity() == capacity);
+    }
+
+    SECTION("Released annotations keep their storage") {
+        auto recycled = Diagnostic{};
+        recycled.annotations.push_back(DiagnosticMessage{ .spans = { Span(0, 1), Span(2, 3) } });
+        auto* spans = recycled.annotations[0].spans.data();
+        pool.release(std::move(recycled));
+
+        auto message = pool.acquire_message();
+        REQUIRE(message.spans.empty());
+        REQUIRE(message.spans.data() == spans);
+        REQUIRE(message.spans.capacity() >= 2);
+    }
+}
+
+TEST_CASE("Diagnostic Rebase", "[diagnostic:rebase]") {
+    auto diag = Diagnostic{};
+    diag.location = DiagnosticLocation::from_text("main.cpp", "int x = 0;", 3, 1000, 1000, Span(1004, 1005));
+
+    auto annotation = DiagnosticMessage{ .level = DiagnosticLevel::Note };
+    annotation.spans.push_back(Span(1008, 1009));
+    annotation.spans.push_back(Span(10, 12));
+    diag.annotations.push_back(std::move(annotation));
+
+    internal::rebase_diagnostic(diag);
+
+    // Positions are relative to the first line while line numbers and columns are kept.
+    auto const& line = diag.location.source.lines[0];
+    REQUIRE(line.line_number == 3);
+    REQUIRE(line.line_start_offset == 0);
+    REQUIRE(line.tokens[0].token_start_offset == 0);
+    REQUIRE(line.tokens[0].marker == Span(4, 5));
+    REQUIRE(diag.location.line_info() == std::make_pair(dsize_t{3}, dsize_t{5}));
+    REQUIRE(diag.annotations[0].spans[0] == Span(8, 9));
+    REQUIRE(diag.annotations[0].spans[1].empty());
+}
+
+#ifdef DARK_DIAGNOSTICS_LARGE_FILES
+TEST_CASE("Diagnostic Rebase Past 4 GiB", "[diagnostic:rebase]") {
+    auto base = dsize_t{5'000'000'000};
+    auto diag = Diagnostic{};
+    diag.location = DiagnosticLocation::from_text("main.cpp", "int x = 0;", 3, base, base, Span(base + 4, base + 5));
+
+    internal::rebase_diagnostic(diag);
+
+    auto const& line = diag.location.source.lines[0];
+    REQUIRE(line.line_start_offset == 0);
+    REQUIRE(line.tokens[0].marker == Span(4, 5));
+    REQUIRE(diag.location.line_info() == std::make_pair(dsize_t{3}, dsize_t{5}));
+}
+
+#ifdef DARK_OS_UNIX
+TEST_CASE("Rendering A Whole File Past 4 GiB", "[diagnostic:rebase]") {
+    // Untouched pages of an anonymous mapping read as zeros without taking up memory,
+    // so only the page holding the marked line is backed.
+    auto const line_start = std::size_t{5'000'000'000};
+    auto const tail = std::string_view("\n\n\n\n\n\n\n\nint x = 1;\n");
+    auto const size = line_start - 8 + tail.size();
+    auto* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    REQUIRE(data != MAP_FAILED);
+    auto* text = static_cast<char*>(data);
+    std::memcpy(text + line_start - 8, tail.data(), tail.size());
+
+    // The token starts at zero, so only windowing brings the marker near the base.
+    auto diag = Diagnostic{
+        .level = DiagnosticLevel::Error,
+        .location = DiagnosticLocation::from_text(
+            "large.cpp",
+            std::string_view(text, size),
+            1, 0, 0,
+            Span::from_size(line_start + 4, 1)
+        ),
+        .message = core::BasicFormatter("unused variable")
+    };
+
+    auto out = std::string{};
+    {
+        auto term = Terminal<std::string>(Writer<std::string>(out, 80), TerminalColorMode::Disable);
+        render_diagnostic(term, diag);
+    }
+    ::munmap(data, size);
+
+    REQUIRE(out.find("unused variable") != std::string::npos);
+    REQUIRE(out.find("[large.cpp:9:5]") != std::string::npos);
+    REQUIRE(out.find("9 |") != std::string::npos);
+    REQUIRE(out.find("int x = 1;") != std::string::npos);
+}
+#endif
+#endif
@@ -65,3 +65,40 @@ TEST_CASE("Formatter", "[formatter:custom_formatter]") {
         REQUIRE(f.format().to_borrowed() == "Formatter with 3 number of args.");
     }
 }
+
+TEST_CASE("Formatter", "[formatter:precompiled]") {
+    SECTION("Format string is split at compile time") {
+        static constexpr auto fmt = format_string<int, int>("a {{{}}} b {:>4}.");
+        static_assert(fmt.segments().size() == 5);
+        static_assert(fmt.segments()[1].arg == 0);
+        static_assert(fmt.segments()[3].arg == 1);
+        static_assert(fmt.segments()[4].arg == FormatSegment::no_arg);
+
+        auto f = BasicFormatter(fmt, 1, 42);
+        REQUIRE(f.format().to_borrowed() == "a {1} b   42.");
+        auto out = std::string("> ");
+        f.format_to(out);
+        REQUIRE(out == "> a {1} b   42.");
+
+        auto moved = BasicFormatter();
+        moved.assign(std::move(f));
+        REQUIRE(moved.format().to_borrowed() == "a {1} b   42.");
+        REQUIRE(f.empty());
+
+        // The table is copied, so the formatter outlives a temporary format.
+        auto temporary = BasicFormatter();
+        {
+            auto local = format_string<int, int>("a {{{}}} b {:>4}.");
+            temporary = BasicFormatter(local, 1, 42);
+        }
+        REQUIRE(temporary.format().to_borrowed() == "a {1} b   42.");
+    }
+
+    SECTION("Falls back to vformat") {
+        constexpr auto fmt = format_string<int, int>("{1:>3}{0}");
+        static_assert(fmt.segments().empty());
+
+        auto f = BasicFormatter("{1:>3}{0}", 1, 2);
+        REQUIRE(f.format().to_borrowed() == "  21");
+    }
+}
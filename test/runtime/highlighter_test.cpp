@@ -0,0 +1,50 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string_view>
+#include "diagnostics/highlighter.hpp"
+#include "diagnostics/renderer.hpp"
+
+using namespace dark;
+
+TEST_CASE("C-like Highlighter", "[highlighter]") {
+    auto highlighter = CLikeHighlighter();
+    auto ranges = core::ArenaSmallVec<HighlightRange, 16>{};
+
+    SECTION("Lexing") {
+        highlighter.highlight("int x = 0x1F + \"a\\\"b\"; // done", ranges);
+        REQUIRE(ranges.size() == 4);
+        REQUIRE(ranges[0].span == RelSpan(0, 3));
+        REQUIRE(ranges[0].text_color == Color::Blue);
+        REQUIRE(ranges[1].span == RelSpan(8, 12));
+        REQUIRE(ranges[1].text_color == Color::Cyan);
+        REQUIRE(ranges[2].span == RelSpan(15, 21));
+        REQUIRE(ranges[2].text_color == Color::Green);
+        REQUIRE(ranges[3].span == RelSpan(23, 30));
+        REQUIRE(ranges[3].italic);
+    }
+
+    SECTION("Preprocessor and block comments") {
+        highlighter.highlight("  # include /* x */ <a>", ranges);
+        REQUIRE(ranges.size() == 2);
+        REQUIRE(ranges[0].span == RelSpan(2, 11));
+        REQUIRE(ranges[1].span == RelSpan(12, 19));
+    }
+
+    SECTION("Splitting a plain token keeps the marker") {
+        auto line = DiagnosticLineTokens{ .tokens = {}, .line_number = 1, .line_start_offset = 10 };
+        line.tokens.push_back(DiagnosticTokenInfo{
+            .text = core::CowString(std::string_view("return x;"), core::CowString::BorrowedTag{}),
+            .token_start_offset = 10,
+            .marker = Span(15, 20)
+        });
+
+        internal::highlight_line(line, highlighter);
+        REQUIRE(line.tokens.size() == 2);
+        REQUIRE(line.tokens[0].text.to_borrowed() == "return");
+        REQUIRE(line.tokens[0].text_color == Color::Blue);
+        REQUIRE(line.tokens[0].marker == Span(15, 16));
+        REQUIRE(line.tokens[1].text.to_borrowed() == " x;");
+        REQUIRE(line.tokens[1].token_start_offset == 16);
+        REQUIRE(line.tokens[1].marker == Span(16, 20));
+        REQUIRE(line.tokens[1].text.is_borrowed());
+    }
+}
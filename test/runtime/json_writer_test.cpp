@@ -0,0 +1,64 @@
+#include "diagnostics/core/buffer.hpp"
+#include "diagnostics/core/json_writer.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string_view>
+
+using namespace dark::core;
+
+TEST_CASE("Json Writer", "[json_writer]") {
+    auto buffer = Buffer();
+    auto w = JsonWriter(buffer);
+
+    SECTION("Values") {
+        w.begin_array()
+            .value("text")
+            .value(42)
+            .value(-7)
+            .value(true)
+            .null()
+        .end_array();
+        REQUIRE(buffer.view() == R"(["text",42,-7,true,null])");
+        REQUIRE(w.depth() == 0);
+    }
+
+    SECTION("Nesting") {
+        w.begin_object()
+            .member("a", 1)
+            .key("b").begin_array()
+                .begin_object().end_object()
+                .begin_array().value(2).value(3).end_array()
+            .end_array()
+            .key("c").begin_object().member("d", "e").end_object()
+        .end_object();
+        REQUIRE(buffer.view() == R"({"a":1,"b":[{},[2,3]],"c":{"d":"e"}})");
+    }
+
+    SECTION("Escaping") {
+        w.value(std::string_view("quote \" backslash \\ newline \n tab \t bell \x07 ünïcode"));
+        REQUIRE(buffer.view() == R"("quote \" backslash \\ newline \n tab \t bell \u0007 ünïcode")");
+    }
+
+    SECTION("Invalid UTF-8") {
+        // A stray continuation byte, a truncated sequence, an overlong '/' and a surrogate.
+        w.value(std::string_view("a\x80" "b \xE2\x82 \xC0\xAF \xED\xA0\x80 \xF0\x9F\x99\x82"));
+        REQUIRE(buffer.view() ==
+            "\"a\xEF\xBF\xBD" "b \xEF\xBF\xBD\xEF\xBF\xBD \xEF\xBF\xBD\xEF\xBF\xBD "
+            "\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD \xF0\x9F\x99\x82\""
+        );
+    }
+
+    SECTION("Strings written in pieces") {
+        w.begin_object()
+            .key("message").begin_string().append_string("Hello, ").append_string("\"World\"").end_string()
+            .member("next", 1)
+        .end_object();
+        REQUIRE(buffer.view() == R"({"message":"Hello, \"World\"","next":1})");
+    }
+
+    SECTION("Top-level values are not separated") {
+        w.begin_object().end_object();
+        buffer.push_back('\n');
+        w.begin_object().end_object();
+        REQUIRE(buffer.view() == "{}\n{}");
+    }
+}
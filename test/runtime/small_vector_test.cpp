@@ -1,6 +1,7 @@
 #include "diagnostics/core/small_vec.hpp"
 #include <catch2/catch_test_macros.hpp>
 #include <print>
+#include <string>
 
 using namespace dark::core;
 
@@ -348,3 +349,32 @@ TEST_CASE("Small Vector", "[small_vec:modfying]") {
         }
     }
 }
+
+TEST_CASE("Small Vector", "[small_vec:move]") {
+    SECTION("Moving inline elements") {
+        // Strings own heap memory, so assigning into the raw inline buffer would free garbage.
+        auto text = std::string(64, 'x');
+        auto source = SmallVec<std::string, 4>{};
+        source.push_back(text);
+        source.push_back(text + "y");
+        REQUIRE(source.is_small());
+
+        auto moved = SmallVec<std::string, 4>(std::move(source));
+        REQUIRE(moved.is_small());
+        REQUIRE(moved.size() == 2);
+        REQUIRE(moved[0] == text);
+        REQUIRE(moved[1] == text + "y");
+        REQUIRE(source.empty());
+    }
+
+    SECTION("Moving heap elements") {
+        auto source = SmallVec<std::string, 1>{};
+        for (auto i = 0; i < 4; ++i) source.push_back(std::string(32, static_cast<char>('a' + i)));
+        REQUIRE(!source.is_small());
+
+        auto moved = SmallVec<std::string, 1>(std::move(source));
+        REQUIRE(moved.size() == 4);
+        REQUIRE(moved[3] == std::string(32, 'd'));
+        REQUIRE(source.empty());
+    }
+}
@@ -0,0 +1,418 @@
+#include <catch2/catch_test_macros.hpp>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <string_view>
+#include "diagnostics/source/column_index.hpp"
+#include "diagnostics/source/line_index.hpp"
+#include "diagnostics/source/mapped_source_file.hpp"
+#include "diagnostics/source/source_buffer.hpp"
+#include "diagnostics/source/source_converter.hpp"
+#include "diagnostics/source/source_location.hpp"
+#include "diagnostics/source/source_file.hpp"
+#include "diagnostics/source/source_manager.hpp"
+#include "diagnostics/source/token_line_cache.hpp"
+#include "diagnostics/consumer.hpp"
+#include "diagnostics/emitter.hpp"
+
+using namespace dark;
+
+namespace {
+    // Unique per run, so concurrent or leftover runs never share a file.
+    auto unique_temp_path(std::string_view stem) -> std::filesystem::path {
+        auto random = std::random_device{};
+        auto name = std::string(stem) + "_" + std::to_string(random()) + "_" + std::to_string(random()) + ".cpp";
+        return std::filesystem::temp_directory_path() / name;
+    }
+} // namespace
+
+TEST_CASE("Line Index", "[source:line_index]") {
+    SECTION("Empty text") {
+        auto index = LineIndex(std::string_view{});
+        REQUIRE(index.line_count() == 1);
+        auto info = index.info(0);
+        REQUIRE(info.line_number == 1);
+        REQUIRE(info.line_start_offset == 0);
+        REQUIRE(info.column == 0);
+    }
+
+    SECTION("Matches a linear scan") {
+        // Long enough to go through the vectorized path and the tail.
+        auto text = std::string();
+        for (auto i = 0u; i < 200; ++i) {
+            text.append(i % 7, 'a');
+            if (i % 3 != 0) text.push_back('\n');
+        }
+
+        auto index = LineIndex(text);
+        auto line = dsize_t{1};
+        auto line_start = dsize_t{};
+        for (auto offset = dsize_t{}; offset <= text.size(); ++offset) {
+            auto info = index.info(offset);
+            REQUIRE(info.line_number == line);
+            REQUIRE(info.line_start_offset == line_start);
+            REQUIRE(info.column == offset - line_start);
+            if (offset < text.size() && text[offset] == '\n') {
+                ++line;
+                line_start = offset + 1;
+            }
+        }
+        REQUIRE(index.line_count() == line);
+    }
+
+    SECTION("Line bounds") {
+        auto index = LineIndex("ab\n\ncd");
+        REQUIRE(index.line_count() == 3);
+        REQUIRE(index.line_start(2) == 3);
+        REQUIRE(index.line_end(2) == 3);
+        REQUIRE(index.line_end(3) == 6);
+        REQUIRE(index.find_line(100) == 3);
+    }
+}
+
+TEST_CASE("Source File", "[source:file]") {
+    auto text = std::string_view("int main() {\r\n    return 0\n}\n");
+    auto file = SourceFile("main.cpp", text, SourceFile::BorrowedTag{});
+
+    REQUIRE(file.line_count() == 4);
+    REQUIRE(file.line_text(1) == "int main() {");
+    REQUIRE(file.line_text(2) == "    return 0");
+    REQUIRE(file.line_text(4) == "");
+
+    SECTION("Single line location") {
+        auto loc = file.location(Span::from_size(18, 6));
+        REQUIRE(loc.filename == "main.cpp");
+        REQUIRE(loc.source.lines.size() == 1);
+
+        auto const& line = loc.source.lines[0];
+        REQUIRE(line.line_number == 2);
+        REQUIRE(line.line_start_offset == 14);
+        REQUIRE(line.tokens[0].text.is_borrowed());
+        REQUIRE(line.tokens[0].text.data() == text.data() + 14);
+        REQUIRE(line.tokens[0].marker == Span::from_size(18, 6));
+        REQUIRE(loc.line_info() == std::make_pair(dsize_t{2}, dsize_t{5}));
+    }
+
+    SECTION("Multi-line location") {
+        auto loc = file.location(Span(4, 20));
+        REQUIRE(loc.source.lines.size() == 2);
+        REQUIRE(loc.source.lines[0].tokens[0].marker == Span(4, 14));
+        REQUIRE(loc.source.lines[1].tokens[0].marker == Span(14, 20));
+    }
+
+    SECTION("Windowed location") {
+        auto spans = std::array{ Span::from_size(28, 1) };
+        auto loc = file.location(Span::from_size(0, 3), spans, 0);
+        REQUIRE(loc.source.lines.size() == 2);
+        REQUIRE(loc.source.lines[0].line_number == 1);
+        REQUIRE(loc.source.lines[1].line_number == 3);
+        REQUIRE(loc.source.lines[1].tokens[0].marker.empty());
+
+        loc = file.location(Span::from_size(0, 3), spans, 1);
+        REQUIRE(loc.source.lines.size() == 4);
+        REQUIRE(loc.source.lines[3].line_number == 4);
+    }
+
+    SECTION("Builders") {
+        auto info = file.line_info(18);
+        auto loc = DiagnosticLocation::from_text(file.filename(), file.line_text(info.line_number), info, Span::from_size(18, 6));
+        REQUIRE(loc.line_info() == std::make_pair(dsize_t{2}, dsize_t{5}));
+
+        auto tokens = DiagnosticSourceLocationTokens::builder()
+            .begin_line(info)
+            .add_token("return", 18)
+            .end_line()
+            .build();
+        REQUIRE(tokens.lines[0].line_number == 2);
+        REQUIRE(tokens.lines[0].line_start_offset == 14);
+    }
+}
+
+TEST_CASE("Source Manager", "[source:manager]") {
+    auto sm = SourceManager();
+    auto& a = sm.add("a.cpp", "a\nb\n");
+    auto& b = sm.add_borrowed("b.cpp", "c");
+
+    REQUIRE(sm.size() == 2);
+    REQUIRE(sm.find("a.cpp") == &a);
+    REQUIRE(sm.find("b.cpp") == &b);
+    REQUIRE(sm.find("c.cpp") == nullptr);
+    REQUIRE(a.line_info(2).line_number == 2);
+
+    auto& a2 = sm.add("a.cpp", "new");
+    REQUIRE(sm.find("a.cpp") == &a2);
+    REQUIRE(&sm[0] == &a);
+}
+
+TEST_CASE("Mapped Source File", "[source:mapped]") {
+    auto path = unique_temp_path("dark_diagnostics_mapped_source");
+    {
+        auto out = std::ofstream(path, std::ios::binary);
+        out << "void f();\nint g();\n";
+    }
+
+    auto sm = SourceManager();
+    auto& file = sm.add_mapped(path.string());
+    REQUIRE(file.is_mapped());
+    REQUIRE(file.line_count() == 3);
+    REQUIRE(file.line_text(2) == "int g();");
+
+    auto loc = file.location(Span::from_size(14, 1));
+    REQUIRE(loc.source.lines.size() == 1);
+    REQUIRE(loc.source.lines[0].tokens[0].text.is_borrowed());
+    REQUIRE(loc.source.lines[0].tokens[0].text.data() == file.text().data() + 10);
+
+    {
+        auto empty = unique_temp_path("dark_diagnostics_mapped_empty");
+        std::ofstream(empty).close();
+        auto mapped = MappedSourceFile(empty.string());
+        REQUIRE(mapped.empty());
+        std::filesystem::remove(empty);
+    }
+
+    {
+        auto standalone = SourceFile::map(path.string());
+        REQUIRE(standalone.is_mapped());
+        REQUIRE(standalone.filename() == path.string());
+        REQUIRE(standalone.line_text(1) == "void f();");
+    }
+
+    REQUIRE_THROWS(MappedSourceFile(unique_temp_path("dark_diagnostics_missing").string()));
+    REQUIRE_THROWS(SourceFile::map(unique_temp_path("dark_diagnostics_missing").string()));
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Source Buffer", "[source:buffer]") {
+    auto tokenized = 0u;
+    auto buffer = SourceBuffer("main.cpp", "int a;\nint b;\nint c;\n", [&tokenized](std::string_view line, auto& tokens) {
+        ++tokenized;
+        // One token per word, offsets relative to the line.
+        for (auto i = 0ul; i < line.size();) {
+            auto end = std::min(line.find(' ', i), line.size());
+            tokens.push_back(DiagnosticTokenInfo{ .text = core::CowString(line.substr(i, end - i)), .token_start_offset = static_cast<dsize_t>(i) });
+            i = end + 1;
+        }
+    });
+
+    REQUIRE(buffer.line_count() == 4);
+    for (auto l = dsize_t{1}; l <= 3; ++l) (void)buffer.line_tokens(l);
+    REQUIRE(tokenized == 3);
+
+    SECTION("Edits only re-tokenize the touched lines") {
+        auto edit = buffer.replace(Span(11, 12), "bb");
+        REQUIRE(edit.line_number == 2);
+        REQUIRE(edit.removed_lines == 0);
+        REQUIRE(edit.inserted_lines == 0);
+        REQUIRE(buffer.text() == "int a;\nint bb;\nint c;\n");
+
+        auto line3 = buffer.line_tokens(3);
+        REQUIRE(tokenized == 3);
+        REQUIRE(line3.line_start_offset == 15);
+        REQUIRE(line3.tokens[1].token_start_offset == 19);
+        REQUIRE(line3.tokens[1].text.to_borrowed() == "c;");
+
+        auto line2 = buffer.line_tokens(2);
+        REQUIRE(tokenized == 4);
+        REQUIRE(line2.tokens[1].text.to_borrowed() == "bb;");
+    }
+
+    SECTION("Edits keeping the line count") {
+        auto edit = buffer.replace(Span(4, 11), "x;\nint ");
+        REQUIRE(edit.removed_lines == 1);
+        REQUIRE(edit.inserted_lines == 1);
+        REQUIRE(buffer.text() == "int x;\nint b;\nint c;\n");
+
+        REQUIRE(buffer.line_tokens(3).tokens[1].text.to_borrowed() == "c;");
+        REQUIRE(tokenized == 3);
+        REQUIRE(buffer.line_tokens(1).tokens[1].text.to_borrowed() == "x;");
+        REQUIRE(buffer.line_tokens(2).tokens[1].text.to_borrowed() == "b;");
+        REQUIRE(tokenized == 5);
+    }
+
+    SECTION("Inserting and removing lines") {
+        auto edit = buffer.insert(7, "int x;\nint y;\n");
+        REQUIRE(edit.inserted_lines == 2);
+        REQUIRE(buffer.line_count() == 6);
+        REQUIRE(buffer.line_text(3) == "int y;");
+        REQUIRE(buffer.line_info(21).line_number == 4);
+
+        (void)buffer.line_tokens(5);
+        REQUIRE(tokenized == 3);
+
+        edit = buffer.erase(Span(7, 21));
+        REQUIRE(edit.removed_lines == 2);
+        REQUIRE(buffer.line_count() == 4);
+        REQUIRE(buffer.text() == "int a;\nint b;\nint c;\n");
+        REQUIRE(buffer.line_tokens(3).line_start_offset == 14);
+    }
+
+    SECTION("Location") {
+        auto loc = buffer.location(Span::from_size(11, 1));
+        REQUIRE(loc.source.lines.size() == 1);
+        auto const& line = loc.source.lines[0];
+        REQUIRE(line.line_number == 2);
+        REQUIRE(line.tokens[0].marker.empty());
+        REQUIRE(line.tokens[1].marker == Span::from_size(11, 1));
+        REQUIRE(!line.tokens[1].text.is_borrowed());
+    }
+}
+
+TEST_CASE("Encoded Source Locations", "[source:location]") {
+    auto sm = SourceManager();
+    auto& a = sm.add("a.cpp", "int a;\nint b;\n");
+    auto& b = sm.add("b.cpp", "int c;\n");
+
+    REQUIRE(a.id() == FileId{1});
+    REQUIRE(b.id() == FileId{2});
+    REQUIRE(sm.find_id("b.cpp") == b.id());
+    REQUIRE(!sm.find_id("c.cpp"));
+
+    SECTION("Round trip") {
+        auto loc = sm.encode(b.id(), 4);
+        REQUIRE(loc > a.encode(a.size()));
+        auto [id, offset] = sm.decode(loc);
+        REQUIRE(id == b.id());
+        REQUIRE(offset == 4);
+        REQUIRE(!sm.decode(SourceLocation{}).first);
+
+        auto range = a.encode(Span::from_size(11, 1));
+        auto location = sm.location(range);
+        REQUIRE(location.filename == "a.cpp");
+        REQUIRE(location.line_info() == std::make_pair(dsize_t{2}, dsize_t{5}));
+    }
+
+    SECTION("Sorting compares encoded locations without converting them") {
+        struct CollectingConsumer: DiagnosticConsumer {
+            std::vector<Diagnostic> diagnostics;
+            auto consume(Diagnostic&& d) -> void override { diagnostics.push_back(std::move(d)); }
+        };
+
+        static constexpr auto Unused = dark_make_diagnostic(1, "unused");
+
+        auto converter = SourceRangeConverter(sm);
+        auto collector = CollectingConsumer();
+        auto sorting = SortingDiagnosticConsumer(&collector);
+        auto emitter = DiagnosticEmitter<SourceRange>(&converter, &sorting);
+        emitter.defer_location_conversion();
+
+        emitter.error(b.encode(Span::from_size(4, 1)), Unused).emit();
+        emitter.error(a.encode(Span::from_size(11, 1)), Unused).emit();
+        emitter.error(a.encode(Span::from_size(4, 1)), Unused).emit();
+        emitter.flush();
+
+        auto& ds = collector.diagnostics;
+        REQUIRE(ds.size() == 3);
+        for (auto const& d: ds) REQUIRE(d.has_deferred_location());
+        REQUIRE(ds[0].location_key == sm.sort_key(a.encode(4)));
+        REQUIRE(ds[1].location_key == sm.sort_key(a.encode(11)));
+        REQUIRE(ds[2].location_key == sm.sort_key(b.encode(4)));
+        REQUIRE(ds[2].resolve_location().filename == "b.cpp");
+    }
+
+    SECTION("Sort keys follow the filenames rather than the registration order") {
+        auto& c = sm.add("0.cpp", "int d;\n");
+        REQUIRE(c.encode(0) > b.encode(b.size()));
+        REQUIRE(sm.sort_key(c.encode(c.size())) < sm.sort_key(a.encode(0)));
+        REQUIRE(sm.sort_key(a.encode(a.size())) < sm.sort_key(b.encode(0)));
+        REQUIRE(sm.sort_key(a.encode(4)) < sm.sort_key(a.encode(11)));
+        REQUIRE(sm.sort_key(SourceLocation{}) == 0);
+
+        // A file registered again under the same name sorts after the old one.
+        auto& a2 = sm.add("a.cpp", "int e;\n");
+        REQUIRE(sm.sort_key(a.encode(a.size())) < sm.sort_key(a2.encode(0)));
+        REQUIRE(sm.sort_key(a2.encode(a2.size())) < sm.sort_key(b.encode(0)));
+    }
+}
+
+TEST_CASE("Token Line Cache", "[source:token_cache]") {
+    auto sm = SourceManager();
+    auto& file = sm.add("main.cpp", "int a;\nint b;\n");
+
+    auto tokenized = 0u;
+    auto cache = TokenLineCache([&tokenized](std::string_view line, auto& tokens) {
+        ++tokenized;
+        for (auto i = 0ul; i < line.size();) {
+            auto end = std::min(line.find(' ', i), line.size());
+            tokens.push_back(DiagnosticTokenInfo{ .text = core::CowString(line.substr(i, end - i), core::CowString::BorrowedTag{}), .token_start_offset = static_cast<dsize_t>(i) });
+            i = end + 1;
+        }
+    });
+
+    auto loc = cache.location(file, Span::from_size(11, 1));
+    REQUIRE(tokenized == 1);
+    REQUIRE(loc.source.lines.size() == 1);
+    auto const& line = loc.source.lines[0];
+    REQUIRE(line.line_number == 2);
+    REQUIRE(line.tokens[1].token_start_offset == 11);
+    REQUIRE(line.tokens[1].marker == Span::from_size(11, 1));
+    REQUIRE(line.tokens[1].text.data() == file.text().data() + 11);
+
+    (void)cache.location(file, Span::from_size(7, 3));
+    REQUIRE(tokenized == 1);
+
+    cache.invalidate(file.id());
+    (void)cache.line(file, 2);
+    REQUIRE(tokenized == 2);
+    (void)cache.line(file, 1);
+    REQUIRE(tokenized == 3);
+}
+
+TEST_CASE("Source Encoding", "[source:encoding]") {
+    SECTION("Latin-1") {
+        auto file = SourceFile("legacy.c", std::string("caf\xE9 = 1;\nx\n"), SourceEncoding::Latin1);
+        REQUIRE(file.line_count() == 3);
+        REQUIRE(file.line_text(1) == "caf\xC3\xA9 = 1;");
+        REQUIRE(file.line_text(1).data() == file.line_text(1).data());
+        REQUIRE(file.utf8_offset(5) == 6);
+        REQUIRE(file.utf8_offset(10) == 20);
+
+        auto loc = file.location(Span::from_size(5, 1));
+        REQUIRE(loc.source.lines.size() == 1);
+        REQUIRE(loc.source.lines[0].tokens[0].text.to_borrowed() == "caf\xC3\xA9 = 1;");
+        REQUIRE(loc.source.lines[0].tokens[0].marker == Span::from_size(6, 1));
+        // The token offsets are UTF-8 offsets, so serializers leave them out.
+        REQUIRE(!loc.has_byte_offsets);
+    }
+
+    SECTION("UTF-16 with a byte order mark") {
+        // "a\r\néb" in little-endian.
+        auto text = std::string("\xFF\xFE" "a\0\r\0\n\0\xE9\0b\0", 12);
+        REQUIRE(detect_encoding(text) == SourceEncoding::UTF16LE);
+
+        auto file = SourceFile("wide.c", text, SourceEncoding::UTF16LE);
+        REQUIRE(file.line_count() == 2);
+        REQUIRE(file.line_text(1) == "a");
+        REQUIRE(file.line_text(2) == "\xC3\xA9" "b");
+        REQUIRE(file.utf8_offset(10) == file.utf8_line_start(2) + 2);
+    }
+}
+
+TEST_CASE("Column Positions", "[source:columns]") {
+    auto sm = SourceManager();
+    // "é" takes two UTF-8 bytes and one UTF-16 unit; "𝄞" takes four bytes and two units.
+    auto& file = sm.add("main.cpp", "int a;\n\xC3\xA9\xF0\x9D\x84\x9E = b;\n");
+
+    REQUIRE(file.position(4, ColumnUnit::UTF16) == SourcePosition{ 1, 4 });
+    REQUIRE(file.position(13, ColumnUnit::UTF16) == SourcePosition{ 2, 3 });
+    REQUIRE(file.position(13, ColumnUnit::UTF32) == SourcePosition{ 2, 2 });
+    REQUIRE(file.position(13, ColumnUnit::UTF8) == SourcePosition{ 2, 6 });
+    REQUIRE(file.offset(SourcePosition{ 2, 3 }, ColumnUnit::UTF16) == 13);
+    REQUIRE(file.offset(SourcePosition{ 2, 100 }, ColumnUnit::UTF16) == 18);
+
+    auto range = sm.position(file.encode(Span(13, 16)), ColumnUnit::UTF16);
+    REQUIRE(range.start == SourcePosition{ 2, 3 });
+    REQUIRE(range.end == SourcePosition{ 2, 6 });
+
+    // Spans over several lines map both ends on their own line.
+    auto multiline = file.position(Span(4, 13), ColumnUnit::UTF16);
+    REQUIRE(multiline.start == SourcePosition{ 1, 4 });
+    REQUIRE(multiline.end == SourcePosition{ 2, 3 });
+
+    // A span ending right after the newline ends at the start of the next line.
+    auto whole_line = file.position(Span(0, 7), ColumnUnit::UTF16);
+    REQUIRE(whole_line.start == SourcePosition{ 1, 0 });
+    REQUIRE(whole_line.end == SourcePosition{ 2, 0 });
+}
@@ -212,4 +212,28 @@ TEST_CASE("Span", "[span]") {
             REQUIRE(lhs.merge(rhs).has_value() == false);
         }
     }
+
+    SECTION("Relative spans") {
+        static_assert(sizeof(RelSpan::size_type) == 4);
+        auto base = Span::size_type{100};
+
+        auto rel = RelSpan(Span(110, 120) - base);
+        REQUIRE(rel == RelSpan(10, 20));
+        REQUIRE(Span(rel) + base == Span(110, 120));
+
+        // Spans starting before the base are clipped to it.
+        REQUIRE(RelSpan(Span(95, 105) - base) == RelSpan(0, 5));
+    }
+
+#ifdef DARK_DIAGNOSTICS_LARGE_FILES
+    SECTION("Positions past 4 GiB") {
+        static_assert(sizeof(Span::size_type) == 8);
+        auto base = Span::size_type{5'000'000'000};
+
+        auto span = Span(base + 10, base + 20);
+        REQUIRE(span.size() == 10);
+        REQUIRE(RelSpan(span - base) == RelSpan(10, 20));
+        REQUIRE(Span(RelSpan(10, 20)) + base == span);
+    }
+#endif
 }